@@ -0,0 +1,107 @@
+"""
+Throughput of each stage of the WBGT calculation
+
+Inputs of each stage are prepared before timing, so that only the stage
+itself is timed:
+
+    - units : Conversion of the inputs to the units of the kernels
+    - relhum : Relative humidity from dew point
+    - solar : Solar geometry and irradiance adjustment
+    - wind : Adjustment of wind speed to 2 m and clipping
+    - <method>_<variable> : Each solver on its own
+    - liljegren_kernel : Fused Liljegren kernel, with solar geometry given
+
+"""
+
+import pytest
+from metpy.units import units
+from metpy.calc import relative_humidity_from_dewpoint
+
+from pywbgt import bernard, dimiceli, liljegren
+from pywbgt.solar import solar_parameters
+
+def _magnitudes(met):
+    """Inputs in the units the solvers expect"""
+
+    return {
+        'solar'    : met['solar'].to('watt/m**2').magnitude,
+        'pres'     : met['pres'].to('hPa').magnitude,
+        'temp_air' : met['temp_air'].to('degC').magnitude,
+        'temp_dew' : met['temp_dew'].to('degC').magnitude,
+        'speed'    : met['speed'].to('m/s').magnitude,
+        'f_db'     : met['f_db'],
+        'cosz'     : met['cosz'],
+    }
+
+def units_stage(met):
+    return _magnitudes, (met,)
+
+def relhum_stage(met):
+    return relative_humidity_from_dewpoint, (met['temp_air'], met['temp_dew'])
+
+def solar_stage(met):
+    return solar_parameters, (
+        met['datetime'], met['lat'], met['lon'], met['solar'].magnitude,
+    )
+
+def wind_stage(met):
+    return dimiceli.adjust_speed_2m, (met['speed'], units.Quantity(10.0, 'meter'))
+
+def liljegren_tg_stage(met):
+    mag = _magnitudes(met)
+    return liljegren.globe_temperature, (
+        mag['temp_air'], mag['temp_dew'], mag['pres'], mag['speed'],
+        mag['solar'], mag['f_db'], mag['cosz'],
+    )
+
+def liljegren_tpsy_stage(met):
+    mag = _magnitudes(met)
+    return liljegren.psychrometric_wetbulb, (mag['temp_air'], mag['temp_dew'], mag['pres'])
+
+def liljegren_tnwb_stage(met):
+    mag = _magnitudes(met)
+    return liljegren.natural_wetbulb, (
+        mag['temp_air'], mag['temp_dew'], mag['pres'], mag['speed'],
+        mag['solar'], mag['f_db'], mag['cosz'],
+    )
+
+def liljegren_kernel_stage(met):
+    args = [met[key] for key in ('datetime', 'lat', 'lon', 'solar', 'pres', 'temp_air', 'temp_dew', 'speed')]
+    return (
+        lambda *args: liljegren.wetbulb_globe(*args, f_db=met['f_db'], cosz=met['cosz']),
+        args,
+    )
+
+def bernard_tg_stage(met):
+    mag   = _magnitudes(met)
+    vapor = bernard.saturation_vapor_pressure(met['temp_dew']).to('hPa').magnitude
+    return bernard.globe_temperature, (
+        mag['temp_air'], vapor.astype(mag['temp_air'].dtype), mag['speed'], mag['pres'],
+        mag['solar'], mag['f_db'], mag['cosz'],
+    )
+
+def bernard_tnwb_stage(met):
+    mag  = _magnitudes(met)
+    temp = mag['temp_air']
+    return bernard.natural_wetbulb, (temp, temp - 5.0, temp + 5.0, mag['speed'])
+
+def dimiceli_tg_stage(met):
+    mag = _magnitudes(met)
+    return dimiceli.globe_temperature, (
+        mag['temp_air'], mag['temp_dew'], mag['pres'], mag['speed'] * 3600.0,
+        mag['solar'], mag['f_db'], mag['cosz'],
+    )
+
+STAGES = {
+    name[:-len('_stage')] : func
+    for name, func in globals().copy().items()
+    if name.endswith('_stage')
+}
+
+@pytest.mark.parametrize('stage', list(STAGES))
+def bench_stage(benchmark, stage, met, size, dtype, threads):
+
+    func, args = STAGES[stage](met)
+    benchmark.group = f'{stage} size={size}'
+    benchmark.extra_info.update(size=size, dtype=dtype)
+    benchmark(func, *args)
@@ -0,0 +1,20 @@
+"""
+End to end throughput of pywbgt.wbgt() for each method
+
+Solar geometry is computed inside wbgt(), as in normal use.
+
+"""
+
+import pytest
+
+from pywbgt import wbgt
+from pywbgt.constants import METHODS
+
+ARGS = ('datetime', 'lat', 'lon', 'solar', 'pres', 'temp_air', 'temp_dew', 'speed')
+
+@pytest.mark.parametrize('method', METHODS)
+def bench_wbgt(benchmark, method, met, size, dtype, threads):
+
+    benchmark.group = f'wbgt size={size}'
+    benchmark.extra_info.update(size=size, dtype=dtype)
+    benchmark(wbgt, method, *(met[key] for key in ARGS))
@@ -0,0 +1,516 @@
+/*
+ *  Benchmark harness for the Liljegren C core
+ *
+ *  Times the solvers (Tglobe, Twb), calc_solar_parameters(), and the
+ *  thermophysical property functions of src/pywbgt/src/liljegren_c.c in
+ *  isolation from the Cython layer, by compiling the same source file
+ *  into this executable. For each kernel the best of several passes over
+ *  the input set is reported as nanoseconds per call, with the mean
+ *  number of solver iterations per call and, optionally, Linux
+ *  perf_event hardware counters per call.
+ *
+ *  Input sets are either synthetic (seeded, same ranges as the Python
+ *  benchmarks) or replayed from a text file with one record per line:
+ *
+ *      year month day lat lon solar pres temp_air temp_dew speed
+ *
+ *  where month = 0 means day is the day of year, day may have a
+ *  fraction (GMT), solar is in W/m2, pres in hPa, temperatures in degC,
+ *  and speed in m/s. Lines starting with '#' are skipped. A synthetic
+ *  set can be written in this format with -o, to replay it later.
+ *
+ *  Usage:
+ *
+ *      make
+ *      ./bench_liljegren -n 1000000 -r 5
+ *      ./bench_liljegren -i records.txt -k tglobe,tnwb -p
+ *
+ */
+
+#define	_GNU_SOURCE
+#include	<stdint.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<time.h>
+#include	<unistd.h>
+
+#ifdef __linux__
+#include	<linux/perf_event.h>
+#include	<sys/ioctl.h>
+#include	<sys/syscall.h>
+#endif
+
+#define	LILJEGREN_NO_MAIN
+#include	"liljegren_c.c"
+
+#define	NCOUNTER	4
+
+/*
+ *  one input record; Tair in K and rh as fraction, as the solvers expect
+ */
+typedef struct {
+	int	year, month;
+	double day;
+	float	lat, lon, solar, pres, Tair, rh, speed;
+	float	solar_adj, cza, fdir, eair;	/* derived with calc_solar_parameters() */
+} record;
+
+typedef struct {
+	const char *name;
+	double (*run)(const record *, long, long *);
+	int	iterative;	/* TRUE for the iterative solvers */
+} kernel;
+
+static const char *COUNTER_NAMES[NCOUNTER] = {
+	"cycles", "instructions", "cache-misses", "branch-misses",
+};
+
+/* ============================================================================
+ *  Kernels; each loops over all records and returns a checksum so that the
+ *  calls are not optimized away. Solver iterations are added to *niter.
+ */
+
+static double run_tglobe(const record *rec, long n, long *niter)
+{
+	double sum = 0.0;
+	int	iter;
+	long	i;
+	for ( i = 0; i < n; i++ ) {
+		sum += Tglobe_guess(rec[i].Tair, rec[i].rh, rec[i].pres, rec[i].speed,
+			rec[i].solar_adj, rec[i].fdir, rec[i].cza, D_GLOBE, 0.0, &iter);
+		*niter += iter;
+	}
+	return sum;
+}
+
+static double run_tnwb(const record *rec, long n, long *niter)
+{
+	double sum = 0.0;
+	int	iter;
+	long	i;
+	for ( i = 0; i < n; i++ ) {
+		sum += Twb_guess(rec[i].Tair, rec[i].rh, rec[i].pres, rec[i].speed,
+			rec[i].solar_adj, rec[i].fdir, rec[i].cza, 1, 0.0, &iter);
+		*niter += iter;
+	}
+	return sum;
+}
+
+static double run_tpsy(const record *rec, long n, long *niter)
+{
+	double sum = 0.0;
+	int	iter;
+	long	i;
+	for ( i = 0; i < n; i++ ) {
+		sum += Twb_guess(rec[i].Tair, rec[i].rh, rec[i].pres,
+			0.0, 0.0, 0.0, 0.0, 0, 0.0, &iter);
+		*niter += iter;
+	}
+	return sum;
+}
+
+static double run_solar(const record *rec, long n, long *niter)
+{
+	double sum = 0.0;
+	float	solar, cza, fdir;
+	long	i;
+	for ( i = 0; i < n; i++ ) {
+		solar = rec[i].solar;
+		calc_solar_parameters(rec[i].year, rec[i].month, rec[i].day,
+			rec[i].lat, rec[i].lon, &solar, &cza, &fdir);
+		sum += solar + cza + fdir;
+	}
+	return sum;
+}
+
+static double run_h_sphere(const record *rec, long n, long *niter)
+{
+	double sum = 0.0;
+	long	i;
+	for ( i = 0; i < n; i++ )
+		sum += h_sphere_in_air(D_GLOBE, rec[i].Tair, rec[i].pres, rec[i].speed);
+	return sum;
+}
+
+static double run_h_cylinder(const record *rec, long n, long *niter)
+{
+	double sum = 0.0;
+	long	i;
+	for ( i = 0; i < n; i++ )
+		sum += h_cylinder_in_air(D_WICK, L_WICK, rec[i].Tair, rec[i].pres, rec[i].speed);
+	return sum;
+}
+
+static double run_esat(const record *rec, long n, long *niter)
+{
+	double sum = 0.0;
+	long	i;
+	for ( i = 0; i < n; i++ )
+		sum += esat(rec[i].Tair, 0);
+	return sum;
+}
+
+static double run_dew_point(const record *rec, long n, long *niter)
+{
+	double sum = 0.0;
+	long	i;
+	for ( i = 0; i < n; i++ )
+		sum += dew_point(rec[i].eair, 0);
+	return sum;
+}
+
+static double run_viscosity(const record *rec, long n, long *niter)
+{
+	double sum = 0.0;
+	long	i;
+	for ( i = 0; i < n; i++ )
+		sum += viscosity(rec[i].Tair);
+	return sum;
+}
+
+static double run_thermal_cond(const record *rec, long n, long *niter)
+{
+	double sum = 0.0;
+	long	i;
+	for ( i = 0; i < n; i++ )
+		sum += thermal_cond(rec[i].Tair);
+	return sum;
+}
+
+static double run_diffusivity(const record *rec, long n, long *niter)
+{
+	double sum = 0.0;
+	long	i;
+	for ( i = 0; i < n; i++ )
+		sum += diffusivity(rec[i].Tair, rec[i].pres);
+	return sum;
+}
+
+static double run_evap(const record *rec, long n, long *niter)
+{
+	double sum = 0.0;
+	long	i;
+	for ( i = 0; i < n; i++ )
+		sum += evap(rec[i].Tair);
+	return sum;
+}
+
+static double run_emis_atm(const record *rec, long n, long *niter)
+{
+	double sum = 0.0;
+	long	i;
+	for ( i = 0; i < n; i++ )
+		sum += emis_atm(rec[i].Tair, rec[i].rh);
+	return sum;
+}
+
+static const kernel KERNELS[] = {
+	{"tglobe",       run_tglobe,        TRUE},
+	{"tnwb",         run_tnwb,          TRUE},
+	{"tpsy",         run_tpsy,          TRUE},
+	{"solar",        run_solar,         FALSE},
+	{"h_sphere",     run_h_sphere,      FALSE},
+	{"h_cylinder",   run_h_cylinder,    FALSE},
+	{"esat",         run_esat,          FALSE},
+	{"dew_point",    run_dew_point,     FALSE},
+	{"viscosity",    run_viscosity,     FALSE},
+	{"thermal_cond", run_thermal_cond,  FALSE},
+	{"diffusivity",  run_diffusivity,   FALSE},
+	{"evap",         run_evap,          FALSE},
+	{"emis_atm",     run_emis_atm,      FALSE},
+};
+
+#define	NKERNEL	( sizeof(KERNELS) / sizeof(KERNELS[0]) )
+
+/* ============================================================================
+ *  Hardware counters; all four counters are opened as one group so they
+ *  cover the same instructions. Counting is disabled if the group cannot be
+ *  opened (e.g., perf_event_paranoid too high or not running on Linux).
+ */
+
+static int perf_fd[NCOUNTER] = {-1, -1, -1, -1};
+
+static int perf_open(void)
+{
+#ifdef __linux__
+	static const uint64_t config[NCOUNTER] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES,
+	};
+	struct perf_event_attr attr;
+	int	i;
+
+	for ( i = 0; i < NCOUNTER; i++ ) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size           = sizeof(attr);
+		attr.type           = PERF_TYPE_HARDWARE;
+		attr.config         = config[i];
+		attr.disabled       = i == 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv     = 1;
+		attr.read_format    = PERF_FORMAT_GROUP;
+		perf_fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1,
+			i == 0 ? -1 : perf_fd[0], 0);
+		if ( perf_fd[i] < 0 ) {
+			while ( i-- > 0 ) close(perf_fd[i]);
+			perf_fd[0] = -1;
+			return -1;
+		}
+	}
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+static void perf_start(void)
+{
+#ifdef __linux__
+	if ( perf_fd[0] < 0 ) return;
+	ioctl(perf_fd[0], PERF_EVENT_IOC_RESET,  PERF_IOC_FLAG_GROUP);
+	ioctl(perf_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+static void perf_stop(uint64_t *counts)
+{
+#ifdef __linux__
+	uint64_t buf[1 + NCOUNTER];
+	int	i;
+
+	if ( perf_fd[0] < 0 ) return;
+	ioctl(perf_fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	if ( read(perf_fd[0], buf, sizeof(buf)) != sizeof(buf) ) return;
+	for ( i = 0; i < NCOUNTER; i++ ) counts[i] = buf[1 + i];
+#endif
+}
+
+/* ============================================================================
+ *  Input sets
+ */
+
+static uint64_t rng_state;
+
+static double uniform(double low, double high)
+{
+	/* xorshift64* */
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return low + (high - low) * ((rng_state * 2685821657736338717ULL) >> 11) * 0x1.0p-53;
+}
+
+static void set_record(record *rec, int year, int month, double day, float lat, float lon,
+	float solar, float pres, float Tair, float Tdew, float speed)
+{
+	rec->year  = year;
+	rec->month = month;
+	rec->day   = day;
+	rec->lat   = lat;
+	rec->lon   = lon;
+	rec->solar = solar;
+	rec->pres  = pres;
+	rec->Tair  = Tair + 273.15;
+	rec->rh    = min( esat(Tdew + 273.15, 0) / esat(rec->Tair, 0), 1.0 );
+	rec->speed = max( speed, MIN_SPEED );
+	rec->eair  = rec->rh * esat(rec->Tair, 0);
+
+	rec->solar_adj = solar;
+	calc_solar_parameters(year, month, day, lat, lon, &rec->solar_adj, &rec->cza, &rec->fdir);
+}
+
+static record *synthetic(long n, uint64_t seed)
+{
+	record *rec = malloc(n * sizeof(record));
+	float	Tair;
+	long	i;
+
+	if ( rec == NULL ) return NULL;
+	rng_state = seed * 0x9E3779B97F4A7C15ULL + 1;
+	for ( i = 0; i < n; i++ ) {
+		Tair = uniform(15, 40);
+		set_record(&rec[i], 2000, 0, uniform(1, 366),
+			uniform(-60, 60), uniform(-180, 180),
+			uniform(0, 1000), uniform(950, 1030),
+			Tair, uniform(5, min(25, Tair)), uniform(0.5, 8));
+	}
+	return rec;
+}
+
+static record *replay(const char *path, long *n)
+{
+	char	line[MAXLINE];
+	FILE	*fp;
+	record *rec = NULL, *tmp;
+	long	size = 0;
+	int	year, month;
+	double day;
+	float	lat, lon, solar, pres, Tair, Tdew, speed;
+
+	if ( (fp = fopen(path, "r")) == NULL ) return NULL;
+	*n = 0;
+	while ( fgets(line, MAXLINE, fp) != NULL ) {
+		if ( line[0] == '#' ) continue;
+		if ( sscanf(line, "%d %d %lf %f %f %f %f %f %f %f",
+			&year, &month, &day, &lat, &lon, &solar, &pres, &Tair, &Tdew, &speed) != 10 )
+			continue;
+		if ( *n == size ) {
+			size = size ? 2*size : 1024;
+			if ( (tmp = realloc(rec, size * sizeof(record))) == NULL ) {
+				free(rec);
+				fclose(fp);
+				return NULL;
+			}
+			rec = tmp;
+		}
+		set_record(&rec[(*n)++], year, month, day, lat, lon, solar, pres, Tair, Tdew, speed);
+	}
+	fclose(fp);
+	return rec;
+}
+
+static int dump(const char *path, const record *rec, long n)
+{
+	FILE	*fp;
+	long	i;
+
+	if ( (fp = fopen(path, "w")) == NULL ) return -1;
+	fprintf(fp, "# year month day lat lon solar pres temp_air temp_dew speed\n");
+	for ( i = 0; i < n; i++ )
+		fprintf(fp, "%d %d %.6f %.4f %.4f %.3f %.3f %.4f %.4f %.4f\n",
+			rec[i].year, rec[i].month, rec[i].day, rec[i].lat, rec[i].lon,
+			rec[i].solar, rec[i].pres, rec[i].Tair - 273.15,
+			dew_point(rec[i].eair, 0) - 273.15, rec[i].speed);
+	return fclose(fp);
+}
+
+/* ============================================================================
+ */
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1.0e9 + ts.tv_nsec;
+}
+
+static int selected(const char *list, const char *name)
+{
+	const char *p = list;
+	size_t	len = strlen(name);
+
+	if ( list == NULL ) return TRUE;
+	while ( (p = strstr(p, name)) != NULL ) {
+		if ( (p == list || p[-1] == ',') && (p[len] == ',' || p[len] == '\0') )
+			return TRUE;
+		p += len;
+	}
+	return FALSE;
+}
+
+static void usage(const char *prog)
+{
+	size_t	k;
+
+	fprintf(stderr,
+		"usage: %s [-n records] [-r repeats] [-s seed] [-i replay_file] "
+		"[-o dump_file] [-k kernel,...] [-p]\n"
+		"  -n  number of synthetic records (default 100000)\n"
+		"  -r  timed passes per kernel; best is reported (default 5)\n"
+		"  -s  seed of synthetic records (default 0)\n"
+		"  -i  replay records from file instead of synthetic records\n"
+		"  -o  write the records to file, for later replay\n"
+		"  -k  comma separated kernels to run (default all)\n"
+		"  -p  report perf_event hardware counters per call\n"
+		"kernels:", prog);
+	for ( k = 0; k < NKERNEL; k++ ) fprintf(stderr, " %s", KERNELS[k].name);
+	fprintf(stderr, "\n");
+}
+
+int	main(int argc, char **argv)
+{
+	const char *input = NULL, *output = NULL, *kernels = NULL;
+	long	n = 100000, niter, best_iter;
+	int	repeat = 5, perf = FALSE, opt, r, c;
+	uint64_t seed = 0, counts[NCOUNTER], best_counts[NCOUNTER];
+	double elapsed, best, sink = 0.0;
+	record *rec;
+	size_t	k;
+
+	while ( (opt = getopt(argc, argv, "n:r:s:i:o:k:ph")) != -1 ) {
+		switch ( opt ) {
+			case 'n': n       = atol(optarg); break;
+			case 'r': repeat  = atoi(optarg); break;
+			case 's': seed    = strtoull(optarg, NULL, 10); break;
+			case 'i': input   = optarg; break;
+			case 'o': output  = optarg; break;
+			case 'k': kernels = optarg; break;
+			case 'p': perf    = TRUE;   break;
+			default : usage(argv[0]); return opt == 'h' ? 0 : 2;
+		}
+	}
+	if ( n < 1 || repeat < 1 ) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	rec = input ? replay(input, &n) : synthetic(n, seed);
+	if ( rec == NULL || n < 1 ) {
+		fprintf(stderr, "failed to %s records\n", input ? "read" : "allocate");
+		return 1;
+	}
+	if ( output && dump(output, rec, n) != 0 ) {
+		fprintf(stderr, "failed to write %s\n", output);
+		return 1;
+	}
+	if ( perf && perf_open() != 0 ) {
+		fprintf(stderr, "perf_event counters unavailable; check /proc/sys/kernel/perf_event_paranoid\n");
+		perf = FALSE;
+	}
+
+	printf("records: %ld (%s)  repeats: %d\n", n, input ? input : "synthetic", repeat);
+	printf("%-13s %10s %10s", "kernel", "ns/call", "iter/call");
+	if ( perf ) {
+		for ( c = 0; c < NCOUNTER; c++ ) printf(" %14s", COUNTER_NAMES[c]);
+		printf(" %6s", "IPC");
+	}
+	printf("\n");
+
+	for ( k = 0; k < NKERNEL; k++ ) {
+		if ( !selected(kernels, KERNELS[k].name) ) continue;
+
+		niter = 0;
+		sink += KERNELS[k].run(rec, n, &niter);	/* warm up */
+		best = -1.0;
+		for ( r = 0; r < repeat; r++ ) {
+			niter = 0;
+			memset(counts, 0, sizeof(counts));
+			perf_start();
+			elapsed = now_ns();
+			sink += KERNELS[k].run(rec, n, &niter);
+			elapsed = now_ns() - elapsed;
+			perf_stop(counts);
+			if ( best < 0.0 || elapsed < best ) {
+				best      = elapsed;
+				best_iter = niter;
+				memcpy(best_counts, counts, sizeof(counts));
+			}
+		}
+
+		printf("%-13s %10.2f", KERNELS[k].name, best / n);
+		if ( KERNELS[k].iterative )
+			printf(" %10.2f", (double)best_iter / n);
+		else
+			printf(" %10s", "-");
+		if ( perf ) {
+			for ( c = 0; c < NCOUNTER; c++ ) printf(" %14.2f", (double)best_counts[c] / n);
+			printf(" %6.2f", best_counts[0] ? (double)best_counts[1] / best_counts[0] : 0.0);
+		}
+		printf("\n");
+	}
+
+	free(rec);
+	return sink == 0.123456789;	/* keep the checksum live */
+}
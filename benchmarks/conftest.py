@@ -0,0 +1,101 @@
+"""
+Parametrization of the pytest-benchmark suite
+
+Every benchmark takes the size, nthreads, and dtype fixtures, which are
+parametrized from the command line:
+
+    pytest benchmarks --sizes 1e2 1e4 1e6 1e8 --threads 1 4 max --dtypes float32
+
+Size and dtype are session scoped, so pytest groups the benchmarks by
+them, inputs are generated once per size and dtype, and only the inputs
+of the current size and dtype are kept in memory.
+
+Inputs are realistic synthetic station series (pywbgt.synthetic) by
+default, so that solver iteration counts are representative; use
+--inputs uniform for independent uniform random values.
+
+"""
+
+import numpy
+import pytest
+
+from pywbgt import parallel
+
+SIZES   = ['1e2', '1e4', '1e6']
+THREADS = ['1', 'max']
+DTYPES  = ['float32', 'float64']
+
+def pytest_addoption(parser):
+
+    group = parser.getgroup('pywbgt')
+    group.addoption('--sizes',   nargs='+', default=SIZES,
+                    help='Number of points; up to 1e8 (about 4 GB of inputs in float64)')
+    group.addoption('--threads', nargs='+', default=THREADS,
+                    help="Thread counts; 'max' is all available threads")
+    group.addoption('--dtypes',  nargs='+', default=DTYPES, choices=DTYPES,
+                    help='Floating point type of the inputs')
+    group.addoption('--inputs',  default='synthetic', choices=['synthetic', 'uniform'],
+                    help='Realistic synthetic station series or uniform random values')
+
+def _threads(values):
+
+    nmax = parallel.max_threads()
+    out  = []
+    for val in values:
+        val = nmax if val == 'max' else min(int(val), nmax)
+        if val not in out:
+            out.append(val)
+    return out
+
+def pytest_generate_tests(metafunc):
+
+    config = metafunc.config
+    if 'size' in metafunc.fixturenames:
+        metafunc.parametrize(
+            'size', [int(float(val)) for val in config.getoption('sizes')], scope='session',
+        )
+    if 'nthreads' in metafunc.fixturenames:
+        metafunc.parametrize('nthreads', _threads(config.getoption('threads')))
+    if 'dtype' in metafunc.fixturenames:
+        metafunc.parametrize('dtype', config.getoption('dtypes'), scope='session')
+
+def _inputs(size, dtype, kind='synthetic', seed=0):
+    """Synthetic inputs of one size and dtype, with solar geometry"""
+
+    if kind == 'synthetic':
+        from pywbgt import synthetic
+        return synthetic.stations(size, seed=seed, missing=0.0, dtype=dtype)
+
+    from pandas import date_range
+    from metpy.units import units
+
+    rng = numpy.random.default_rng(seed)
+    def uniform(low, high):
+        return rng.uniform(low, high, size).astype(dtype)
+
+    return {
+        'datetime' : date_range('20000101', periods=size, freq='min'),
+        'lat'      : numpy.full(size, 35.0),
+        'lon'      : numpy.full(size, -80.0),
+        'solar'    : units.Quantity(uniform(0, 1000),   'watt/m**2'),
+        'pres'     : units.Quantity(uniform(950, 1030), 'hPa'),
+        'temp_air' : units.Quantity(uniform(15, 40),    'degC'),
+        'temp_dew' : units.Quantity(uniform(5, 25),     'degC'),
+        'speed'    : units.Quantity(uniform(0.5, 8),    'm/s'),
+        'f_db'     : uniform(0, 1),
+        'cosz'     : uniform(0, 1),
+    }
+
+@pytest.fixture(scope='session')
+def met(size, dtype, pytestconfig):
+    """Dict of synthetic inputs; see _inputs()"""
+
+    return _inputs(size, dtype, pytestconfig.getoption('inputs'))
+
+@pytest.fixture
+def threads(nthreads, benchmark):
+    """Limit compiled kernels to nthreads for the benchmark"""
+
+    benchmark.extra_info['threads'] = nthreads
+    with parallel.num_threads(nthreads):
+        yield nthreads
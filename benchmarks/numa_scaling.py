@@ -0,0 +1,101 @@
+"""
+Thread scaling of the Liljegren kernel across sockets
+
+Times pywbgt.liljegren.wetbulb_globe() on a large synthetic record for
+an increasing number of threads, with solar geometry precomputed so
+that only the Cython kernel and its buffer copies are timed. Each
+thread binding policy is run in its own process, as the OpenMP runtime
+reads its binding environment only at start up.
+
+Usage:
+
+    python benchmarks/numa_scaling.py --size 20000000
+    python benchmarks/numa_scaling.py --bind none close spread
+
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import time
+
+BINDINGS = {
+    'none'   : {},
+    'close'  : {'OMP_PROC_BIND' : 'close',  'OMP_PLACES' : 'cores'},
+    'spread' : {'OMP_PROC_BIND' : 'spread', 'OMP_PLACES' : 'cores'},
+}
+
+def inputs(size, seed=0):
+    """Synthetic inputs with precomputed solar geometry"""
+
+    from pywbgt import synthetic
+
+    met = synthetic.stations(size, seed=seed, missing=0.0)
+    return synthetic.args(met), {key : met[key] for key in ('f_db', 'cosz')}
+
+def run(size, repeat):
+    """Time the kernel for each thread count in this process"""
+
+    from pywbgt import parallel
+    from pywbgt.liljegren import wetbulb_globe
+
+    args, kwargs = inputs(size)
+    results      = []
+    for nthreads in parallel.thread_counts():
+        with parallel.num_threads(nthreads):
+            wetbulb_globe(*(arg[:1000] for arg in args), **{
+                key : val[:1000] for key, val in kwargs.items()
+            })
+            times = []
+            for _ in range(repeat):
+                t0 = time.perf_counter()
+                wetbulb_globe(*args, **kwargs)
+                times.append(time.perf_counter() - t0)
+        results.append({'threads' : nthreads, 'seconds' : min(times)})
+
+    return {'binding' : parallel.thread_binding(), 'results' : results}
+
+def main(argv=None):
+
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--size',   type=int, default=2**22)
+    parser.add_argument('--repeat', type=int, default=3)
+    parser.add_argument('--bind',   nargs='+', default=list(BINDINGS), choices=list(BINDINGS))
+    parser.add_argument('--child',  action='store_true', help=argparse.SUPPRESS)
+    args = parser.parse_args(argv)
+
+    if args.child:
+        print(json.dumps(run(args.size, args.repeat)))
+        return
+
+    for bind in args.bind:
+        env = {
+            key : val for key, val in os.environ.items()
+            if key not in ('OMP_PROC_BIND', 'OMP_PLACES')
+        }
+        env.update(BINDINGS[bind])
+        proc = subprocess.run(
+            [sys.executable, __file__, '--child', '--size', str(args.size), '--repeat', str(args.repeat)],
+            env            = env,
+            capture_output = True,
+            text           = True,
+            check          = True,
+        )
+        res  = json.loads(proc.stdout.splitlines()[-1])
+        base = res['results'][0]['seconds']
+        info = res['binding']
+        print(f"binding: {bind}  cpus: {info['cpus']}  numa nodes: {info['numa_nodes']}")
+        print(f"{'threads':>8} {'seconds':>10} {'Mpts/s':>10} {'speedup':>8} {'efficiency':>10}")
+        for item in res['results']:
+            speedup = base / item['seconds']
+            print(
+                f"{item['threads']:8d} {item['seconds']:10.4f} "
+                f"{args.size / item['seconds'] / 1.0e6:10.2f} "
+                f"{speedup:8.2f} {speedup / item['threads']:10.2f}"
+            )
+        print()
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,334 @@
+"""
+Accuracy against throughput of each method and mode
+
+Runs every method and mode over reference datasets, measures the error of
+each against the Liljegren method (the full physical model, with its
+default options) and the throughput of each on the diurnal set, and marks
+the modes on the Pareto front: those for which no other mode is both more
+accurate and faster.
+
+Datasets:
+
+    - validation : The WBGT cases of tests/test_liljegren.py
+    - diurnal : Synthetic clear-sky diurnal cycles at 10-minute steps,
+      for a number of days, at several sites from tropical to sub-arctic
+
+Modes are the methods, their wet bulb options, single precision inputs,
+and Liljegren from hourly inputs interpolated inside the kernel
+(pywbgt.temporal; diurnal set only).
+
+Usage:
+
+    python benchmarks/pareto.py
+    python benchmarks/pareto.py --days 365 --sites 8 --output pareto.json --csv pareto.csv --plot pareto.png
+
+"""
+
+import argparse
+import csv
+import json
+import time
+
+import numpy
+import pandas
+from metpy.units import units
+
+from pywbgt import wbgt
+from pywbgt.temporal import wbgt_interp
+
+VARIABLES = ('Twbg', 'Tg', 'Tnwb')
+REFERENCE = 'liljegren'
+STEP      = 10   # minutes between samples of the diurnal set
+
+def validation():
+    """WBGT cases of tests/test_liljegren.py"""
+
+    size = 2
+    lat  = 33 + (43 + 59/60.0)/60.0
+    lon  = -84 + (22 + 59/60.0)/60.0
+    return {
+        'args' : (
+            pandas.to_datetime(['2000-06-01T16:00:00']).repeat(size),
+            numpy.full(size, lat),
+            numpy.full(size, lon),
+            units.Quantity([500.0,  805.0], 'watt/meter**2'),
+            units.Quantity([985.0, 1013.0], 'hPa'),
+            units.Quantity([ 25.0,   35.0], 'degree_Celsius'),
+            units.Quantity([ 15.0,   25.0], 'degree_Celsius'),
+            units.Quantity([  1.0,    5.0], 'mile/hour'),
+        ),
+        'kwargs' : {
+            'avg'       : 1.0,
+            'zspeed'    : units.Quantity(2.0, 'meters'),
+            'min_speed' : units.Quantity(0.13, 'm/s'),
+        },
+    }
+
+def diurnal(days, sites, seed=0):
+    """
+    Synthetic diurnal climate on a (time, site) grid
+
+    Temperature, humidity, and wind follow a diurnal cycle with day-to-day
+    noise, and irradiance is a clear-sky estimate from a simple solar
+    geometry, so that the set covers night, low sun, and high sun. The
+    record ends on the hour, so that it can also be sampled hourly.
+
+    """
+
+    rng   = numpy.random.default_rng(seed)
+    ntime = days * 24 * 60 // STEP - (60 // STEP - 1)
+    dates = pandas.date_range('20000101', periods=ntime, freq=f'{STEP}min')
+    lat   = numpy.linspace(-10.0, 65.0, sites)
+    lon   = numpy.linspace(-120.0, 30.0, sites)
+
+    doy   = dates.dayofyear.values[:, None]
+    hour  = (dates.hour.values + dates.minute.values/60.0)[:, None] + lon/15.0
+    decl  = numpy.radians(23.44) * numpy.sin(2.0*numpy.pi*(doy - 81)/365.0)
+    phi   = numpy.radians(lat)
+    cosz  = (
+        numpy.sin(phi)*numpy.sin(decl)
+        + numpy.cos(phi)*numpy.cos(decl)*numpy.cos(numpy.radians(15.0*(hour - 12.0)))
+    )
+    shape = cosz.shape
+    day   = numpy.repeat(rng.normal(0.0, 1.0, (days, sites)), 24*60//STEP, axis=0)[:ntime]
+    cycle = numpy.sin(2.0*numpy.pi*(hour - 9.0)/24.0)
+    mean  = 30.0 - 0.3*numpy.abs(lat) + 8.0*numpy.cos(2.0*numpy.pi*(doy - 200)/365.0)*numpy.sign(lat)
+
+    temp_air = mean + 6.0*cycle + 2.0*day
+    temp_dew = temp_air - rng.uniform(2.0, 20.0, shape) * (0.6 + 0.4*cycle.clip(0))
+    cloud    = rng.uniform(0.5, 1.0, shape)
+    return {
+        'dates'    : dates,
+        'lat'      : lat,
+        'lon'      : lon,
+        'solar'    : 1100.0 * cosz.clip(0) * cloud,
+        'pres'     : 1013.0 + 5.0*day + rng.normal(0.0, 1.0, shape),
+        'temp_air' : temp_air,
+        'temp_dew' : temp_dew,
+        'speed'    : (3.0 + 1.5*cycle + day).clip(0.2) * rng.uniform(0.7, 1.3, shape),
+    }
+
+def flatten(grid, dtype):
+    """Arguments to wbgt() for all times and sites of a grid"""
+
+    ntime, nsite = grid['solar'].shape
+    def quantity(key, unit):
+        return units.Quantity(grid[key].ravel().astype(dtype), unit)
+
+    return {
+        'args' : (
+            grid['dates'].repeat(nsite),
+            numpy.tile(grid['lat'], ntime),
+            numpy.tile(grid['lon'], ntime),
+            quantity('solar', 'watt/m**2'),
+            quantity('pres', 'hPa'),
+            quantity('temp_air', 'degC'),
+            quantity('temp_dew', 'degC'),
+            quantity('speed', 'm/s'),
+        ),
+        'kwargs' : {},
+        'grid' : grid,
+    }
+
+def method_mode(method, dtype=None, **options):
+    """Mode running pywbgt.wbgt() with options"""
+
+    def run(data):
+        args = data['args']
+        if dtype is not None:
+            args = args[:3] + tuple(arg.astype(dtype) for arg in args[3:])
+        return wbgt(method, *args, **data['kwargs'], **options)
+    return run
+
+def interp_mode(data):
+    """Liljegren from the hourly samples of a grid, interpolated in the kernel"""
+
+    grid = data.get('grid')
+    if grid is None:
+        return None
+    step = 60 // STEP
+    src  = {
+        key : grid[key][::step]
+        for key in ('solar', 'pres', 'temp_air', 'temp_dew', 'speed')
+    }
+    res = wbgt_interp(
+        grid['dates'][::step], grid['dates'], grid['lat'], grid['lon'],
+        units.Quantity(src['solar'],    'watt/m**2'),
+        units.Quantity(src['pres'],     'hPa'),
+        units.Quantity(src['temp_air'], 'degC'),
+        units.Quantity(src['temp_dew'], 'degC'),
+        units.Quantity(src['speed'],    'm/s'),
+        **data['kwargs'],
+    )
+    return {key : val.ravel() for key, val in res.items()}
+
+def modes():
+    """Name and function of every mode"""
+
+    out = {
+        'liljegren'         : method_mode('liljegren'),
+        'liljegren_float32' : method_mode('liljegren', 'float32'),
+        'liljegren_hourly'  : interp_mode,
+        'bernard'           : method_mode('bernard'),
+        'bernard_float32'   : method_mode('bernard', 'float32'),
+        'dimiceli_nws'      : method_mode('dimiceli_nws'),
+    }
+    for wetbulb in ('dimiceli', 'stull'):
+        for natural in ('hunter_minyard', 'malchaire', 'boyer'):
+            out[f'dimiceli_{wetbulb}_{natural}'] = method_mode(
+                'dimiceli', wetbulb=wetbulb, natural_wetbulb=natural,
+            )
+    return out
+
+def errors(res, ref):
+    """Error statistics of each variable against the reference"""
+
+    out = {}
+    for var in VARIABLES:
+        val  = numpy.asarray(res[var].to('degC').magnitude, dtype=numpy.float64).ravel()
+        good = numpy.asarray(ref[var].to('degC').magnitude, dtype=numpy.float64).ravel()
+        diff = (val - good)[numpy.isfinite(val) & numpy.isfinite(good)]
+        if diff.size == 0:
+            nan = float('nan')
+            out[var] = {'bias' : nan, 'mae' : nan, 'rmse' : nan, 'max' : nan, 'valid' : 0.0}
+            continue
+        out[var] = {
+            'bias'  : float(diff.mean()),
+            'mae'   : float(numpy.abs(diff).mean()),
+            'rmse'  : float(numpy.sqrt((diff**2).mean())),
+            'max'   : float(numpy.abs(diff).max()),
+            'valid' : diff.size / good.size,
+        }
+    return out
+
+def throughput(func, data, size, repeat):
+    """Elements per second; best of repeat"""
+
+    times = []
+    for _ in range(repeat):
+        t0 = time.perf_counter()
+        func(data)
+        times.append(time.perf_counter() - t0)
+    return size / min(times)
+
+def pareto_front(rows):
+    """Flag rows that no other row beats in both error and throughput"""
+
+    for row in rows:
+        row['pareto'] = numpy.isfinite(row['rmse']) and not any(
+            other is not row and other['rmse'] <= row['rmse']
+            and other['throughput'] >= row['throughput']
+            and (other['rmse'] < row['rmse'] or other['throughput'] > row['throughput'])
+            for other in rows
+        )
+    return rows
+
+def run(days, sites, repeat, names=None):
+    """
+    Errors and throughput of each mode
+
+    Returns:
+        list : One dict per mode with the error statistics of each dataset,
+            the throughput on the diurnal set, and the RMSE of Twbg on the
+            diurnal set, which with throughput defines the Pareto front
+
+    """
+
+    grid     = diurnal(days, sites)
+    datasets = {
+        'validation' : validation(),
+        'diurnal'    : flatten(grid, 'float64'),
+    }
+    size     = grid['solar'].size
+    allmodes = modes()
+    refs     = {key : allmodes[REFERENCE](data) for key, data in datasets.items()}
+
+    rows = []
+    for name, func in allmodes.items():
+        if names and name not in names and name != REFERENCE:
+            continue
+        row = {'mode' : name, 'errors' : {}}
+        for key, data in datasets.items():
+            res = func(data)
+            row['errors'][key] = None if res is None else errors(res, refs[key])
+        row['throughput'] = throughput(func, datasets['diurnal'], size, repeat)
+        row['rmse']       = row['errors']['diurnal']['Twbg']['rmse']
+        rows.append(row)
+    return pareto_front(rows)
+
+def write_csv(path, rows):
+    """Plot data; one line per mode"""
+
+    with open(path, 'w', newline='') as fid:
+        writer = csv.writer(fid)
+        writer.writerow(['mode', 'throughput', 'rmse', 'mae', 'max', 'validation_max', 'pareto'])
+        for row in rows:
+            diurnal_err = row['errors']['diurnal']['Twbg']
+            valid_err   = row['errors']['validation']
+            writer.writerow([
+                row['mode'], row['throughput'], row['rmse'], diurnal_err['mae'],
+                diurnal_err['max'], valid_err['Twbg']['max'] if valid_err else '',
+                int(row['pareto']),
+            ])
+
+def plot(path, rows):
+    """Scatter of RMSE against throughput, Pareto front highlighted"""
+
+    import matplotlib
+    matplotlib.use('Agg')
+    from matplotlib import pyplot
+
+    fig, ax = pyplot.subplots(figsize=(7, 5))
+    front   = sorted((row for row in rows if row['pareto']), key=lambda row: row['throughput'])
+    ax.plot(
+        [row['throughput'] for row in front], [row['rmse'] for row in front],
+        color='tab:red', zorder=1,
+    )
+    for row in rows:
+        ax.scatter(
+            row['throughput'], row['rmse'],
+            color='tab:red' if row['pareto'] else 'tab:gray', zorder=2,
+        )
+        ax.annotate(row['mode'], (row['throughput'], row['rmse']), fontsize=7)
+    ax.set_xscale('log')
+    ax.set_yscale('symlog', linthresh=1.0e-3)
+    ax.set_xlabel('Throughput (points/s)')
+    ax.set_ylabel(f'RMSE of WBGT against {REFERENCE} (degC)')
+    fig.tight_layout()
+    fig.savefig(path)
+
+def main(argv=None):
+
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--days',   type=int, default=30)
+    parser.add_argument('--sites',  type=int, default=8)
+    parser.add_argument('--repeat', type=int, default=3)
+    parser.add_argument('--modes',  nargs='+', default=None, choices=list(modes()))
+    parser.add_argument('--output', help='JSON file for all results')
+    parser.add_argument('--csv',    help='CSV file of plot data')
+    parser.add_argument('--plot',   help='Image file of the plot; requires matplotlib')
+    args = parser.parse_args(argv)
+
+    rows = run(args.days, args.sites, args.repeat, args.modes)
+
+    print(f"{'mode':<36} {'Mpts/s':>8} {'rmse':>8} {'mae':>8} {'max':>8} {'valid max':>9}  pareto")
+    for row in sorted(rows, key=lambda row: -row['throughput']):
+        err   = row['errors']['diurnal']['Twbg']
+        valid = row['errors']['validation']
+        print(
+            f"{row['mode']:<36} {row['throughput'] / 1.0e6:8.3f} "
+            f"{err['rmse']:8.4f} {err['mae']:8.4f} {err['max']:8.4f} "
+            f"{valid['Twbg']['max'] if valid else float('nan'):9.4f}  "
+            f"{'*' if row['pareto'] else ''}"
+        )
+
+    if args.output:
+        with open(args.output, 'w') as fid:
+            json.dump(rows, fid, indent=2)
+    if args.csv:
+        write_csv(args.csv, rows)
+    if args.plot:
+        plot(args.plot, rows)
+
+if __name__ == "__main__":
+    main()
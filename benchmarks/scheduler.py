@@ -0,0 +1,69 @@
+"""
+Work-stealing scheduler against one parallel loop per method
+
+Times computing several methods over the same synthetic record, first
+with one call to pywbgt.wbgt() per method (each with its own solar
+geometry and, for Liljegren, its own statically partitioned prange
+loop), then with pywbgt.scheduler.wbgt_tasks().
+
+Usage:
+
+    python benchmarks/scheduler.py --size 2000000
+    python benchmarks/scheduler.py --methods liljegren dimiceli --chunk-size 8192
+
+"""
+
+import argparse
+import os
+import time
+
+from pywbgt import wbgt
+from pywbgt.scheduler import CHUNK_SIZE, WorkStealingPool, wbgt_tasks
+
+from numa_scaling import inputs
+
+def per_method(methods, args):
+
+    for method in methods:
+        wbgt(method, *args)
+
+def main(argv=None):
+
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--size',       type=int, default=2**20)
+    parser.add_argument('--repeat',     type=int, default=3)
+    parser.add_argument('--chunk-size', type=int, default=CHUNK_SIZE)
+    parser.add_argument('--workers',    type=int, default=os.cpu_count())
+    parser.add_argument('--methods',    nargs='+', default=['liljegren', 'bernard', 'dimiceli', 'dimiceli_nws'])
+    args = parser.parse_args(argv)
+
+    met, _ = inputs(args.size)
+    warm   = tuple(arg[:1000] for arg in met)
+
+    def best(func):
+        func(warm)
+        times = []
+        for _ in range(args.repeat):
+            t0 = time.perf_counter()
+            func(met)
+            times.append(time.perf_counter() - t0)
+        return min(times)
+
+    with WorkStealingPool(args.workers) as pool:
+        static = best(lambda data: per_method(args.methods, data))
+        tasks  = best(lambda data: wbgt_tasks(
+            args.methods, *data, chunk_size=args.chunk_size, pool=pool,
+        ))
+        stats  = pool.stats()
+
+    print(f"points: {args.size}  methods: {' '.join(args.methods)}  workers: {args.workers}")
+    print(f"{'schedule':>14} {'seconds':>10} {'Mpts/s':>10}")
+    for name, seconds in (('per-method', static), ('work-stealing', tasks)):
+        rate = args.size * len(args.methods) / seconds / 1.0e6
+        print(f"{name:>14} {seconds:10.4f} {rate:10.2f}")
+    print(f"speedup: {static / tasks:.2f}")
+    print(f"tasks per worker: {stats['executed']}")
+    print(f"steals per worker: {stats['steals']}")
+
+if __name__ == "__main__":
+    main()
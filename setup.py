@@ -15,25 +15,48 @@ EXTS_KWARGS = dict(
     ],
 )
 
+SRC = os.path.join('src', NAME, 'src')
+
+# C kernels are included by the Cython modules, so list them to rebuild
+# the extensions when they change
+ISA_DEPENDS = [os.path.join(SRC, 'isa.h'), os.path.join(SRC, 'isa_clones.h')]
+
 # Define external extensions that must be compiled (C/Cython code)
 EXT_LILJEGREN = Extension( 
     f'{NAME}.liljegren',
     [
         os.path.join('src', NAME, 'liljegren'+EXT),
     ],
-    include_dirs = [os.path.join('src', NAME, 'src')],
+    include_dirs = [SRC],
+    depends      = [
+        os.path.join(SRC, 'liljegren_c.c'),
+        os.path.join(SRC, 'liljegren_isa.c'),
+        *ISA_DEPENDS,
+    ],
     **EXTS_KWARGS,
 )
 
 EXT_BERNARD = Extension( 
     f'{NAME}.bernard',
-    sources = [os.path.join('src', NAME, 'bernard'+EXT)],
+    sources      = [os.path.join('src', NAME, 'bernard'+EXT)],
+    include_dirs = [SRC],
+    depends      = [
+        os.path.join(SRC, 'bernard_c.c'),
+        os.path.join(SRC, 'bernard_isa.c'),
+        *ISA_DEPENDS,
+    ],
     **EXTS_KWARGS,
 )
 
 EXT_PSY_WETBULB = Extension( 
     f'{NAME}.psychrometric_wetbulb',
-    sources = [os.path.join('src', NAME, 'psychrometric_wetbulb'+EXT)],
+    sources      = [os.path.join('src', NAME, 'psychrometric_wetbulb'+EXT)],
+    include_dirs = [SRC],
+    depends      = [
+        os.path.join(SRC, 'iribarne_c.c'),
+        os.path.join(SRC, 'iribarne_isa.c'),
+        *ISA_DEPENDS,
+    ],
     **EXTS_KWARGS,
 )
 
@@ -7,10 +7,19 @@ temperature from standard meteorological variables.
 """
 
 from .constants     import METHODS
+from .parallel      import set_num_threads, get_num_threads
+from .              import parallel
+from .profiling     import profile
 from .liljegren     import wetbulb_globe as liljegrenWBGT
 from .bernard       import wetbulb_globe as bernardWBGT
 from .dimiceli      import wetbulb_globe as dimiceliWBGT
 from .dimiceli_nws  import wetbulb_globe as dimiceli_nwsWBGT
+from .              import isa
+from .batch         import wbgt_chunked
+from .ragged        import wbgt_ragged
+from .              import accessors
+from .              import tuning
+from .tuning        import autotune
 
 def wbgt( method, *args, **kwargs ):
     """
@@ -34,10 +43,14 @@ def wbgt( method, *args, **kwargs ):
         speed (Quatity) : wind speed; units of speed
 
     Keyword arguments:
-        f_db (float) : Direct beam radiation from the sun. Valid for
-            the Dimiceli and Bernard methods. Type: fraction
-        cosz (float) : Cosine of solar zenith angle. Valid for 
-            Dimiceli and Bernard methods
+        f_db (ndarray) : Fraction of solar irradiance due to the direct
+            beam. Valid for all methods. If set along with cosz, solar
+            parameters are not computed and solar is used as given, so
+            solar must already be adjusted as in the Liljegren solar
+            parameters (normalized irradiance clipped; see
+            solar_parameters(), which returns all three)
+        cosz (ndarray) : Cosine of solar zenith angle. Valid for all
+            methods; see f_db
         zspeed (Quantity) : Height of the wind speed measurment.
             Default is 10 meters
         wetbulb (str) : Name of wet bulb algorithm to use in the Dimiceli
@@ -85,6 +98,15 @@ def wbgt( method, *args, **kwargs ):
 
         args[i] = arg.metpy.quantify().data
 
+    # Tuned number of threads, unless threads have been limited
+    nthreads = tuning.threads(method)
+    if nthreads is not None and get_num_threads() == parallel.max_threads():
+        with parallel.num_threads(nthreads):
+            return _wbgt(method, *args, **kwargs)
+    return _wbgt(method, *args, **kwargs)
+
+def _wbgt( method, *args, **kwargs ):
+
     if method == 'liljegren':
         return liljegrenWBGT( *args, **kwargs )
     if method == 'bernard':
@@ -95,3 +117,6 @@ def wbgt( method, *args, **kwargs ):
         return dimiceli_nwsWBGT( *args, **kwargs )
 
     raise Exception( f'Unsupported WBGT method : {method}! Must be one of {METHODS}' )
+
+isa._init()
+tuning.load()
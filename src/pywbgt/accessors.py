@@ -0,0 +1,554 @@
+"""
+Xarray and pandas accessors
+
+Importing pywbgt registers a ``wbgt`` accessor on xarray Datasets and
+pandas DataFrames so that WBGT can be computed directly from labelled
+data:
+
+    ds.wbgt.compute(method='liljegren')
+    df.wbgt.compute(method='dimiceli', lat=35.0, lon=-80.0)
+
+Input variables are found by name, or by their CF standard_name
+attribute, and units are taken from their units attribute. Latitude,
+longitude and time are taken from the coordinates so that solar geometry
+is computed for every grid point, once per time and location rather
+than from coordinates expanded to every point. Results are returned with
+the same coordinates (or index) as the inputs. When the inputs are
+backed by dask, the computation is lazy and preserves the chunking of
+the inputs.
+
+"""
+
+import numpy
+import pandas
+from metpy.units import units
+
+from .constants import OUTPUT_UNITS
+from .solar import (
+    ELEV, PRESSURE, SOLAR_KWARGS, TEMP, sun_geocentric, sun_geometry,
+    sun_geometry_grid, adjust_solar, normsolar_clipped,
+)
+from .utils import datetime_adjust
+from . import metrics
+
+try:
+    import xarray
+except ImportError:
+    xarray = None
+
+# Candidate names and CF standard_name for each input variable
+VARIABLES = {
+    'solar'    : (
+        ('solar', 'ssrd', 'rsds', 'swdown', 'dswrf'),
+        'surface_downwelling_shortwave_flux_in_air',
+    ),
+    'pres'     : (
+        ('pres', 'sp', 'ps', 'psfc', 'pressure'),
+        'surface_air_pressure',
+    ),
+    'temp_air' : (
+        ('temp_air', 't2m', 'tas', 't2', 'temperature'),
+        'air_temperature',
+    ),
+    'temp_dew' : (
+        ('temp_dew', 'd2m', 'tdps', 'dewpoint', 'dew_point'),
+        'dew_point_temperature',
+    ),
+    'speed'    : (
+        ('speed', 'si10', 'wspd', 'sfcWind', 'wind_speed'),
+        'wind_speed',
+    ),
+}
+
+# Wind components used if no wind speed variable is found
+WIND_COMPONENTS = (
+    (('u10', 'uas', 'u'), 'eastward_wind'),
+    (('v10', 'vas', 'v'), 'northward_wind'),
+)
+
+# Dtype of the outputs of each method; float64 for any not listed
+OUTPUT_DTYPES = {
+    'liljegren' : numpy.float32,
+}
+
+COORDINATES = {
+    'time' : ('time', 'valid_time', 'datetime', 'date'),
+    'lat'  : ('lat', 'latitude'),
+    'lon'  : ('lon', 'longitude'),
+}
+
+def find_variable(data, names, standard_name, standard_names=None):
+    """
+    Find variable by name or standard_name attribute
+
+    Arguments:
+        data (Mapping) : Dataset, DataFrame, or other mapping of variables
+        names (tuple) : Candidate names of the variable
+        standard_name (str) : CF standard_name of the variable
+
+    Keyword arguments:
+        standard_names (dict) : standard_name keyed by variable name; for
+            data that do not carry per-variable attributes (i.e., DataFrame)
+
+    Returns:
+        str : Name of the variable, or None if not found
+
+    """
+
+    for name in names:
+        if name in data:
+            return name
+    for name in data:
+        if standard_names is None:
+            std_name = getattr(data[name], 'attrs', {}).get('standard_name')
+        else:
+            std_name = standard_names.get(name)
+        if std_name == standard_name:
+            return name
+    return None
+
+def output_dtype(method):
+    """Dtype of the outputs of method, as declared to dask"""
+
+    return OUTPUT_DTYPES.get(method.lower(), numpy.float64)
+
+def _axes(val, ndim):
+    """Axes along which val varies once broadcast to ndim dimensions"""
+
+    shape = (1,) * (ndim - numpy.ndim(val)) + numpy.shape(val)
+    return {axis for axis, size in enumerate(shape) if size != 1}
+
+def _broadcast(values):
+    """Read-only views of dict values broadcast against one another"""
+
+    shape = numpy.broadcast_shapes(*(numpy.shape(val) for val in values.values()))
+    return {key : numpy.broadcast_to(val, shape) for key, val in values.items()}
+
+def _geometry(time, lat, lon, ndim, geometry):
+    """
+    Cosine of solar zenith angle and Earth-Sun distance of each point
+
+    If the times vary along other dimensions than the locations (e.g., a
+    (time, lat, lon) grid), the sun position is computed once per time
+    and the zenith angle once per time and location, from the times and
+    locations as given; only the results are expanded to every point.
+    Otherwise (e.g., rows of a station table) each point is computed on
+    its own.
+
+    Arguments:
+        time (ndarray) : Datetimes
+        lat (ndarray) : Latitude (decimal)
+        lon (ndarray) : Longitude (decimal)
+        ndim (int) : Number of dimensions of the block
+        geometry (dict) : Any of SOLAR_KWARGS; see solar_parameters()
+            All values are broadcastable against one another
+
+    Returns:
+        tuple : Cosine of solar zenith angle and Earth-Sun distance (AU)
+            of each point of the block, flattened
+
+    """
+
+    when  = {'time' : time, **{key : geometry[key] for key in ('gmt', 'avg') if key in geometry}}
+    where = {
+        'lat'      : lat,
+        'lon'      : lon,
+        'elev'     : geometry.get('elev',     ELEV),
+        'pressure' : geometry.get('pressure', PRESSURE),
+        'temp'     : geometry.get('temp',     TEMP),
+    }
+    taxes = set().union(*(_axes(val, ndim) for val in when.values()))
+    saxes = set().union(*(_axes(val, ndim) for val in where.values()))
+
+    if taxes & saxes:
+        points = {key : val.ravel() for key, val in _broadcast({**when, **where}).items()}
+        return sun_geometry(
+            pandas.DatetimeIndex(points.pop('time')),
+            points.pop('lat'),
+            points.pop('lon'),
+            **points,
+        )
+
+    when  = _broadcast(when)
+    where = _broadcast(where)
+    unixtime = datetime_adjust(
+        pandas.DatetimeIndex(when['time'].ravel()),
+        when['gmt'].ravel() if 'gmt' in when else None,
+        when['avg'].ravel() if 'avg' in when else None,
+    ).values.astype('datetime64[ns]').astype(numpy.int64) / 1.0e9
+
+    geo = sun_geocentric(unixtime, 0.0)
+    cza = sun_geometry_grid(
+        geo,
+        *(numpy.ascontiguousarray(val, dtype=numpy.float64).ravel() for val in where.values()),
+        0.0,
+    )
+
+    itime, iloc = numpy.broadcast_arrays(
+        numpy.arange(unixtime.size).reshape(when['time'].shape),
+        numpy.arange(where['lat'].size).reshape(where['lat'].shape),
+    )
+    return cza[itime, iloc].ravel(), geo[0][itime].ravel()
+
+def _compute_block(
+        time, lat, lon, solar, pres, temp_air, temp_dew, speed, *arrays,
+        method=None, input_units=None, kwargs=None, array_units=None,
+    ):
+    """
+    Compute WBGT on broadcastable numpy arrays
+
+    This is the function mapped over blocks of (possibly dask-backed)
+    data. Solar geometry is computed from the times and coordinates as
+    they are (see _geometry()), so they are not expanded to the size of
+    the block. Other inputs are flattened for the 1-D algorithms, which
+    only copies those that are broadcast along some dimension of the
+    block (e.g., urban given per grid point). The inputs themselves are
+    not modified.
+
+    Arguments:
+        *arrays : Values of the keywords in array_units, broadcastable
+            against the other inputs
+
+    Keyword arguments:
+        method (str) : name of the method to use.
+        input_units (dict) : Units of the meteorological inputs
+        kwargs (dict) : All other keywords passed to wbgt()
+        array_units (dict) : Units keyed by name of the keyword of each of
+            arrays; None for values without units (e.g., urban)
+
+    Returns:
+        tuple : Arrays for each variable in OUTPUT_UNITS with the
+            broadcast shape of the inputs and the dtype given by
+            output_dtype()
+
+    """
+
+    from . import wbgt
+
+    met   = dict(zip(VARIABLES, (solar, pres, temp_air, temp_dew, speed)))
+    shape = numpy.broadcast_shapes(
+        *(numpy.shape(val) for val in (time, lat, lon, *met.values(), *arrays)),
+    )
+    size  = int(numpy.prod(shape))
+
+    kwargs = dict(kwargs or {})
+    kwargs.update(zip(array_units or {}, arrays))
+    geometry = {
+        key : numpy.asarray(kwargs.pop(key))
+        for key in SOLAR_KWARGS if kwargs.get(key) is not None
+    }
+    for name, unit in (array_units or {}).items():
+        if name in kwargs:
+            val = numpy.broadcast_to(kwargs[name], shape).ravel()
+            kwargs[name] = val if unit is None else units.Quantity(val, unit)
+
+    cza, dist = _geometry(
+        numpy.asarray(time), numpy.asarray(lat), numpy.asarray(lon),
+        len(shape), geometry,
+    )
+
+    met = {
+        var : units.Quantity(numpy.broadcast_to(val, shape).ravel(), input_units[var])
+        for var, val in met.items()
+    }
+    raw = met['solar'].to('watt/meter**2').magnitude
+    solar_adj, fdir = adjust_solar(raw, cza, dist)
+    met['solar'] = units.Quantity(solar_adj, 'watt/meter**2')
+    # The method gets adjusted solar, so clipping is counted here
+    if metrics.enabled():
+        metrics.record(
+            method.lower(),
+            normsolar_clipped=normsolar_clipped(raw, solar_adj, cza),
+        )
+
+    # Times and locations are only used for solar geometry, which the
+    # method is given, so views of the first point stand in for them
+    res = wbgt(
+        method,
+        *(numpy.broadcast_to(numpy.ravel(val)[:1], (size,)) for val in (time, lat, lon)),
+        *met.values(),
+        f_db = fdir,
+        cosz = cza,
+        **kwargs,
+    )
+
+    dtype = output_dtype(method)
+    return tuple(
+        numpy.asarray(res[var].to(unit).magnitude).astype(dtype, copy=False).reshape(shape)
+        for var, unit in OUTPUT_UNITS.items()
+    )
+
+class WBGTDatasetAccessor:
+    """
+    Compute WBGT from an xarray Dataset
+
+    Available as the ``wbgt`` attribute of any Dataset.
+
+    """
+
+    def __init__(self, dataset):
+        self._obj = dataset
+
+    def _coordinate(self, key, name=None):
+
+        obj = self._obj
+        if name is not None:
+            return obj[name]
+        for name in COORDINATES[key]:
+            if name in obj.coords or name in obj:
+                return obj[name]
+        raise Exception(f"Could not find '{key}' coordinate in Dataset!")
+
+    def variables(self, mapping=None):
+        """
+        Map WBGT input arguments to Dataset variables
+
+        Keyword arguments:
+            mapping (dict) : Explicit mapping of argument name to variable
+                name; overrides search by name and standard_name
+
+        Returns:
+            dict : DataArray for each input argument
+
+        """
+
+        mapping = mapping or {}
+        obj     = self._obj
+        out     = {}
+        for arg, (names, standard_name) in VARIABLES.items():
+            name = mapping.get(arg) or find_variable(obj, names, standard_name)
+            if name is not None:
+                out[arg] = obj[name]
+                continue
+            if arg != 'speed':
+                raise Exception(f"Could not find variable for '{arg}' in Dataset!")
+
+            comps = [
+                mapping.get(key) or find_variable(obj, *comp)
+                for key, comp in zip(('u', 'v'), WIND_COMPONENTS)
+            ]
+            if None in comps:
+                raise Exception("Could not find wind speed or components in Dataset!")
+            u, v = obj[comps[0]], obj[comps[1]]
+            if u.attrs.get('units') != v.attrs.get('units'):
+                raise Exception('Wind components must have the same units!')
+            speed = numpy.hypot(u, v)
+            speed.attrs['units'] = u.attrs.get('units')
+            out[arg] = speed
+
+        return out
+
+    def input_units(self, variables, input_units=None):
+        """
+        Units of input variables
+
+        Arguments:
+            variables (dict) : DataArray for each input argument; see
+                variables()
+
+        Keyword arguments:
+            input_units (dict) : Units keyed by argument name; override the
+                variables' units attributes
+
+        Returns:
+            dict : Units keyed by argument name
+
+        """
+
+        input_units = dict(input_units or {})
+        for arg, var in variables.items():
+            if arg in input_units:
+                continue
+            if 'units' not in var.attrs:
+                raise Exception(f"No units for '{arg}'; set 'units' attribute or input_units!")
+            input_units[arg] = var.attrs['units']
+        return input_units
+
+    def compute(
+            self,
+            method      = 'liljegren',
+            mapping     = None,
+            input_units = None,
+            time        = None,
+            lat         = None,
+            lon         = None,
+            **kwargs,
+        ):
+        """
+        Compute WBGT for all points in the Dataset
+
+        Arguments:
+            None.
+
+        Keyword arguments:
+            method (str) : name of the method to use.
+            mapping (dict) : Explicit mapping of argument name (e.g.,
+                'temp_air') to variable name. Wind components can be set
+                with the 'u' and 'v' keys
+            input_units (dict) : Units of input variables keyed by argument
+                name; overrides the variables' units attributes
+            time (str) : Name of the time coordinate
+            lat (str) : Name of the latitude coordinate
+            lon (str) : Name of the longitude coordinate
+            **kwargs : All other keywords are passed to wbgt(). DataArray
+                values (e.g., urban or zspeed on the grid) are aligned and
+                chunked with the inputs; units are taken from their units
+                attribute, if any
+
+        Returns:
+            xarray.Dataset : Output variables of the WBGT algorithm with
+                the coordinates of the input, lazy if inputs are dask arrays
+
+        """
+
+        variables   = self.variables(mapping)
+        input_units = self.input_units(variables, input_units)
+        arrays      = {
+            key : kwargs.pop(key) for key, val in list(kwargs.items())
+            if isinstance(val, xarray.DataArray)
+        }
+
+        outputs = xarray.apply_ufunc(
+            _compute_block,
+            self._coordinate('time', time),
+            self._coordinate('lat',  lat),
+            self._coordinate('lon',  lon),
+            *variables.values(),
+            *arrays.values(),
+            kwargs        = {
+                'method'      : method,
+                'input_units' : input_units,
+                'kwargs'      : kwargs,
+                'array_units' : {
+                    key : val.attrs.get('units') for key, val in arrays.items()
+                },
+            },
+            output_core_dims = [[]] * len(OUTPUT_UNITS),
+            dask             = 'parallelized',
+            output_dtypes    = [output_dtype(method)] * len(OUTPUT_UNITS),
+        )
+
+        dataset = xarray.Dataset(dict(zip(OUTPUT_UNITS, outputs)))
+        for var, unit in OUTPUT_UNITS.items():
+            dataset[var].attrs['units'] = unit
+        dataset.attrs['wbgt_method'] = method
+
+        return dataset
+
+class WBGTDataFrameAccessor:
+    """
+    Compute WBGT from a pandas DataFrame
+
+    Available as the ``wbgt`` attribute of any DataFrame. Units (and
+    optionally CF standard names) of the columns are taken from the
+    ``units`` (and ``standard_names``) entries of the DataFrame attrs,
+    dicts keyed by column name, unless given explicitly.
+
+    """
+
+    def __init__(self, frame):
+        self._obj = frame
+
+    def variables(self, mapping=None):
+        """
+        Map WBGT input arguments to DataFrame columns
+
+        Keyword arguments:
+            mapping (dict) : Explicit mapping of argument name to column
+                name; overrides search by name and standard_name
+
+        Returns:
+            dict : Column name for each input argument
+
+        """
+
+        mapping   = mapping or {}
+        std_names = self._obj.attrs.get('standard_names', {})
+        out       = {}
+        for arg, (names, standard_name) in VARIABLES.items():
+            name = (
+                mapping.get(arg) or
+                find_variable(self._obj, names, standard_name, std_names)
+            )
+            if name is None:
+                raise Exception(f"Could not find column for '{arg}' in DataFrame!")
+            out[arg] = name
+
+        return out
+
+    def _coordinate(self, key, value):
+
+        obj = self._obj
+        if value is None:
+            for name in COORDINATES[key]:
+                if name in obj:
+                    return obj[name].to_numpy()
+            if key == 'time' and isinstance(obj.index, pandas.DatetimeIndex):
+                return obj.index.to_numpy()
+            raise Exception(f"Could not find '{key}' column in DataFrame!")
+        if isinstance(value, str):
+            return obj[value].to_numpy()
+        return numpy.asarray(value)
+
+    def compute(
+            self,
+            method      = 'liljegren',
+            mapping     = None,
+            input_units = None,
+            time        = None,
+            lat         = None,
+            lon         = None,
+            **kwargs,
+        ):
+        """
+        Compute WBGT for all rows in the DataFrame
+
+        Keyword arguments:
+            method (str) : name of the method to use.
+            mapping (dict) : Explicit mapping of argument name (e.g.,
+                'temp_air') to column name
+            input_units (dict) : Units of input columns keyed by argument
+                name; overrides the DataFrame attrs
+            time (str, ndarray) : Column name, or values, of the datetimes.
+                Default is a time column or a DatetimeIndex
+            lat (str, float, ndarray) : Column name, or value(s), of latitude
+            lon (str, float, ndarray) : Column name, or value(s), of longitude
+            **kwargs : All other keywords are passed to wbgt()
+
+        Returns:
+            pandas.DataFrame : Output variables of the WBGT algorithm with
+                the same index as the input
+
+        """
+
+        columns     = self.variables(mapping)
+        col_units   = self._obj.attrs.get('units', {})
+        input_units = dict(input_units or {})
+        for arg, col in columns.items():
+            if arg in input_units:
+                continue
+            if col not in col_units:
+                raise Exception(f"No units for '{arg}'; set attrs['units'] or input_units!")
+            input_units[arg] = col_units[col]
+
+        outputs = _compute_block(
+            self._coordinate('time', time),
+            self._coordinate('lat',  lat),
+            self._coordinate('lon',  lon),
+            *(self._obj[col].to_numpy() for col in columns.values()),
+            method      = method,
+            input_units = input_units,
+            kwargs      = kwargs,
+        )
+
+        frame = pandas.DataFrame(
+            dict(zip(OUTPUT_UNITS, outputs)),
+            index = self._obj.index,
+        )
+        frame.attrs['units'] = dict(OUTPUT_UNITS)
+
+        return frame
+
+pandas.api.extensions.register_dataframe_accessor('wbgt')(WBGTDataFrameAccessor)
+if xarray is not None:
+    xarray.register_dataset_accessor('wbgt')(WBGTDatasetAccessor)
@@ -0,0 +1,220 @@
+"""
+Apache Arrow input and output
+
+Read inputs from any object exporting the Arrow C Data Interface
+(``__arrow_c_array__``) or C Stream Interface (``__arrow_c_stream__``),
+such as columns from Polars, DuckDB, or pyarrow, and return results as
+Arrow arrays.
+
+Primitive Arrow buffers are wrapped as numpy arrays without copying;
+validity bitmaps are honored by masking output where any input is null.
+Output arrays are likewise handed to Arrow without copying.
+
+Requires the pyarrow package.
+
+"""
+
+import numpy
+from pandas import DatetimeIndex
+from metpy.units import units
+
+from .constants import OUTPUT_UNITS
+
+try:
+    import pyarrow
+except ImportError:
+    pyarrow = None
+
+# Units assumed for raw input columns if not specified
+INPUT_UNITS = {
+    'solar'    : 'watt/meter**2',
+    'pres'     : 'hPa',
+    'temp_air' : 'degree_Celsius',
+    'temp_dew' : 'degree_Celsius',
+    'speed'    : 'meter/second',
+}
+
+def _check_pyarrow():
+
+    if pyarrow is None:
+        raise Exception('The pyarrow package is required for Arrow support!')
+
+def is_arrow(obj):
+    """Return True if object exports the Arrow C Data or Stream interface"""
+
+    return (
+        hasattr(obj, '__arrow_c_array__') or
+        hasattr(obj, '__arrow_c_stream__')
+    )
+
+def as_pyarrow(obj):
+    """
+    Import object into a pyarrow.Array
+
+    Objects exporting the C Data Interface are imported without copying.
+    Streams (and chunked arrays) are only copied if they contain more than
+    one (1) chunk.
+
+    """
+
+    _check_pyarrow()
+    if isinstance(obj, pyarrow.Array):
+        return obj
+    if isinstance(obj, pyarrow.ChunkedArray):
+        arr = obj
+    elif hasattr(obj, '__arrow_c_array__'):
+        return pyarrow.array(obj)
+    elif hasattr(obj, '__arrow_c_stream__'):
+        arr = pyarrow.chunked_array(obj)
+    else:
+        raise Exception(f'Object of type {type(obj)} does not export Arrow data!')
+
+    if arr.num_chunks == 1:
+        return arr.chunk(0)
+    return arr.combine_chunks()
+
+def from_arrow(obj):
+    """
+    Wrap Arrow array buffers as numpy arrays
+
+    Arguments:
+        obj : Object exporting the Arrow C Data or C Stream Interface
+
+    Returns:
+        tuple : numpy view of the values buffer and boolean array that is
+            True where values are valid; the latter is None if the array
+            has no nulls
+
+    """
+
+    arr = as_pyarrow(obj)
+    if pyarrow.types.is_timestamp(arr.type):
+        dtype = numpy.dtype(f'datetime64[{arr.type.unit}]')
+    elif pyarrow.types.is_floating(arr.type) or pyarrow.types.is_integer(arr.type):
+        dtype = numpy.dtype(arr.type.to_pandas_dtype())
+    else:
+        raise Exception(f'Unsupported Arrow type : {arr.type}')
+
+    validity, data = arr.buffers()[:2]
+    values = numpy.frombuffer(
+        data, dtype=dtype, count=arr.offset+len(arr),
+    )[arr.offset:]
+
+    if validity is None or arr.null_count == 0:
+        return values, None
+
+    valid = numpy.unpackbits(
+        numpy.frombuffer(validity, dtype=numpy.uint8),
+        count     = arr.offset+len(arr),
+        bitorder  = 'little',
+    )[arr.offset:].astype(bool)
+
+    return values, valid
+
+def to_arrow(values, valid=None):
+    """
+    Wrap numpy array as an Arrow array without copying
+
+    Arguments:
+        values (ndarray) : One (1) dimensional array of values
+
+    Keyword arguments:
+        valid (ndarray) : Boolean array that is True where values are valid
+
+    Returns:
+        pyarrow.Array
+
+    """
+
+    _check_pyarrow()
+    values = numpy.ascontiguousarray(values)
+    bitmap = None
+    if valid is not None and not valid.all():
+        bitmap = pyarrow.py_buffer(numpy.packbits(valid, bitorder='little'))
+
+    return pyarrow.Array.from_buffers(
+        pyarrow.from_numpy_dtype(values.dtype),
+        values.size,
+        [bitmap, pyarrow.py_buffer(values)],
+    )
+
+def _read(obj, unit, valid):
+    """Read Arrow column (or pass through ndarray) and combine validity"""
+
+    if not is_arrow(obj):
+        return obj, valid
+
+    values, mask = from_arrow(obj)
+    if mask is not None:
+        valid = mask if valid is None else (valid & mask)
+    if unit is None:
+        return values, valid
+    return units.Quantity(values, unit), valid
+
+def wbgt_arrow(
+        method, datetime, lat, lon,
+        solar, pres, temp_air, temp_dew, speed,
+        input_units = None,
+        **kwargs,
+    ):
+    """
+    Estimate wet bulb globe temperature from Arrow columns
+
+    Any of the inputs may be Arrow arrays (or objects exporting the
+    Arrow C Data/Stream interface); other inputs are passed to wbgt()
+    unchanged. Raw Arrow columns are tagged with units from input_units.
+
+    Arguments:
+        method (str) : name of the method to use.
+        datetime : Arrow timestamp array or pandas.DatetimeIndex
+        lat : Latitude corresponding to data values (decimal)
+        lon : Longitude corresponding to data values (decimal)
+        solar : solar irradiance
+        pres : barometric pressure
+        temp_air : air (dry bulb) temperature
+        temp_dew : Dew point temperature
+        speed : wind speed
+
+    Keyword arguments:
+        input_units (dict) : Units of raw input columns; keyed by argument
+            name. Any not given are taken from INPUT_UNITS
+        **kwargs : All other keywords are passed to wbgt()
+
+    Returns:
+        dict : pyarrow.Array for each output variable (see OUTPUT_UNITS),
+            with null where any input was null or the solver did not
+            converge, and the min_speed as Quantity
+
+    """
+
+    from . import wbgt
+
+    _check_pyarrow()
+    in_units = {**INPUT_UNITS, **(input_units or {})}
+
+    valid = None
+    datetime, valid = _read(datetime, None, valid)
+    if isinstance(datetime, numpy.ndarray):
+        datetime = DatetimeIndex(datetime)
+    lat, valid = _read(lat, None, valid)
+    lon, valid = _read(lon, None, valid)
+
+    met = {}
+    for name, arg in zip(
+            ('solar', 'pres', 'temp_air', 'temp_dew', 'speed'),
+            (solar, pres, temp_air, temp_dew, speed),
+        ):
+        met[name], valid = _read(arg, in_units[name], valid)
+
+    res = wbgt(method, datetime, lat, lon, *met.values(), **kwargs)
+
+    out = {}
+    for name, unit in OUTPUT_UNITS.items():
+        values = numpy.asarray(res[name].to(unit).magnitude)
+        mask   = numpy.isfinite(values)
+        if valid is not None:
+            mask &= valid
+        out[name] = to_arrow(values, mask)
+    out['min_speed'] = res['min_speed']
+
+    return out
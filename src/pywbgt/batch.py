@@ -0,0 +1,265 @@
+"""
+Chunked batch drivers
+
+Run the WBGT algorithms over long records (e.g., multi-decade hindcasts)
+in fixed-size chunks. Output for each chunk can be written to its own file
+and reductions, such as daily maxima, are accumulated as the chunks are
+processed. When a checkpoint file is used, the completed chunks and the
+state of the reductions are saved after each chunk so that a pre-empted
+job resumes exactly where it stopped.
+
+"""
+
+import os
+
+import numpy
+from metpy.units import units
+
+from .constants import OUTPUT_UNITS
+from .checkpoint import Checkpoint
+from . import tuning
+from .utils import atomic_savez, datetime_check
+
+CHUNK_SIZE = 2**20
+
+def iter_chunks(size, chunk_size=CHUNK_SIZE):
+    """
+    Iterate over chunk bounds
+
+    Arguments:
+        size (int) : Total number of elements
+
+    Keyword arguments:
+        chunk_size (int) : Number of elements per chunk
+
+    Returns:
+        generator : Yields tuples of (index, start, stop) for each chunk
+
+    """
+
+    for index, start in enumerate(range(0, size, chunk_size)):
+        yield index, start, min(start+chunk_size, size)
+
+def slice_arg(arg, start, stop, size):
+    """
+    Slice argument to chunk if it matches the full size
+
+    Scalars and one (1) element arrays are broadcast by the algorithms, so
+    they are passed through unchanged.
+
+    """
+
+    if getattr(arg, 'ndim', 0) > 0 and arg.shape[0] == size:
+        return arg[start:stop]
+    return arg
+
+def chunk_path(outdir, index):
+    """Path to the output file for a chunk"""
+
+    return os.path.join(outdir, f'chunk_{index:06d}.npz')
+
+def load_chunks(outdir, variables=None):
+    """
+    Load and concatenate chunk files written by wbgt_chunked()
+
+    Arguments:
+        outdir (str) : Directory containing chunk files
+
+    Keyword arguments:
+        variables (list) : Names of variables to load. Default is all
+
+    Returns:
+        dict : Concatenated variables as Quantity
+
+    """
+
+    files = sorted(
+        os.path.join(outdir, item) for item in os.listdir(outdir)
+        if item.startswith('chunk_') and item.endswith('.npz')
+    )
+    if variables is None:
+        variables = list(OUTPUT_UNITS)
+
+    data = {var : [] for var in variables}
+    for path in files:
+        with numpy.load(path) as chunk:
+            for var in variables:
+                data[var].append(chunk[var])
+
+    return {
+        var : units.Quantity(numpy.concatenate(vals), OUTPUT_UNITS[var])
+        for var, vals in data.items()
+    }
+
+def wbgt_chunked(
+        method, datetime, lat, lon,
+        solar, pres, temp_air, temp_dew, speed,
+        chunk_size = None,
+        outdir     = None,
+        checkpoint = None,
+        reductions = None,
+        max_chunks = None,
+        memory_budget = None,
+        **kwargs,
+    ):
+    """
+    Compute WBGT in chunks with optional checkpointing
+
+    Inputs are split into chunks of chunk_size elements along the first
+    dimension and each chunk is passed to wbgt(). Any keyword argument with
+    the same length as the inputs is sliced along with them.
+
+    If outdir is set, the output of each chunk is written atomically to
+    its own file so that re-running a chunk is idempotent. If checkpoint is
+    set, the index of each completed chunk and the state of all reductions
+    are saved after each chunk, and chunks completed by a previous run of
+    the same job are skipped.
+
+    Arguments:
+        method (str) : name of the method to use.
+        datetime (pandas.DatetimeIndex) : Datetime(s) corresponding to data
+        lat (ndarray) : Latitude corresponding to data values (decimal)
+        lon (ndarray) : Longitude corresponding to data values (decimal)
+        solar (Quantity) : solar irradiance; units of any power over area
+        pres (Quantity) : barometric pressure; units of pressure
+        temp_air (Quantity) : air (dry bulb) temperature; units of temperature
+        temp_dew (Quantity) : Dew point temperature; units of temperature
+        speed (Quantity) : wind speed; units of speed
+
+    Keyword arguments:
+        chunk_size (int) : Number of elements to process at a time. Default
+            is the chunk size recorded in the checkpoint when resuming,
+            else the tuned chunk size of the method (see pywbgt.tuning),
+            or CHUNK_SIZE
+        outdir (str) : Directory to write output for each chunk to
+        checkpoint (str) : Path of checkpoint file used to record and
+            resume progress. Requires outdir be set if output other than
+            reductions are needed
+        reductions (dict) : Reductions (see pywbgt.reductions) to update with
+            the output of each chunk; keyed by name
+        max_chunks (int) : Maximum number of chunks to process in this call;
+            useful for time-limited jobs. Default is to process all chunks
+        memory_budget (int) : Bytes available for the temporaries of one
+            chunk. If set, chunk_size is ignored and set by
+            pywbgt.memory.plan_chunk_size() instead; when resuming from
+            a checkpoint, the chunk size recorded in it is used
+        **kwargs : All other keywords are passed to wbgt()
+
+    Returns:
+        dict :
+            - complete : True if all chunks have been processed
+            - files : Paths to chunk files; only if outdir set
+            - reductions : Result of each reduction; keyed by name
+            - If outdir and checkpoint are NOT set, the concatenated
+              output of wbgt() is also included
+
+    """
+
+    from . import wbgt
+
+    datetime   = datetime_check(datetime)
+    size       = datetime.shape[0]
+    reductions = reductions or {}
+    ckpt       = None if checkpoint is None else Checkpoint(checkpoint)
+    planned    = None if ckpt is None else ckpt.config.get('chunk_size')
+    if memory_budget is not None or chunk_size is None:
+        # The plan and the tuned size depend on the host, so a resumed job
+        # uses the chunk size chosen when it started
+        if planned is not None:
+            chunk_size = planned
+        elif memory_budget is not None:
+            from .memory import plan_chunk_size
+            chunk_size = min(
+                plan_chunk_size(method, memory_budget, **kwargs), max(size, 1),
+            )
+        else:
+            chunk_size = tuning.chunk_size(method, CHUNK_SIZE)
+    if outdir is not None:
+        os.makedirs(outdir, exist_ok=True)
+
+    if ckpt is not None:
+        ckpt.check_config(method=method.lower(), size=size, chunk_size=chunk_size)
+        for name, red in reductions.items():
+            if name in ckpt.states and hasattr(red, 'flush'):
+                red.load(ckpt.states[name], ckpt.flushed(name))
+            elif name in ckpt.states:
+                red.load(ckpt.states[name])
+
+    args    = (lat, lon, solar, pres, temp_air, temp_dew, speed)
+    results = {var : [] for var in OUTPUT_UNITS}
+    nchunks = 0
+    for index, start, stop in iter_chunks(size, chunk_size):
+        if ckpt is not None and ckpt.done(index):
+            continue
+        if max_chunks is not None and nchunks >= max_chunks:
+            break
+
+        chunk_dt = datetime[start:stop]
+        chunk    = [slice_arg(arg, start, stop, size) for arg in args]
+        res      = wbgt(
+            method,
+            chunk_dt,
+            *chunk,
+            **{
+                key : slice_arg(val, start, stop, size)
+                for key, val in kwargs.items()
+            },
+        )
+
+        if outdir is not None:
+            atomic_savez(
+                chunk_path(outdir, index),
+                start = start,
+                stop  = stop,
+                **{
+                    var : numpy.asarray(res[var].to(unit).magnitude)
+                    for var, unit in OUTPUT_UNITS.items()
+                },
+            )
+        elif ckpt is None:
+            for var, unit in OUTPUT_UNITS.items():
+                results[var].append(res[var].to(unit).magnitude)
+
+        for red in reductions.values():
+            red.update(chunk_dt, chunk[0], chunk[1], res)
+
+        # Chunk file is written before checkpoint is saved; if job stops
+        # between the two, the chunk is recomputed and file rewritten
+        if ckpt is not None:
+            flushed = {
+                name : red.flush() for name, red in reductions.items()
+                if hasattr(red, 'flush')
+            }
+            ckpt.mark(
+                index,
+                {
+                    name : red.state(flushed=False) if name in flushed else red.state()
+                    for name, red in reductions.items()
+                },
+                flushed,
+            )
+        nchunks += 1
+
+    nchunks_total = -(-size // chunk_size)
+    complete = (
+        len(ckpt.completed) == nchunks_total if ckpt is not None else
+        max_chunks is None or nchunks >= nchunks_total
+    )
+
+    out = {
+        'complete'   : complete,
+        'reductions' : {name : red.result() for name, red in reductions.items()},
+    }
+    if outdir is not None:
+        out['files'] = [
+            chunk_path(outdir, index)
+            for index, _, _ in iter_chunks(size, chunk_size)
+            if os.path.isfile(chunk_path(outdir, index))
+        ]
+    elif ckpt is None and nchunks > 0:
+        out.update({
+            var : units.Quantity(numpy.concatenate(vals), OUTPUT_UNITS[var])
+            for var, vals in results.items()
+        })
+
+    return out
@@ -16,111 +16,50 @@ Bernard, T.E., & Pourmoghani, M. (1999).
 from cython.parallel import prange
 import numpy
 
-from libc.math cimport fabs, exp, pow, log10
+from libc.math cimport fabs, exp, pow, log10, isnan
 cimport numpy
 cimport cython
+cimport openmp
+
+from .cbernard cimport *
 
 from metpy.units import units
 from metpy.calc import saturation_vapor_pressure
 
-from .constants import SIGMA, MIN_SPEED
-from .solar import solar_parameters
+from .constants import MIN_SPEED
+from .solar import solar_parameters, normsolar_clipped
 from .calc import loglaw
+from .profiling import THREAD_PAD, profiled, record_region, stage, threads_enabled
+from .metrics import COUNTERS, record_slots, speed_clipped
+from .metrics import enabled as metrics_enabled, record as metrics_record
 
 cdef:
-    int   MAX_ITER  = 50
+    int   _THREAD_PAD = THREAD_PAD
+    int   _POINTS     = list(COUNTERS).index('points')
+    int   _MISSING    = list(COUNTERS).index('missing')
+    int   _TG_FAILED  = list(COUNTERS).index('tglobe_failed')
     float CtoK      = 273.15
-    float CONVERGE  = 1.0E-3
-    float ALPHA_SFC = 0.00
-    float EPSILON   = 0.98 # Emissivity of black globe
-    float NaN       = numpy.nan
-    float SIGMAB    = SIGMA
 
 @cython.cdivision(True)
 cdef double emis_atm(double esat) nogil:
 
     return 0.575 * pow(esat, 0.143)
   
-@cython.cdivision(True)
-cdef double _conv_heat_trans_coeff(
-        double temp_g, double temp_air, double speed,
-    ) nogil:
-    """
-    Convective heat transfer coefficient
-
-    Compute the convective heat transfer coefficient
-    from Bernard method
-
-    Arguments:
-        temp_g : Globe temperature; Kelvin
-        temp_air : Air temperature; Kelvin
-        speed : Wind speed; meter/second
-
-    Returns:
-        convective heat transfer coefficient
-
+cdef inline void _count_point(numpy.int64_t *slot, double temp_g, double inputs) noexcept nogil:
     """
+    Count a point in the metrics slot of a thread
 
-    cdef double coeff, delta_t = temp_g-temp_air
-    coeff = pow(
-        pow(10.9*pow(speed, 0.566), 3) + 
-        pow(0.35 + 1.77*pow(fabs(delta_t), 0.25), 3),
-        1.0/3.0
-    )
-    if (delta_t < 0.0): 
-        return -coeff
-    return coeff
-
-@cython.cdivision(True)
-cdef double _globe_temperature(
-        double temp_air,
-        double esat,
-        double speed,
-        double pres,
-        float solar, 
-        float f_db,
-        float cosz,
-    ) nogil:
-    """
-    Determine globe temperature through iterative solver
-
-    Aruguments:
-        temp_air (double) : Ambient temperature; Celsius
-        esat (double) : Atmospheric vapor pressure;
-            i.e., esat of dew point temperature; hPa
-        speed (ndarray) : Wind speed; meters/second
-        pres (ndarray) : Atmospheric pressure; hPa
-        solar (ndarray) : Radiant heat flux incident on the globe;
-            currently assuming this to be the solar irradiance; W/m**2
-
-    Keyword arguments:
-        None.
-
-    Returns:
-        ndarray : Globe temperature determined through iterative solver
+    A NaN globe temperature counts as missing if the sum of the inputs
+    is not finite, else as a failed solve; see pywbgt.metrics
 
     """
 
-    temp_air = temp_air + CtoK
-    cdef:
-        int ii
-        double h, temp_g_new, temp_g = temp_air
-
-    for ii in range( MAX_ITER ):
-        h = _conv_heat_trans_coeff( temp_g, temp_air, speed )
-        temp_g_new = pow(
-            #(1.0+emis_atm(esat))/2.0*temp_air**4 +
-            temp_air**4 +
-            solar/SIGMAB/2.0 * (1 + f_db*(1/2.0/cosz - 1.0) + ALPHA_SFC) -
-            h/EPSILON/SIGMAB * (temp_g-temp_air),
-            0.25
-        )
-
-        if fabs(temp_g_new-temp_g) < CONVERGE: 
-            return temp_g_new
-        temp_g = 0.9*temp_g + 0.1*temp_g_new
-
-    return NaN
+    slot[_POINTS] += 1
+    if isnan(temp_g):
+        if isnan(inputs):
+            slot[_MISSING] += 1
+        else:
+            slot[_TG_FAILED] += 1
 
 def conv_heat_trans_coeff( temp_g, temp_air, speed ):
     """
@@ -227,17 +166,100 @@ def factor_e( speed ):
     # Where wind > 1.0, keep values of e, else compute e and return values
     return numpy.where( speed > 1.0, -0.1, fac_e )
 
+# OpenMP schedule of the solver loop; see set_openmp_schedule()
+OPENMP_SCHEDULES = {
+    'static'  : openmp.omp_sched_static,
+    'dynamic' : openmp.omp_sched_dynamic,
+    'guided'  : openmp.omp_sched_guided,
+}
+cdef openmp.omp_sched_t _schedule_kind  = openmp.omp_sched_static
+cdef int                _schedule_chunk = 0
+
+def get_openmp_schedule():
+    """OpenMP schedule kind and chunk size of the globe temperature solver loop"""
+
+    for name, kind in OPENMP_SCHEDULES.items():
+        if kind == _schedule_kind:
+            return name, _schedule_chunk
+
+def set_openmp_schedule(kind='static', int chunk=0):
+    """
+    Set the OpenMP schedule of the globe temperature solver loop
+
+    The default, static with no chunk size, splits the elements into one
+    contiguous block per thread. Dynamic or guided schedules balance
+    elements that take many solver iterations across threads, at the cost
+    of scheduling overhead. The setting applies to calls from all threads.
+
+    Arguments:
+        kind (str) : One of OPENMP_SCHEDULES
+        chunk (int) : Chunk size; zero (0) for the OpenMP default
+
+    Returns:
+        tuple : Previous kind and chunk size
+
+    """
+
+    global _schedule_kind, _schedule_chunk
+
+    if kind not in OPENMP_SCHEDULES:
+        raise Exception( f'Unsupported OpenMP schedule : {kind}! Must be one of {list(OPENMP_SCHEDULES)}' )
+    previous = get_openmp_schedule()
+    _schedule_kind  = OPENMP_SCHEDULES[kind]
+    _schedule_chunk = max(chunk, 0)
+    return previous
+
+# ISA level of the solver; see pywbgt.isa
+def _isa_level():
+    return bernard_isa_level()
+
+def _isa_select(int level):
+    return bernard_isa_select(level) == 0
+
+class _LoopCounters:
+    """
+    Per-thread counters of the globe temperature solver loops
+
+    Elements, solver iterations, and busy time of each thread for load
+    imbalance (see profiling.profile()), and failed points (see
+    pywbgt.metrics), THREAD_PAD elements apart. Arrays that are not
+    enabled have one element and are not written by the loops.
+
+    """
+
+    def __init__(self, stats, counting):
+
+        nthread       = openmp.omp_get_max_threads()
+        nstat         = nthread * _THREAD_PAD if stats else 1
+        self.stats    = stats
+        self.counting = counting
+        self.elems    = numpy.zeros( nstat, dtype = numpy.int64 )
+        self.iters    = numpy.zeros( nstat, dtype = numpy.int64 )
+        self.busy     = numpy.zeros( nstat, dtype = numpy.float64 )
+        self.counts   = numpy.zeros( nthread * _THREAD_PAD if counting else 1, dtype = numpy.int64 )
+
+    def arrays(self):
+
+        return self.elems, self.iters, self.busy, self.counts
+
+    def record(self):
+
+        if self.stats:
+            record_region('Tg', self.elems, self.iters, self.busy)
+        if self.counting:
+            record_slots('bernard', self.counts)
+
 @cython.boundscheck(False)  # Deactivate bounds checking
 @cython.wraparound(False)   # Deactivate negative indexing.
 @cython.initializedcheck(False)   # Deactivate initialization checking.
 def _globe_temperature_64(
-        double [::1] temp_air,
-        double [::1] esat,
-        double [::1] speed,
-        double [::1] pres,
-        float  [::1] solar,
-        float  [::1] f_db,
-        float  [::1] cosz,
+        const double [::1] temp_air,
+        const double [::1] esat,
+        const double [::1] speed,
+        const double [::1] pres,
+        const float  [::1] solar,
+        const float  [::1] f_db,
+        const float  [::1] cosz,
     ): 
     """
     Compute Tg (64-bit)
@@ -249,10 +271,25 @@ def _globe_temperature_64(
     temp_g = numpy.empty(temp_air.size, dtype=numpy.float64)
     cdef:
         Py_ssize_t i, size = temp_air.size
+        bint   stats = threads_enabled()
+        bint   counting = metrics_enabled()
+        int    tid, it
+        double t0, tg
+        numpy.int64_t [::1] countView
+        numpy.int64_t [::1] statElemView
+        numpy.int64_t [::1] statIterView
+        double        [::1] statBusyView
         double [::1] temp_g_view   = temp_g 
 
-    for i in prange( size, nogil=True ):
-        temp_g_view[i] = _globe_temperature( 
+    counters = _LoopCounters(stats, counting)
+    statElemView, statIterView, statBusyView, countView = counters.arrays()
+
+    openmp.omp_set_schedule( _schedule_kind, _schedule_chunk )
+    for i in prange( size, nogil=True, schedule='runtime' ):
+        it = 0
+        if stats:
+            t0 = openmp.omp_get_wtime()
+        tg = _globe_temperature( 
             temp_air[i],
             esat[i],
             speed[i],
@@ -260,20 +297,34 @@ def _globe_temperature_64(
             solar[i],
             f_db[i],
             cosz[i],
-        ) - CtoK
+            &it if stats else NULL,
+        )
+        temp_g_view[i] = tg - CtoK
+        if counting:
+            _count_point(
+                &countView[openmp.omp_get_thread_num() * _THREAD_PAD],
+                tg,
+                temp_air[i] + esat[i] + speed[i] + pres[i] + solar[i] + f_db[i] + cosz[i],
+            )
+        if stats:
+            tid = openmp.omp_get_thread_num() * _THREAD_PAD
+            statElemView[tid] += 1
+            statIterView[tid] += it
+            statBusyView[tid] += openmp.omp_get_wtime() - t0
+    counters.record()
     return temp_g
 
 @cython.boundscheck(False)  # Deactivate bounds checking
 @cython.wraparound(False)   # Deactivate negative indexing.
 @cython.initializedcheck(False)   # Deactivate initialization checking.
 def _globe_temperature_32(
-        float [::1] temp_air,
-        float [::1] esat,
-        float [::1] speed,
-        float [::1] pres,
-        float [::1] solar,
-        float [::1] f_db,
-        float [::1] cosz,
+        const float [::1] temp_air,
+        const float [::1] esat,
+        const float [::1] speed,
+        const float [::1] pres,
+        const float [::1] solar,
+        const float [::1] f_db,
+        const float [::1] cosz,
     ): 
     """
     Compute Tg (32-bit)
@@ -286,10 +337,25 @@ def _globe_temperature_32(
     temp_g = numpy.empty(temp_air.size, dtype=numpy.float32)
     cdef:
         Py_ssize_t i, size = temp_air.size
+        bint   stats = threads_enabled()
+        bint   counting = metrics_enabled()
+        int    tid, it
+        double t0, tg
+        numpy.int64_t [::1] countView
+        numpy.int64_t [::1] statElemView
+        numpy.int64_t [::1] statIterView
+        double        [::1] statBusyView
         float [::1] temp_g_view = temp_g 
 
-    for i in prange( size, nogil=True ):
-        temp_g_view[i] = <float>_globe_temperature( 
+    counters = _LoopCounters(stats, counting)
+    statElemView, statIterView, statBusyView, countView = counters.arrays()
+
+    openmp.omp_set_schedule( _schedule_kind, _schedule_chunk )
+    for i in prange( size, nogil=True, schedule='runtime' ):
+        it = 0
+        if stats:
+            t0 = openmp.omp_get_wtime()
+        tg = _globe_temperature( 
             <double>temp_air[i],
             <double>esat[i],
             <double>speed[i],
@@ -297,7 +363,21 @@ def _globe_temperature_32(
             solar[i],
             f_db[i],
             cosz[i],
-        ) - CtoK
+            &it if stats else NULL,
+        )
+        temp_g_view[i] = <float>tg - CtoK
+        if counting:
+            _count_point(
+                &countView[openmp.omp_get_thread_num() * _THREAD_PAD],
+                tg,
+                <double>temp_air[i] + esat[i] + speed[i] + pres[i] + solar[i] + f_db[i] + cosz[i],
+            )
+        if stats:
+            tid = openmp.omp_get_thread_num() * _THREAD_PAD
+            statElemView[tid] += 1
+            statIterView[tid] += it
+            statBusyView[tid] += openmp.omp_get_wtime() - t0
+    counters.record()
     return temp_g
 
 @cython.boundscheck(False)  # Deactivate bounds checking
@@ -382,10 +462,10 @@ def psychrometric_wetbulb(temp_air, vapor_air=None, temp_dew=None, relhum=None):
 @cython.wraparound(False)   # Deactivate negative indexing.
 @cython.initializedcheck(False)   # Deactivate initialization checking.
 def _natural_wetbulb_64(
-        double [::1] temp_air,
-        double [::1] temp_psy,
-        double [::1] temp_g,
-        double [::1] speed,
+        const double [::1] temp_air,
+        const double [::1] temp_psy,
+        const double [::1] temp_g,
+        const double [::1] speed,
     ):
     """
     Compute Tnwb (64-bit)
@@ -415,10 +495,10 @@ def _natural_wetbulb_64(
 @cython.wraparound(False)   # Deactivate negative indexing.
 @cython.initializedcheck(False)   # Deactivate initialization checking.
 def _natural_wetbulb_32(
-        float [::1] temp_air,
-        float [::1] temp_psy,
-        float [::1] temp_g,
-        float [::1] speed,
+        const float [::1] temp_air,
+        const float [::1] temp_psy,
+        const float [::1] temp_g,
+        const float [::1] speed,
     ):
     """
     Compute Tnwb (32-bit)
@@ -487,6 +567,7 @@ def natural_wetbulb( temp_air, temp_psy, temp_g, speed ):
         return _natural_wetbulb_32(temp_air, temp_psy, temp_g, speed)
     raise Exception('Must imput floating-point values')
 
+@profiled('bernard')
 def wetbulb_globe(
         datetime, lat, lon,
         solar, pres, temp_air, temp_dew, speed,
@@ -534,48 +615,64 @@ def wetbulb_globe(
     if zspeed is None:
         zspeed = units.Quantity( 10.0, 'meter' )
 
+    size     = temp_air.size
+    counting = metrics_enabled()
+    solar    = solar.to('watt/m**2').magnitude
     if (f_db is None) or (cosz is None):
-        solar = solar_parameters( 
-            datetime, lat, lon, solar.to('watt/m**2').magnitude, **kwargs,
-        )
+        raw = solar
+        with stage('solar', size=size):
+            solar = solar_parameters( 
+                datetime, lat, lon, solar, **kwargs,
+            )
+        if counting:
+            metrics_record('bernard', normsolar_clipped=normsolar_clipped(raw, solar[0], solar[1]))
         if cosz is None:
             cosz = solar[1]
         if f_db is None:
             f_db = solar[2]
         solar = solar[0]
 
-    vapor_air = saturation_vapor_pressure(temp_dew)
-    temp_air  = temp_air.to( 'degree_Celsius' ).magnitude
-    pres      = pres.to(   'hPa'            ).magnitude
+    with stage('units', size=size):
+        vapor_air = saturation_vapor_pressure(temp_dew)
+        temp_air  = temp_air.to( 'degree_Celsius' ).magnitude
+        pres      = pres.to(   'hPa'            ).magnitude
 
     if min_speed is None:
         min_speed = MIN_SPEED
  
-    speed = numpy.clip(
-        loglaw(speed, zspeed),
-        min_speed,
-        None,
-    ).to('meter/second')
-
-    temp_g = globe_temperature(
-        temp_air, 
-        vapor_air.to('hPa').magnitude,
-        speed.magnitude,
-        pres,
-        solar,
-        f_db,
-        cosz,
-    )
-    temp_psy = psychrometric_wetbulb(
-        temp_air,
-        vapor_air = vapor_air.to('kPa').magnitude,
-    )
-    temp_nwb = natural_wetbulb(
-        temp_air,
-        temp_psy,
-        temp_g,
-        speed.magnitude
-    )
+    with stage('wind', size=size):
+        speed = numpy.clip(
+            loglaw(speed, zspeed),
+            min_speed,
+            None,
+        ).to('meter/second')
+    if counting:
+        metrics_record('bernard', speed_clipped=speed_clipped(
+            speed.magnitude, min_speed.to('meter/second').magnitude,
+        ))
+
+    with stage('Tg', size=size):
+        temp_g = globe_temperature(
+            temp_air, 
+            vapor_air.to('hPa').magnitude,
+            speed.magnitude,
+            pres,
+            solar,
+            f_db,
+            cosz,
+        )
+    with stage('Tpsy', size=size):
+        temp_psy = psychrometric_wetbulb(
+            temp_air,
+            vapor_air = vapor_air.to('kPa').magnitude,
+        )
+    with stage('Tnwb', size=size):
+        temp_nwb = natural_wetbulb(
+            temp_air,
+            temp_psy,
+            temp_g,
+            speed.magnitude
+        )
 
     return {
         'Tg'        : units.Quantity(temp_g,   'degree_Celsius'),
@@ -0,0 +1,24 @@
+"""
+Header definitions for C imports
+
+To make the Bernard C-code available to
+cython, must create header information
+
+"""
+
+cdef extern from "src/bernard_isa.c" nogil:
+    double _globe_temperature "bernard_globe_temperature"(
+        double temp_air,
+        double esat,
+        double speed,
+        double pres,
+        float solar,
+        float f_db,
+        float cosz,
+        int *niter,
+    )
+
+    # Runtime selection of the ISA level of the solver above; see
+    # src/isa.h
+    int bernard_isa_level()
+    int bernard_isa_select(int level)
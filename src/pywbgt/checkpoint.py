@@ -0,0 +1,159 @@
+"""
+Checkpoint files for long-running batch jobs
+
+A checkpoint records which chunks of a job have been completed along
+with the running state of any reductions. The file is a small npz
+archive that is rewritten atomically after every chunk, so a job that
+is pre-empted at any point can be resumed from the last completed chunk.
+
+Reductions that flush completed days (see pywbgt.reductions) only keep
+their open days in the checkpoint file; each flush is written once to a
+segment file next to it, so the work of saving the checkpoint does not
+grow with the length of the job.
+
+"""
+
+import os
+
+import numpy
+
+from .utils import atomic_savez
+
+class Checkpoint:
+    """
+    Progress of a chunked batch job
+
+    Arguments:
+        path (str) : Path of the checkpoint file. If the file exists,
+            progress is loaded from it
+
+    """
+
+    def __init__(self, path):
+        self.path      = path
+        self.config    = {}
+        self.completed = set()
+        self.states    = {}
+        self.segments  = {}
+        if os.path.isfile(path):
+            self.load()
+
+    def segment_path(self, name, index):
+        """Path of a segment of flushed state of reduction name"""
+
+        root = self.path[:-4] if self.path.endswith('.npz') else self.path
+        return f'{root}.{name}.{index:06d}.npz'
+
+    def load(self):
+        """Load progress from the checkpoint file"""
+
+        self.config    = {}
+        self.completed = set()
+        self.states    = {}
+        self.segments  = {}
+        with numpy.load(self.path, allow_pickle=False) as data:
+            for key in data.files:
+                group, _, name = key.partition('/')
+                if group == 'completed':
+                    self.completed = set(data[key].tolist())
+                elif group == 'config':
+                    self.config[name] = data[key].item()
+                elif group == 'segments':
+                    self.segments[name] = int(data[key])
+                elif group == 'state':
+                    red, _, name = name.partition('/')
+                    self.states.setdefault(red, {})[name] = data[key]
+
+    def save(self):
+        """Atomically write progress to the checkpoint file"""
+
+        arrays = {
+            'completed' : numpy.asarray(sorted(self.completed), dtype=numpy.int64),
+        }
+        for key, val in self.config.items():
+            arrays[f'config/{key}'] = numpy.asarray(val)
+        for red, count in self.segments.items():
+            arrays[f'segments/{red}'] = numpy.asarray(count, dtype=numpy.int64)
+        for red, state in self.states.items():
+            for key, val in state.items():
+                arrays[f'state/{red}/{key}'] = numpy.asarray(val)
+
+        atomic_savez(self.path, **arrays)
+
+    def check_config(self, **config):
+        """
+        Validate (or set) the configuration of the job
+
+        A checkpoint can only be used to resume the job that created it;
+        if the checkpoint has no configuration (i.e., it is new) then the
+        configuration is set.
+
+        Keyword arguments:
+            **config : Scalar values describing the job; e.g., input size
+                and chunk size
+
+        """
+
+        if not self.config:
+            self.config = config
+            return
+
+        for key, val in config.items():
+            if self.config.get(key) != val:
+                raise Exception(
+                    f"Checkpoint '{self.path}' does not match job: "
+                    f"{key} = {self.config.get(key)} in checkpoint, {val} in job"
+                )
+
+    def done(self, index):
+        """Return True if chunk index has been completed"""
+
+        return index in self.completed
+
+    def flushed(self, name):
+        """
+        Flushed state of a reduction, in the order it was flushed
+
+        Arguments:
+            name (str) : Name of the reduction
+
+        Returns:
+            list : Dict of arrays of each segment
+
+        """
+
+        out = []
+        for index in range(self.segments.get(name, 0)):
+            with numpy.load(self.segment_path(name, index), allow_pickle=False) as data:
+                out.append({key : data[key] for key in data.files})
+        return out
+
+    def mark(self, index, states=None, flushed=None):
+        """
+        Mark chunk as completed and save checkpoint
+
+        Arguments:
+            index (int) : Index of the completed chunk
+
+        Keyword arguments:
+            states (dict) : Running state of reductions after the chunk
+                was completed; keyed by reduction name
+            flushed (dict) : State flushed by reductions after the chunk
+                was completed, which states leave out; keyed by reduction
+                name. Each non-empty one is written to a new segment
+
+        """
+
+        # Segments are written before the checkpoint that counts them; if
+        # the job stops between the two, the segment is rewritten
+        for name, state in (flushed or {}).items():
+            if not any(numpy.size(val) for val in state.values()):
+                continue
+            count = self.segments.get(name, 0)
+            atomic_savez(self.segment_path(name, count), **state)
+            self.segments[name] = count + 1
+
+        self.completed.add(int(index))
+        if states is not None:
+            self.states = states
+        self.save()
@@ -6,7 +6,7 @@ cython, muse create hearder information
 
 """
 
-cdef extern from "src/liljegren_c.c" nogil:
+cdef extern from "src/liljegren_isa.c" nogil:
     # Expose define to cython
     float _D_GLOBE       "D_GLOBE"
     float _MIN_SPEED     "MIN_SPEED"
@@ -37,7 +37,7 @@ cdef extern from "src/liljegren_c.c" nogil:
         float min_speed,
     )
 
-    float Tglobe(
+    float Tglobe "liljegren_Tglobe"(
         float Tair,
         float rh,
         float Pair,
@@ -48,7 +48,7 @@ cdef extern from "src/liljegren_c.c" nogil:
         float d_globe,
     )
 
-    float Twb(
+    float Twb "liljegren_Twb"(
         float Tair,
         float rh,
         float Pair,
@@ -58,3 +58,36 @@ cdef extern from "src/liljegren_c.c" nogil:
         float cza,
         int rad,
     )
+
+    float Tglobe_guess "liljegren_Tglobe_guess"(
+        float Tair,
+        float rh,
+        float Pair,
+        float speed,
+        float solar,
+        float fdir,
+        float cza,
+        float d_globe,
+        float guess,
+        int *niter,
+    )
+
+    float Twb_guess "liljegren_Twb_guess"(
+        float Tair,
+        float rh,
+        float Pair,
+        float speed,
+        float solar,
+        float fdir,
+        float cza,
+        int rad,
+        float guess,
+        int *niter,
+    )
+
+    # Runtime selection of the ISA level of the solvers above; see
+    # src/isa.h
+    int liljegren_isa_level()
+    int liljegren_isa_select(int level)
+    int pywbgt_isa_supported(int level)
+    int pywbgt_isa_best()
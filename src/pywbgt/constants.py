@@ -15,5 +15,15 @@ METHODS = [
     'liljegren',
 ]
 
+# Units of the variables returned by the WBGT algorithms
+OUTPUT_UNITS = {
+    'Tg'    : 'degree_Celsius',
+    'Tpsy'  : 'degree_Celsius',
+    'Tnwb'  : 'degree_Celsius',
+    'Twbg'  : 'degree_Celsius',
+    'solar' : 'watt/meter**2',
+    'speed' : 'meter/second',
+}
+
 MIN_SPEED          = units.Quantity(2.0, 'knots')
 DIMICELI_MIN_SPEED = units.Quantity(1690.0, 'meter per hour')
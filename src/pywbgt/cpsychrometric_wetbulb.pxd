@@ -0,0 +1,21 @@
+"""
+Header definitions for C imports
+
+To make the Iribarne C-code available to
+cython, must create header information
+
+"""
+
+cdef extern from "src/iribarne_isa.c" nogil:
+    float _iribarne_wb "iribarne_wetbulb"(
+        float temp_a,
+        float temp_d,
+        float pres,
+        int maxfev,
+        float xtol,
+    )
+
+    # Runtime selection of the ISA level of the solver above; see
+    # src/isa.h
+    int iribarne_isa_level()
+    int iribarne_isa_select(int level)
@@ -15,10 +15,12 @@ from metpy.units import units
 from metpy.calc import relative_humidity_from_dewpoint as relative_humidity 
 
 from .constants import SIGMA, MIN_SPEED, DIMICELI_MIN_SPEED
-from .solar import solar_parameters
+from .solar import solar_parameters, normsolar_clipped
+from . import metrics
 from .psychrometric_wetbulb import stull
 from .natural_wetbulb import malchaire, hunter_minyard, nws_boyer
 from .calc import loglaw
+from .profiling import profiled, stage
 
 def adjust_speed_2m(speed, zspeed, min_speed=MIN_SPEED):
     """
@@ -231,6 +233,7 @@ def psychrometric_wetbulb( temp_air, temp_dew ):
          (-33.000e-6 - 5.000e-6*temp_air -  1.000e-7*temp_air**2) * relhum**2
     )
 
+@profiled('dimiceli')
 def wetbulb_globe(
         datetime, lat, lon,
         solar, pres, temp_air, temp_dew, speed,
@@ -287,64 +290,87 @@ def wetbulb_globe(
     if zspeed is None:
         zspeed = units.Quantity(10.0, 'meter')
 
+    size = temp_air.size
+
     # Compute psychrometric wetbulb before stripping temperature units
-    wb_method = kwargs.get('wetbulb', 'DIMICELI').upper()
-    if wb_method == 'DIMICELI':
-        temp_psy = psychrometric_wetbulb(temp_air, temp_dew)
-    elif wb_method == 'STULL':
-        temp_psy = stull(temp_air, temp_dew)
-    else:
-        raise Exception( f"Invalid option for 'wetbulb' : {wb_method}" )
-
-    solar     = solar.to(   'watt/m**2'     ).magnitude
-    pres      = pres.to(    'hPa'           ).magnitude
-    temp_air  = temp_air.to('degree_Celsius').magnitude
-    temp_dew  = temp_dew.to('degree_Celsius').magnitude
-    speed2m, min_speed = adjust_speed_2m(
-        speed,
-        zspeed,
-        min_speed = min_speed,
-    )
+    with stage('Tpsy', size=size):
+        wb_method = kwargs.get('wetbulb', 'DIMICELI').upper()
+        if wb_method == 'DIMICELI':
+            temp_psy = psychrometric_wetbulb(temp_air, temp_dew)
+        elif wb_method == 'STULL':
+            temp_psy = stull(temp_air, temp_dew)
+        else:
+            raise Exception( f"Invalid option for 'wetbulb' : {wb_method}" )
+
+    with stage('units', size=size):
+        solar     = solar.to(   'watt/m**2'     ).magnitude
+        pres      = pres.to(    'hPa'           ).magnitude
+        temp_air  = temp_air.to('degree_Celsius').magnitude
+        temp_dew  = temp_dew.to('degree_Celsius').magnitude
+
+    with stage('wind', size=size):
+        speed2m, min_speed = adjust_speed_2m(
+            speed,
+            zspeed,
+            min_speed = min_speed,
+        )
+
+    counting = metrics.enabled()
+    if counting:
+        metrics.record(
+            'dimiceli',
+            points        = size,
+            speed_clipped = metrics.speed_clipped(
+                speed2m.to('meter/second').magnitude,
+                min_speed.to('meter/second').magnitude,
+            ),
+        )
 
     if (f_db is None) or (cosz is None):
-        solar = solar_parameters(datetime, lat, lon, solar, **kwargs )
+        raw = solar
+        with stage('solar', size=size):
+            solar = solar_parameters(datetime, lat, lon, solar, **kwargs )
+        if counting:
+            metrics.record('dimiceli', normsolar_clipped=normsolar_clipped(raw, solar[0], solar[1]))
         if cosz is None:
             cosz = solar[1]
         if f_db is None:
             f_db = solar[2]
         solar = solar[0]
 
-    temp_g = globe_temperature(
-        temp_air,
-        temp_dew,
-        pres,
-        speed2m.to('meter per hour').magnitude,
-        solar,
-        f_db,
-        cosz,
-    )
-
-    nwb_method = kwargs.get('natural_wetbulb', 'HUNTER_MINYARD').upper()
-    if nwb_method == 'HUNTER_MINYARD':
-        temp_nwb  = hunter_minyard(
-            temp_psy,
-            solar*f_db,
-            speed2m.to('meter per second').magnitude,
-        )
-    elif nwb_method == 'MALCHAIRE':
-        temp_nwb  = malchaire( temp_air, temp_dew, temp_psy, temp_g )
-    elif nwb_method == 'BOYER':
-        temp_nwb  = nws_boyer(
+    with stage('Tg', size=size):
+        temp_g = globe_temperature(
             temp_air,
-            temp_psy,
-            solar*f_db,
-            speed2m.to('meter per second').magnitude,
-        )
-    else:
-        raise Exception(
-            f"Unsupported value for 'natural_wetbulb' : {nwb_method}"
+            temp_dew,
+            pres,
+            speed2m.to('meter per hour').magnitude,
+            solar,
+            f_db,
+            cosz,
         )
 
+    with stage('Tnwb', size=size):
+        nwb_method = kwargs.get('natural_wetbulb', 'HUNTER_MINYARD').upper()
+        if nwb_method == 'HUNTER_MINYARD':
+            temp_nwb  = hunter_minyard(
+                temp_psy,
+                solar*f_db,
+                speed2m.to('meter per second').magnitude,
+            )
+        elif nwb_method == 'MALCHAIRE':
+            temp_nwb  = malchaire( temp_air, temp_dew, temp_psy, temp_g )
+        elif nwb_method == 'BOYER':
+            temp_nwb  = nws_boyer(
+                temp_air,
+                temp_psy,
+                solar*f_db,
+                speed2m.to('meter per second').magnitude,
+            )
+        else:
+            raise Exception(
+                f"Unsupported value for 'natural_wetbulb' : {nwb_method}"
+            )
+
     return {
         'Tg'        : units.Quantity(temp_g, 'degree_Celsius'),
         'Tpsy'      : units.Quantity(temp_psy, 'degree_Celsius'),
@@ -0,0 +1,184 @@
+"""
+Forecast ensembles
+
+Ensemble members share a grid and time axis, so the datetime
+adjustment, solar geometry, and point metadata are the same for every
+member. Here they are computed once, and only the member dependent
+terms are computed per member. For the Liljegren method, members and
+points are iterated over together inside the kernel.
+
+Ensemble statistics (e.g., mean, spread, probability of exceeding a
+threshold) can be returned instead of, or as well as, every member.
+
+"""
+
+import numpy
+from metpy.units import units
+
+from .constants import OUTPUT_UNITS
+from .liljegren import wetbulb_globe_ensemble
+from .solar import SOLAR_KWARGS, sun_geometry, adjust_solar_members, normsolar_clipped
+from . import metrics
+from .utils import datetime_check
+
+# Statistics over the member axis
+STATISTICS = {
+    'mean'   : numpy.nanmean,
+    'spread' : numpy.nanstd,
+    'min'    : numpy.nanmin,
+    'max'    : numpy.nanmax,
+    'median' : numpy.nanmedian,
+}
+
+def _members(val, nmember, npoint):
+    """Broadcast Quantity to (nmember, npoint)"""
+
+    return units.Quantity(
+        numpy.broadcast_to(val.magnitude, (nmember, npoint)),
+        val.units,
+    )
+
+def ensemble_statistics(res, statistics=None, thresholds=None):
+    """
+    Statistics over the member axis of ensemble output
+
+    Arguments:
+        res (dict) : Output of wbgt_ensemble() with members
+
+    Keyword arguments:
+        statistics (list) : Names of statistics to compute; see STATISTICS
+        thresholds (dict) : Thresholds (Quantity) keyed by output variable;
+            the fraction of members exceeding each threshold is computed
+
+    Returns:
+        dict :
+            - One dict per statistic, of Quantity keyed by output variable
+            - exceedance : Fraction of members exceeding each threshold,
+              with shape (nthreshold, npoint), keyed by output variable
+
+    """
+
+    out = {}
+    for name in statistics or ():
+        if name not in STATISTICS:
+            raise Exception(f'Unsupported ensemble statistic : {name}! Must be one of {list(STATISTICS)}')
+        out[name] = {
+            var : units.Quantity(STATISTICS[name](res[var].magnitude, axis=0), res[var].units)
+            for var in OUTPUT_UNITS
+        }
+
+    if thresholds:
+        out['exceedance'] = {}
+        for var, thres in thresholds.items():
+            vals  = res[var].magnitude
+            thres = numpy.atleast_1d(thres.to(res[var].units).magnitude)
+            valid = numpy.sum(numpy.isfinite(vals), axis=0)
+            count = numpy.stack([
+                numpy.sum(vals > thr, axis=0) for thr in thres
+            ])
+            with numpy.errstate(invalid='ignore', divide='ignore'):
+                out['exceedance'][var] = numpy.where(valid > 0, count / valid, numpy.nan)
+
+    return out
+
+def wbgt_ensemble(
+        method, datetime, lat, lon,
+        solar, pres, temp_air, temp_dew, speed,
+        members    = True,
+        statistics = None,
+        thresholds = None,
+        **kwargs,
+    ):
+    """
+    Estimate wet bulb globe temperature for an ensemble
+
+    Meteorological inputs have a leading member axis, with shape
+    (nmember, npoint), or are broadcastable to it (e.g., a deterministic
+    solar field with shape (npoint,)). Datetime, location, and metadata
+    are given once per point, as for wbgt().
+
+    Arguments:
+        method (str) : name of the method to use.
+        datetime (pandas.DatetimeIndex) : Datetime of each point
+        lat (ndarray) : Latitude of each point (decimal)
+        lon (ndarray) : Longitude of each point (decimal)
+        solar (Quantity) : solar irradiance; units of any power over area
+        pres (Quantity) : barometric pressure; units of pressure
+        temp_air (Quantity) : air (dry bulb) temperature; units of temperature
+        temp_dew (Quantity) : Dew point temperature; units of temperature
+        speed (Quantity) : wind speed; units of speed
+
+    Keyword arguments:
+        members (bool) : If set (default), return the output of every
+            member. Unset to return only statistics
+        statistics (list) : Names of statistics over members to return;
+            see STATISTICS. E.g., ['mean', 'spread']
+        thresholds (dict) : Thresholds keyed by output variable for which
+            the fraction of members exceeding them is returned.
+            E.g., {'Twbg' : units.Quantity([28, 31], 'degC')}
+        **kwargs : All other keywords are passed to the method; see wbgt()
+
+    Returns:
+        dict :
+            - Same as pywbgt.wbgt() with values of shape (nmember, npoint),
+              if members is set
+            - Statistics and exceedance; see ensemble_statistics()
+
+    """
+
+    from . import wbgt
+
+    method   = method.lower()
+    datetime = datetime_check(datetime)
+    npoint   = datetime.size
+    nmember  = max(numpy.ndim(val.magnitude) == 2 and val.shape[0] or 1
+                   for val in (solar, pres, temp_air, temp_dew, speed))
+
+    lat = numpy.broadcast_to(numpy.asarray(lat, dtype=numpy.float64), (npoint,)).copy()
+    lon = numpy.broadcast_to(numpy.asarray(lon, dtype=numpy.float64), (npoint,)).copy()
+
+    # Member invariant terms, computed once
+    geometry   = {key : kwargs.pop(key) for key in SOLAR_KWARGS if key in kwargs}
+    cza, dist  = sun_geometry(datetime, lat, lon, **geometry)
+    solar      = _members(solar.to('watt/m**2'), nmember, npoint)
+    solar_adj, fdir = adjust_solar_members(
+        numpy.ascontiguousarray(solar.magnitude, dtype=numpy.float64), cza, dist,
+    )
+    if metrics.enabled():
+        metrics.record(method, normsolar_clipped=normsolar_clipped(solar.magnitude, solar_adj, cza))
+    pres, temp_air, temp_dew, speed = (
+        _members(val, nmember, npoint) for val in (pres, temp_air, temp_dew, speed)
+    )
+
+    if method == 'liljegren':
+        res = wetbulb_globe_ensemble(
+            solar_adj, fdir, cza,
+            pres, temp_air, temp_dew, speed,
+            **kwargs,
+        )
+    else:
+        out = [
+            wbgt(
+                method, datetime, lat, lon,
+                units.Quantity(solar_adj[m], 'watt/m**2'),
+                pres[m], temp_air[m], temp_dew[m], speed[m],
+                f_db = fdir[m],
+                cosz = cza,
+                **kwargs,
+            )
+            for m in range(nmember)
+        ]
+        res = {
+            var : units.Quantity(
+                numpy.stack([item[var].to(unit).magnitude for item in out]),
+                unit,
+            )
+            for var, unit in OUTPUT_UNITS.items()
+        }
+        res['min_speed'] = out[0].get('min_speed')
+
+    stats = ensemble_statistics(res, statistics, thresholds)
+    if not members:
+        res = {'min_speed' : res['min_speed']}
+    res.update(stats)
+    return res
@@ -0,0 +1,298 @@
+"""
+Shared-memory process pool for methods without a parallel kernel
+
+The Dimiceli methods, and the psychrometric wet bulb of the Bernard
+method, are written in numpy and run on a single core. This executor
+splits the points across a pool of worker processes. Inputs are copied
+once into a shared memory block and outputs are written by the workers
+directly into another, so no arrays are pickled; only the names of the
+blocks and the bounds of each worker's slice are sent.
+
+Solar geometry is computed in the calling process with the parallel
+numba kernel and shared with the workers, so workers only run the
+numpy parts of the algorithm.
+
+"""
+
+import os
+from concurrent.futures import ProcessPoolExecutor
+from multiprocessing import get_context, resource_tracker
+from multiprocessing.shared_memory import SharedMemory
+
+import numpy
+from pandas import DatetimeIndex
+from metpy.units import units
+
+from .constants import OUTPUT_UNITS
+from .solar import SOLAR_KWARGS, solar_parameters, normsolar_clipped
+from .utils import datetime_check
+from . import metrics
+
+# Methods with kernels that are already parallel; run in calling process
+PARALLEL_METHODS = ('liljegren',)
+
+ALIGN = 64
+
+class SharedArrays:
+    """
+    Several arrays packed into one shared memory block
+
+    Arguments:
+        arrays (dict) : Arrays to copy into the block, keyed by name. If
+            None, the block is attached to using name and spec
+
+    Keyword arguments:
+        name (str) : Name of existing block to attach to
+        spec (list) : Layout of existing block; see the spec attribute
+
+    """
+
+    def __init__(self, arrays=None, name=None, spec=None):
+
+        if arrays is not None:
+            spec, offset = [], 0
+            for key, arr in arrays.items():
+                arr = numpy.ascontiguousarray(arr)
+                spec.append((key, offset, arr.dtype.str, arr.shape))
+                offset += -(-arr.nbytes // ALIGN) * ALIGN
+            self.shm  = SharedMemory(create=True, size=max(offset, 1))
+            self.spec = spec
+            for key, arr in arrays.items():
+                self[key][...] = arr
+        else:
+            self.shm  = SharedMemory(name=name)
+            self.spec = spec
+
+    @property
+    def name(self):
+        return self.shm.name
+
+    def __getitem__(self, key):
+        for name, offset, dtype, shape in self.spec:
+            if name == key:
+                return numpy.ndarray(shape, dtype, buffer=self.shm.buf, offset=offset)
+        raise KeyError(key)
+
+    def keys(self):
+        return [item[0] for item in self.spec]
+
+    def close(self, unlink=False):
+        """Close block; all views of the block must have been deleted"""
+
+        self.shm.close()
+        if unlink:
+            self.shm.unlink()
+
+def _init_worker():
+    """Keep each worker to one (1) thread; the pool provides the parallelism"""
+
+    from .parallel import set_num_threads
+
+    set_num_threads(1)
+
+def _run_slice(method, inputs, outputs, start, stop, in_units, kwargs):
+    """Compute WBGT for a slice of points in a worker process"""
+
+    from . import wbgt
+
+    shm_in  = SharedArrays(name=inputs[0],  spec=inputs[1])
+    shm_out = SharedArrays(name=outputs[0], spec=outputs[1])
+    try:
+        min_speed = _compute_slice(
+            wbgt, method, shm_in, shm_out, start, stop, in_units, kwargs,
+        )
+    finally:
+        shm_in.close()
+        shm_out.close()
+
+    return min_speed
+
+def _compute_slice(wbgt, method, shm_in, shm_out, start, stop, in_units, kwargs):
+
+    args = {}
+    for key in shm_in.keys():
+        arr = shm_in[key][start:stop]
+        if key == 'datetime':
+            arr = DatetimeIndex(arr.view('datetime64[ns]'))
+        elif in_units.get(key) is not None:
+            arr = units.Quantity(arr, in_units[key])
+        args[key] = arr
+
+    res = wbgt(
+        method,
+        *(args.pop(key) for key in ('datetime', 'lat', 'lon', *INPUT_ORDER)),
+        **args,
+        **kwargs,
+    )
+
+    out = shm_out['out']
+    for i, (var, unit) in enumerate(OUTPUT_UNITS.items()):
+        out[i, start:stop] = res[var].to(unit).magnitude
+
+    return res.get('min_speed')
+
+INPUT_ORDER = ('solar', 'pres', 'temp_air', 'temp_dew', 'speed')
+
+class SharedMemoryExecutor:
+    """
+    Process pool for WBGT methods without a parallel kernel
+
+    Workers are started once and can be reused for many calls; use as a
+    context manager, or call shutdown() when done.
+
+    Keyword arguments:
+        max_workers (int) : Number of worker processes. Default is the
+            number of CPUs
+        mp_context (str) : Multiprocessing start method. Default is
+            'spawn', as the OpenMP runtime is not safe to fork once started
+
+    """
+
+    def __init__(self, max_workers=None, mp_context='spawn'):
+
+        # Start resource tracker before the workers so they share it and
+        # do not unlink blocks they attach to when they exit
+        resource_tracker.ensure_running()
+
+        self.max_workers = max_workers or os.cpu_count()
+        self._pool = ProcessPoolExecutor(
+            self.max_workers,
+            mp_context  = get_context(mp_context),
+            initializer = _init_worker,
+        )
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.shutdown()
+
+    def shutdown(self):
+        """Stop the worker processes"""
+
+        self._pool.shutdown()
+
+    def wbgt(
+            self, method, datetime, lat, lon,
+            solar, pres, temp_air, temp_dew, speed,
+            ntasks = None,
+            **kwargs,
+        ):
+        """
+        Estimate wet bulb globe temperature using the process pool
+
+        Same arguments and return values as pywbgt.wbgt(). Keywords that
+        are arrays with one value per point are shared with the workers
+        along with the inputs; all other keywords are passed unchanged.
+
+        Keyword arguments:
+            ntasks (int) : Number of slices to split points into. Default
+                is the number of workers
+            **kwargs : All other keywords are passed to wbgt()
+
+        """
+
+        from . import wbgt
+
+        if method.lower() in PARALLEL_METHODS:
+            return wbgt(
+                method, datetime, lat, lon,
+                solar, pres, temp_air, temp_dew, speed,
+                **kwargs,
+            )
+
+        datetime = datetime_check(datetime)
+        size     = datetime.size
+
+        def full(arr):
+            return numpy.broadcast_to(numpy.asarray(arr, dtype=numpy.float64), (size,))
+
+        # Solar geometry is computed here, in parallel, and shared
+        solar_kwargs = {key : kwargs.pop(key) for key in SOLAR_KWARGS if key in kwargs}
+        if kwargs.get('cosz') is None or kwargs.get('f_db') is None:
+            raw = numpy.array(full(solar.to('watt/m**2').magnitude))
+            solar_adj, cza, fdir = solar_parameters(
+                datetime, full(lat), full(lon), raw, **solar_kwargs,
+            )
+            # Workers get adjusted solar, so clipping is counted here
+            if metrics.enabled():
+                metrics.record(
+                    method.lower(),
+                    normsolar_clipped=normsolar_clipped(raw, solar_adj, cza),
+                )
+            solar = units.Quantity(solar_adj, 'watt/m**2')
+            kwargs['cosz'] = cza
+            kwargs['f_db'] = fdir
+
+        arrays   = {
+            'datetime' : datetime.values.astype('datetime64[ns]').view(numpy.int64),
+            'lat'      : full(lat),
+            'lon'      : full(lon),
+        }
+        in_units = {}
+        for key, val in zip(INPUT_ORDER, (solar, pres, temp_air, temp_dew, speed)):
+            arrays[key], in_units[key] = full(val.magnitude), str(val.units)
+        for key in list(kwargs):
+            val = kwargs[key]
+            if numpy.ndim(getattr(val, 'magnitude', val)) == 1 and numpy.size(val) == size:
+                if hasattr(val, 'units'):
+                    in_units[key] = str(val.units)
+                    val = val.magnitude
+                arrays[key] = numpy.asarray(val)
+                del kwargs[key]
+
+        shm_in  = SharedArrays(arrays)
+        shm_out = SharedArrays({
+            'out' : numpy.full((len(OUTPUT_UNITS), size), numpy.nan),
+        })
+        try:
+            ntasks  = max(min(ntasks or self.max_workers, size), 1)
+            bounds  = numpy.linspace(0, size, ntasks+1).astype(int)
+            futures = [
+                self._pool.submit(
+                    _run_slice,
+                    method,
+                    (shm_in.name,  shm_in.spec),
+                    (shm_out.name, shm_out.spec),
+                    int(start), int(stop),
+                    in_units,
+                    kwargs,
+                )
+                for start, stop in zip(bounds[:-1], bounds[1:])
+                if stop > start
+            ]
+            min_speed = [future.result() for future in futures][0]
+            out       = shm_out['out'].copy()
+        finally:
+            shm_in.close(unlink=True)
+            shm_out.close(unlink=True)
+
+        res = {
+            var : units.Quantity(out[i], unit)
+            for i, (var, unit) in enumerate(OUTPUT_UNITS.items())
+        }
+        res['min_speed'] = min_speed
+        return res
+
+def wbgt_processes(method, *args, max_workers=None, **kwargs):
+    """
+    Estimate WBGT using a temporary SharedMemoryExecutor
+
+    Convenience function for single calls; reuse a SharedMemoryExecutor
+    when making many calls, as starting the workers takes time.
+
+    Arguments:
+        method (str) : name of the method to use.
+        *args : All other arguments are passed to SharedMemoryExecutor.wbgt()
+
+    Keyword arguments:
+        max_workers (int) : Number of worker processes
+        **kwargs : All other keywords are passed to SharedMemoryExecutor.wbgt()
+
+    Returns:
+        dict : Same as pywbgt.wbgt()
+
+    """
+
+    with SharedMemoryExecutor(max_workers) as executor:
+        return executor.wbgt(method, *args, **kwargs)
@@ -0,0 +1,130 @@
+"""
+CPU instruction set (ISA) level of the compiled kernels
+
+The C kernels of the Liljegren solvers, the Bernard globe temperature
+solver, and the Iribarne wet bulb solver are compiled for several ISA
+levels within their extensions: the baseline of the platform (SSE2 on
+x86-64), AVX2 with FMA, and AVX-512 (see src/isa.h). On import, the best
+level supported by the CPU is used, so wheels stay portable without
+giving up newer instructions. The level can be queried and overridden:
+
+    from pywbgt import isa
+
+    isa.isa_supported()        # e.g., ['baseline', 'avx2', 'avx512']
+    isa.get_isa()              # level in use
+    isa.set_isa('baseline')    # or 'auto' for the best supported
+
+or set with the PYWBGT_ISA environment variable before import.
+
+Solar geometry is compiled by numba the first time it is called, for the
+CPU it runs on. PYWBGT_ISA also sets the CPU model numba compiles for
+(unless NUMBA_CPU_NAME is set), but set_isa() cannot change it once the
+kernels are compiled.
+
+"""
+
+import os
+import platform
+import threading
+import warnings
+
+import numba
+
+ISA_LEVELS  = ('baseline', 'avx2', 'avx512')
+ENVIRONMENT = 'PYWBGT_ISA'
+
+# CPU model numba compiles for at each level; no extra features are
+# enabled beyond those of the model
+NUMBA_CPUS = {
+    'baseline' : 'x86-64',
+    'avx2'     : 'haswell',
+    'avx512'   : 'skylake-avx512',
+}
+
+_lock = threading.Lock()
+
+def _kernels():
+    """Extensions with multi-ISA kernels"""
+
+    from . import bernard, liljegren, psychrometric_wetbulb
+
+    return (liljegren, bernard, psychrometric_wetbulb)
+
+def isa_supported():
+    """ISA levels of the kernels that this CPU can run, lowest first"""
+
+    from . import liljegren
+
+    return [name for i, name in enumerate(ISA_LEVELS) if liljegren._isa_supported(i)]
+
+def get_isa():
+    """ISA level of the kernels in use"""
+
+    from . import liljegren
+
+    return ISA_LEVELS[liljegren._isa_level()]
+
+def set_isa(name='auto'):
+    """
+    Set the ISA level of the compiled kernels
+
+    The level is switched for all kernels while holding a lock, so
+    concurrent calls of set_isa() cannot leave the kernels at different
+    levels. Each kernel switches atomically: a solver call in progress
+    on another thread finishes with the level it started with. The
+    setting applies to the whole process.
+
+    Arguments:
+        name (str) : One of ISA_LEVELS, or 'auto' for the best supported
+
+    Returns:
+        str : Previous level
+
+    """
+
+    from . import liljegren
+
+    name = name.lower()
+    if name == 'auto':
+        level = liljegren._isa_best()
+    elif name in ISA_LEVELS:
+        level = ISA_LEVELS.index(name)
+    else:
+        raise Exception( f'Unknown ISA level : {name}! Must be one of {ISA_LEVELS} or auto' )
+    if not liljegren._isa_supported(level):
+        raise Exception( f'ISA level not supported by this CPU : {name}! Supported are {isa_supported()}' )
+
+    with _lock:
+        previous = get_isa()
+        for kernel in _kernels():
+            kernel._isa_select(level)
+    return previous
+
+def _numba_cpu(name):
+    """
+    Compile the numba kernels for an ISA level
+
+    Only has an effect before numba compiles its first function, and
+    only on x86-64; NUMBA_CPU_NAME takes precedence.
+
+    """
+
+    if name not in NUMBA_CPUS or numba.config.CPU_NAME is not None:
+        return
+    if platform.machine().lower() not in ('x86_64', 'amd64'):
+        return
+    numba.config.CPU_NAME     = NUMBA_CPUS[name]
+    numba.config.CPU_FEATURES = ''
+
+def _init():
+    """Set the level from the environment; called when pywbgt is imported"""
+
+    name = os.environ.get(ENVIRONMENT, 'auto').lower()
+    try:
+        set_isa(name)
+    except Exception as err:
+        warnings.warn(f'Ignoring {ENVIRONMENT} : {err}')
+        set_isa('auto')
+        return
+    if name != 'auto':
+        _numba_cpu(name)
@@ -0,0 +1,299 @@
+"""
+Lazy WBGT on dask arrays
+
+Build a dask graph whose tasks call the compiled kernels directly on
+each block, rather than forcing computation or relying on hand-written
+map_blocks glue. The numba and Cython kernels release the GIL, so blocks
+run concurrently under the threaded scheduler.
+
+Solar geometry is the most expensive part of each block that does not
+depend on the meteorological inputs. Its location independent part is
+cached per time slice, so all blocks sharing a time slice reuse it, and
+the zenith angle of each block is cached by time slice and spatial
+extent, so blocks that differ only along other dimensions reuse it too.
+
+Each block limits the number of OpenMP and numba threads it uses so
+that concurrently running blocks do not oversubscribe the cores.
+
+"""
+
+import threading
+from collections import OrderedDict
+from contextlib import contextmanager
+
+import numpy
+from pandas import DatetimeIndex
+from metpy.units import units
+
+from .constants import OUTPUT_UNITS
+from .parallel import max_threads, num_threads
+from .solar import (
+    ELEV, PRESSURE, TEMP, sun_geocentric, sun_geometry_grid, adjust_solar,
+    normsolar_clipped,
+)
+from .utils import datetime_adjust
+from . import metrics
+
+try:
+    import dask.array as da
+    from dask.base import tokenize
+except ImportError:
+    da = None
+
+# Units assumed for inputs that are not Quantity
+INPUT_UNITS = {
+    'solar'    : 'watt/meter**2',
+    'pres'     : 'hPa',
+    'temp_air' : 'degree_Celsius',
+    'temp_dew' : 'degree_Celsius',
+    'speed'    : 'meter/second',
+}
+
+class LRUCache:
+    """
+    Thread-safe least recently used cache
+
+    Keyword arguments:
+        maxsize (int) : Maximum number of entries
+
+    """
+
+    def __init__(self, maxsize=128):
+        self.maxsize = maxsize
+        self._data   = OrderedDict()
+        self._lock   = threading.Lock()
+
+    def __len__(self):
+        return len(self._data)
+
+    def get(self, key, func):
+        """
+        Return cached value for key, calling func() to create it if missing
+
+        func is called without holding the lock; if two threads miss on
+        the same key both compute it and the last one is kept.
+
+        """
+
+        with self._lock:
+            if key in self._data:
+                self._data.move_to_end(key)
+                return self._data[key]
+
+        value = func()
+        with self._lock:
+            self._data[key] = value
+            while len(self._data) > self.maxsize:
+                self._data.popitem(last=False)
+        return value
+
+    def clear(self):
+        with self._lock:
+            self._data.clear()
+
+# Geocentric sun position keyed by time slice, and cosine of zenith angle
+# keyed by time slice and spatial extent
+GEOCENTRIC_CACHE = LRUCache(256)
+GEOMETRY_CACHE   = LRUCache(64)
+
+_active      = 0
+_active_lock = threading.Lock()
+
+@contextmanager
+def _block_budget(threads):
+    """Thread budget for a block; shared among running blocks if None"""
+
+    global _active
+
+    with _active_lock:
+        _active += 1
+        nactive  = _active
+    if threads is None:
+        threads = max(max_threads() // nactive, 1)
+    try:
+        with num_threads(threads):
+            yield
+    finally:
+        with _active_lock:
+            _active -= 1
+
+def _geometry(dt_token, loc_token, tbounds, sbounds, unixtime, lat, lon):
+    """Cached cosine of zenith angle and Earth-Sun distance for a block"""
+
+    geo = GEOCENTRIC_CACHE.get(
+        (dt_token, tbounds),
+        lambda: sun_geocentric(unixtime, 0.0),
+    )
+    cza = GEOMETRY_CACHE.get(
+        (dt_token, loc_token, tbounds, sbounds),
+        lambda: sun_geometry_grid(
+            geo, lat, lon,
+            numpy.full(lat.size, ELEV),
+            numpy.full(lat.size, PRESSURE),
+            numpy.full(lat.size, TEMP),
+            0.0,
+        ),
+    )
+    return cza, geo[0]
+
+def _wbgt_block(
+        solar, pres, temp_air, temp_dew, speed,
+        block_info = None,
+        method     = None,
+        datetime   = None,
+        dt_token   = None,
+        lat        = None,
+        lon        = None,
+        loc_token  = None,
+        in_units   = None,
+        threads    = None,
+        kwargs     = None,
+    ):
+    """Compute WBGT for one block; returns outputs stacked on axis 0"""
+
+    from . import wbgt
+
+    loc     = block_info[0]['array-location']
+    tbounds = tuple(loc[0])
+    sbounds = tuple(tuple(bounds) for bounds in loc[1:])
+    space   = tuple(slice(*bounds) for bounds in sbounds)
+
+    shape = solar.shape
+    ntime = shape[0]
+    blat  = numpy.ascontiguousarray(lat[space], dtype=numpy.float64).ravel()
+    blon  = numpy.ascontiguousarray(lon[space], dtype=numpy.float64).ravel()
+    dates = datetime[slice(*tbounds)]
+    size  = ntime * blat.size
+
+    with _block_budget(threads):
+        cza, dist = _geometry(
+            dt_token, loc_token, tbounds, sbounds,
+            dates.astype('datetime64[ns]').astype(numpy.int64) / 1.0e9,
+            blat, blon,
+        )
+        cza  = cza.ravel()
+        dist = numpy.repeat(dist, blat.size)
+
+        met = dict(zip(INPUT_UNITS, (solar, pres, temp_air, temp_dew, speed)))
+        met = {
+            var : units.Quantity(numpy.asarray(val, dtype=numpy.float64).ravel(), in_units[var])
+            for var, val in met.items()
+        }
+        raw = met['solar'].to('watt/meter**2').magnitude
+        solar_adj, fdir = adjust_solar(raw, cza, dist)
+        met['solar'] = units.Quantity(solar_adj, 'watt/meter**2')
+        # The method gets adjusted solar, so clipping is counted here
+        if metrics.enabled():
+            metrics.record(
+                method.lower(),
+                normsolar_clipped=normsolar_clipped(raw, solar_adj, cza),
+            )
+
+        res = wbgt(
+            method,
+            DatetimeIndex(numpy.repeat(dates, blat.size)),
+            numpy.tile(blat, ntime),
+            numpy.tile(blon, ntime),
+            *met.values(),
+            f_db = fdir,
+            cosz = cza,
+            **kwargs,
+        )
+
+    return numpy.stack([
+        numpy.broadcast_to(
+            numpy.asarray(res[var].to(unit).magnitude, dtype=numpy.float32),
+            (size,),
+        ).reshape(shape)
+        for var, unit in OUTPUT_UNITS.items()
+    ])
+
+def wbgt_dask(
+        method, datetime, lat, lon,
+        solar, pres, temp_air, temp_dew, speed,
+        input_units = None,
+        threads     = None,
+        gmt         = None,
+        avg         = None,
+        **kwargs,
+    ):
+    """
+    Lazily estimate wet bulb globe temperature on dask arrays
+
+    The first dimension of the meteorological inputs is time; any other
+    dimensions are spatial. All inputs are broadcast against one another
+    and the chunks of the result are those of the broadcast inputs.
+
+    Arguments:
+        method (str) : name of the method to use.
+        datetime (pandas.DatetimeIndex) : Datetime of each element along
+            the first (time) dimension
+        lat (ndarray) : Latitude; broadcastable to the spatial dimensions
+        lon (ndarray) : Longitude; broadcastable to the spatial dimensions
+        solar : solar irradiance
+        pres : barometric pressure
+        temp_air : air (dry bulb) temperature
+        temp_dew : Dew point temperature
+        speed : wind speed
+            Meteorological inputs may be dask or numpy arrays, or Quantity
+            wrapping either
+
+    Keyword arguments:
+        input_units (dict) : Units of inputs that are not Quantity; keyed
+            by argument name. Any not given are taken from INPUT_UNITS
+        threads (int) : Number of OpenMP/numba threads each block may use.
+            Default is to share the cores among the blocks running at the
+            time a block starts
+        gmt (float) : LST-GMT difference  (hours; negative in USA)
+        avg (float) : averaging time of the meteorological inputs (minutes)
+        **kwargs : All other keywords are passed to wbgt() for every block,
+            so must be scalars
+
+    Returns:
+        dict : Lazy dask array, as Quantity, for each variable in
+            OUTPUT_UNITS
+
+    """
+
+    if da is None:
+        raise Exception('The dask package is required for lazy computation!')
+
+    in_units = {**INPUT_UNITS, **(input_units or {})}
+    arrays   = []
+    for var, arg in zip(INPUT_UNITS, (solar, pres, temp_air, temp_dew, speed)):
+        if hasattr(arg, 'units'):
+            in_units[var] = str(arg.units)
+            arg = arg.magnitude
+        arrays.append(da.asarray(arg))
+
+    arrays = da.broadcast_arrays(*arrays)
+    arrays = [arr.rechunk(arrays[0].chunks) for arr in arrays]
+    shape  = arrays[0].shape
+
+    datetime = datetime_adjust(DatetimeIndex(datetime), gmt, avg).values
+    if datetime.size != shape[0]:
+        raise Exception('Size mismatch between datetime and first dimension of inputs!')
+    lat = numpy.broadcast_to(numpy.asarray(lat, dtype=numpy.float64), shape[1:])
+    lon = numpy.broadcast_to(numpy.asarray(lon, dtype=numpy.float64), shape[1:])
+
+    stacked = da.map_blocks(
+        _wbgt_block,
+        *arrays,
+        dtype     = numpy.float32,
+        chunks    = ((len(OUTPUT_UNITS),),) + arrays[0].chunks,
+        new_axis  = 0,
+        method    = method,
+        datetime  = datetime,
+        dt_token  = tokenize(datetime),
+        lat       = lat,
+        lon       = lon,
+        loc_token = tokenize(lat, lon),
+        in_units  = in_units,
+        threads   = threads,
+        kwargs    = kwargs,
+    )
+
+    return {
+        var : units.Quantity(stacked[i], unit)
+        for i, (var, unit) in enumerate(OUTPUT_UNITS.items())
+    }
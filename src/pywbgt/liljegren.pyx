@@ -2,10 +2,11 @@ from cython.parallel import prange
 import numpy
 
 #from libc.stdio cimport printf
-from libc.math cimport fmaxf
+from libc.math cimport fmaxf, fminf, expf, isnan, NAN
 
 cimport numpy
 cimport cython
+cimport openmp
 
 from metpy.units import units
 from metpy.calc import relative_humidity_from_dewpoint as rhTd
@@ -20,7 +21,433 @@ LILJEGREN_NORMSOLAR_MAX = _NORMSOLAR_MAX
 LILJEGREN_SOLAR_CONST   = _SOLAR_CONST
 
 from .constants import MIN_SPEED
+from .profiling import THREAD_PAD, profiled, record_region, stage, threads_enabled
+from .metrics import COUNTERS, record_slots
+from .metrics import enabled as metrics_enabled, record as metrics_record
+
+cdef int _THREAD_PAD = THREAD_PAD
+
+# Flags of a point returned by _wetbulb_globe_point_warm()
+cdef enum:
+    _POINT_TG_FAILED        = 1
+    _POINT_TNWB_FAILED      = 2
+    _POINT_FAILED           = 3
+    _POINT_MISSING          = 4
+    _POINT_SPEED_CLIPPED    = 8
+    _POINT_NORMSOLAR_CLIPPED = 16
+
+# Slots of the metrics counters; see pywbgt.metrics
+cdef:
+    int _POINTS         = list(COUNTERS).index('points')
+    int _MISSING        = list(COUNTERS).index('missing')
+    int _TG_FAILED      = list(COUNTERS).index('tglobe_failed')
+    int _TNWB_FAILED    = list(COUNTERS).index('twb_failed')
+    int _SPEED_CLIPPED  = list(COUNTERS).index('speed_clipped')
+    int _SOLAR_CLIPPED  = list(COUNTERS).index('normsolar_clipped')
+
+# Default minimum speed for the scalar path; see wetbulb_globe()
+LILJEGREN_DEFAULT_MIN_SPEED = max(
+    MIN_SPEED,
+    LILJEGREN_MIN_SPEED,
+).to('meter/second').magnitude
 from .solar import solar_parameters as sparms
+from .solar import solar_parameters_ragged as sparms_ragged
+from .solar import normsolar_clipped
+
+@cython.cdivision(True)
+cdef int _wetbulb_globe_point_warm(
+        float temp_air,
+        float relhum,
+        float pres,
+        float speed,
+        float zspeed,
+        float dT,
+        int   urban,
+        float solar,
+        float fdir,
+        float cza,
+        float min_speed,
+        float d_globe,
+        float *out,
+        Py_ssize_t stride,
+        float tg_guess,
+        float tnwb_guess,
+        int *niter,
+    ) noexcept nogil:
+    """
+    Compute WBGT at a single point, starting from initial guesses
+
+    Estimates the 2m wind speed and then solves for globe and natural
+    wet bulb temperature. If both solvers converge, the globe, 
+    psychrometric wet bulb, natural wet bulb, and wet bulb-globe
+    temperatures, solar irradiance, and 2m wind speed are written to out,
+    with stride elements between each value.
+
+    Arguments:
+        temp_air : Air temperature; Kelvin
+        relhum : Relative humidity; fraction
+        pres : Barometric pressure; hPa
+        speed : Wind speed; m/s
+        zspeed : Height of wind speed measurement; meter
+        dT : Vertical temperature difference; degree Celsius
+        urban : Urban (1) or rural (0) flag
+        solar : Adjusted solar irradiance; W/m**2
+        fdir : Fraction of solar irradiance due to direct beam
+        cza : Cosine of solar zenith angle
+        min_speed : Minimum 2m wind speed; m/s
+        d_globe : Diameter of black globe; meter
+        out : Location to write first output value to
+        stride : Number of elements between output values
+        tg_guess : First guess of globe temperature; Kelvin. The
+            default guess of the solver is used if not positive
+        tnwb_guess : First guess of natural wet bulb temperature; Kelvin
+        niter : Location to write the total number of solver iterations
+            to; ignored if NULL
+
+    Returns:
+        int : Zero (0) on success, else the _POINT_* flags of the point;
+            the point was not solved if any of _POINT_FAILED is set. A
+            failed point with a non-finite input is also flagged as
+            _POINT_MISSING
+
+    """
+
+    cdef:
+        int   daytime = 0, stability_class, iter_tg = 0, iter_tnwb = 0
+        int   flags = 0
+        float Tg, Tpsy, Tnwb, est_speed
+
+    if zspeed == _REF_HEIGHT:
+        est_speed = fmaxf(speed, min_speed)
+    else:
+        if cza > 0.0:
+            daytime = 1
+        stability_class = stab_srdt(daytime, speed, solar, dT)
+        est_speed = est_wind_speed(
+            speed, zspeed, stability_class, urban, min_speed,
+        )
+    if est_speed <= min_speed:
+        flags = _POINT_SPEED_CLIPPED
+
+    Tg = Tglobe_guess(
+        temp_air, relhum, pres, est_speed, solar, fdir, cza, d_globe,
+        tg_guess, &iter_tg,
+    )
+    Tnwb = -9999
+    if Tg != -9999:
+        Tnwb = Twb_guess(
+            temp_air, relhum, pres, est_speed, solar, fdir, cza, 1,
+            tnwb_guess, &iter_tnwb,
+        )
+    if niter != NULL:
+        niter[0] = iter_tg + iter_tnwb
+    if Tg == -9999 or Tnwb == -9999:
+        flags = _POINT_TG_FAILED if Tg == -9999 else _POINT_TNWB_FAILED
+        if isnan(temp_air + relhum + pres + speed + solar + fdir + cza):
+            flags = flags | _POINT_MISSING
+        return flags
+
+    Tpsy = Twb(temp_air, relhum, pres, est_speed, solar, fdir, cza, 0)
+
+    out[0]        = Tg
+    out[stride]   = Tpsy
+    out[2*stride] = Tnwb
+    out[3*stride] = 0.1*(temp_air-273.15) + 0.2*Tg + 0.7*Tnwb
+    out[4*stride] = solar
+    out[5*stride] = est_speed
+
+    return flags
+
+cdef inline void _count_point(numpy.int64_t *slot, int flags) noexcept nogil:
+    """
+    Count a point in the metrics slot of a thread; see pywbgt.metrics
+
+    A missing point is not counted as failed or clipped
+
+    """
+
+    slot[_POINTS] += 1
+    if flags == 0:
+        return
+    if flags & _POINT_MISSING:
+        slot[_MISSING] += 1
+        return
+    if flags & _POINT_TG_FAILED:
+        slot[_TG_FAILED] += 1
+    if flags & _POINT_TNWB_FAILED:
+        slot[_TNWB_FAILED] += 1
+    if flags & _POINT_SPEED_CLIPPED:
+        slot[_SPEED_CLIPPED] += 1
+    if flags & _POINT_NORMSOLAR_CLIPPED:
+        slot[_SOLAR_CLIPPED] += 1
+
+cdef inline int _wetbulb_globe_point(
+        float temp_air,
+        float relhum,
+        float pres,
+        float speed,
+        float zspeed,
+        float dT,
+        int   urban,
+        float solar,
+        float fdir,
+        float cza,
+        float min_speed,
+        float d_globe,
+        float *out,
+        Py_ssize_t stride,
+    ) noexcept nogil:
+    """Compute WBGT at a single point; see _wetbulb_globe_point_warm()"""
+
+    return _wetbulb_globe_point_warm(
+        temp_air, relhum, pres, speed, zspeed, dT, urban, solar, fdir, cza,
+        min_speed, d_globe, out, stride, 0.0, 0.0, NULL,
+    )
+
+def get_openmp_threads():
+    """Maximum number of OpenMP threads for parallel regions of this thread"""
+
+    return openmp.omp_get_max_threads()
+
+def set_openmp_threads(int nthreads):
+    """
+    Set number of OpenMP threads for parallel regions of this thread
+
+    The setting applies to all of the compiled kernels, which share one
+    OpenMP runtime, but only for parallel regions started by the calling
+    thread.
+
+    Arguments:
+        nthreads (int) : Number of threads
+
+    Returns:
+        int : Previous number of threads
+
+    """
+
+    cdef int previous = openmp.omp_get_max_threads()
+    openmp.omp_set_num_threads(max(nthreads, 1))
+    return previous
+
+# OpenMP schedule of the solver loop; see set_openmp_schedule()
+OPENMP_SCHEDULES = {
+    'static'  : openmp.omp_sched_static,
+    'dynamic' : openmp.omp_sched_dynamic,
+    'guided'  : openmp.omp_sched_guided,
+}
+cdef openmp.omp_sched_t _schedule_kind  = openmp.omp_sched_static
+cdef int                _schedule_chunk = 0
+
+def get_openmp_schedule():
+    """OpenMP schedule kind and chunk size of the solver loop of wetbulb_globe()"""
+
+    for name, kind in OPENMP_SCHEDULES.items():
+        if kind == _schedule_kind:
+            return name, _schedule_chunk
+
+def set_openmp_schedule(kind='static', int chunk=0):
+    """
+    Set the OpenMP schedule of the solver loop of wetbulb_globe()
+
+    The default, static with no chunk size, splits the elements into one
+    contiguous block per thread. Dynamic or guided schedules balance
+    elements that take many solver iterations across threads, at the cost
+    of scheduling overhead, and give up the NUMA placement of the input
+    copies made by first_touch_copy(). The setting applies to calls from
+    all threads.
+
+    Arguments:
+        kind (str) : One of OPENMP_SCHEDULES
+        chunk (int) : Chunk size; zero (0) for the OpenMP default
+
+    Returns:
+        tuple : Previous kind and chunk size
+
+    """
+
+    global _schedule_kind, _schedule_chunk
+
+    if kind not in OPENMP_SCHEDULES:
+        raise Exception( f'Unsupported OpenMP schedule : {kind}! Must be one of {list(OPENMP_SCHEDULES)}' )
+    previous = get_openmp_schedule()
+    _schedule_kind  = OPENMP_SCHEDULES[kind]
+    _schedule_chunk = max(chunk, 0)
+    return previous
+
+# ISA level of the solvers; see pywbgt.isa
+def _isa_supported(int level):
+    return pywbgt_isa_supported(level) != 0
+
+def _isa_best():
+    return pywbgt_isa_best()
+
+def _isa_level():
+    return liljegren_isa_level()
+
+def _isa_select(int level):
+    return liljegren_isa_select(level) == 0
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def first_touch_copy(values):
+    """
+    Copy values to a new float32 array, writing it in parallel
+
+    Memory pages are placed on the NUMA node of the thread that first
+    writes them. Copying with the same static partition as the compute
+    loops places each thread's part of the array on its own node, where
+    numpy.astype() would place the whole array on the node of the
+    calling thread.
+
+    The placement only matches the solver loop of wetbulb_globe() while
+    its schedule is static with no chunk size (the default). With a
+    dynamic, guided, or chunked schedule (see set_openmp_schedule()),
+    threads solve elements whose pages other threads wrote, so reads may
+    cross NUMA nodes. The copy is still made in parallel, and the tuned
+    schedule is only chosen by pywbgt.autotune() if it is faster despite
+    this, so the schedule is not forced to static here.
+
+    Arguments:
+        values (ndarray) : One-dimensional values to copy
+
+    Returns:
+        ndarray : float32 copy of values
+
+    """
+
+    cdef:
+        Py_ssize_t i, size
+        float [::1] dst
+        const float  [::1] src32
+        const double [::1] src64
+
+    values = numpy.asarray(values)
+    size   = values.shape[0]
+    out    = numpy.empty(size, dtype=numpy.float32)
+    dst    = out
+    if values.dtype == numpy.float32 and values.flags.c_contiguous:
+        src32 = values
+        for i in prange(size, nogil=True, schedule='static'):
+            dst[i] = src32[i]
+    else:
+        src64 = numpy.ascontiguousarray(values, dtype=numpy.float64)
+        for i in prange(size, nogil=True, schedule='static'):
+            dst[i] = <float>src64[i]
+    return out
+
+@cython.cdivision(True)
+cdef inline float _relhum(float temp_air, float temp_dew) noexcept nogil:
+    """
+    Relative humidity (fraction) from air and dew point temperature (degC)
+
+    Saturation vapor pressure is from Bolton (1980), as in metpy before
+    1.6. The other kernels get relative humidity from metpy, which uses
+    Ambaum (2020) since 1.6; the two differ by up to 0.3% relative
+    humidity between -40 and 50 degC, or about 0.05 degC of wet bulb
+    temperature
+
+    """
+
+    return (
+        expf(17.67*temp_dew/(temp_dew+243.5)) /
+        expf(17.67*temp_air/(temp_air+243.5))
+    )
+
+# Adjusted solar irradiance of a point; see _adjust_solar_point()
+cdef struct _solar_point:
+    float solar
+    float fdir
+    int   flags
+
+@cython.cdivision(True)
+cdef inline _solar_point _adjust_solar_point(float solar, float cza, double R) noexcept nogil:
+    """
+    Adjust solar irradiance and compute fraction of direct beam
+
+    Same as solar._adjust_solar(), for use inside the kernels. Returned
+    by value so that the result is private to the thread of a prange.
+    Flags is _POINT_NORMSOLAR_CLIPPED if normsolar is clipped, else zero
+
+    """
+
+    cdef:
+        float toasolar, normsolar
+        _solar_point out
+
+    out.solar = 0.0
+    out.fdir  = 0.0
+    out.flags = 0
+    if cza < _CZA_MIN:
+        return out
+
+    toasolar  = <float>(_SOLAR_CONST * fmaxf(cza, 0.0) / (R*R))
+    normsolar = solar / toasolar
+    if normsolar > _NORMSOLAR_MAX:
+        normsolar = _NORMSOLAR_MAX
+        out.flags = _POINT_NORMSOLAR_CLIPPED
+    if normsolar > 0.0:
+        out.fdir = fmaxf(fminf(expf(3.0 - 1.34*normsolar - 1.65/normsolar), 0.9), 0.0)
+    out.solar = normsolar * toasolar
+    return out
+
+@cython.cdivision(True)
+def wetbulb_globe_scalar(
+        float temp_air,
+        float temp_dew,
+        float pres,
+        float speed,
+        float solar,
+        float fdir,
+        float cza,
+        float zspeed    = 10.0,
+        float dT        = -1.0,
+        int   urban     = 0,
+        float min_speed = LILJEGREN_DEFAULT_MIN_SPEED,
+        float d_globe   = _D_GLOBE,
+    ):
+    """
+    Calculate the outdoor wet bulb-globe temperature at a single point
+
+    Low-overhead version of wetbulb_globe() for streaming use. Inputs are
+    plain floats in fixed units and the solar parameters must already be
+    computed (see solar._adjust_solar()), so no unit conversion or array
+    allocation is done. Relative humidity is computed without metpy; see
+    _relhum().
+
+    Arguments:
+        temp_air (float) : Air (dry bulb) temperature; degree Celsius
+        temp_dew (float) : Dew point temperature; degree Celsius
+        pres (float) : Barometric pressure; hPa
+        speed (float) : Wind speed; meter/second
+        solar (float) : Adjusted solar irradiance; watt/meter**2
+        fdir (float) : Fraction of solar irradiance due to direct beam
+        cza (float) : Cosine of solar zenith angle
+
+    Keyword arguments:
+        zspeed (float) : Height of wind speed measurement; meter
+        dT (float) : Vertical temperature difference; degree Celsius
+        urban (int) : Urban (1) or rural (0) flag
+        min_speed (float) : Minimum 2m wind speed; meter/second
+        d_globe (float) : Diameter of black globe; meter
+
+    Returns:
+        tuple : Tg, Tpsy, Tnwb, Twbg (degree Celsius), solar
+            (watt/meter**2), and 2m wind speed (meter/second), or None
+            if the solvers did not converge
+
+    """
+
+    cdef:
+        float out[6]
+        float relhum = _relhum(temp_air, temp_dew)
+
+    if _wetbulb_globe_point(
+            temp_air+273.15, relhum, pres, speed, zspeed, dT, urban,
+            solar, fdir, cza, min_speed, d_globe, out, 1,
+        ) & _POINT_FAILED:
+        return None
+
+    return (out[0], out[1], out[2], out[3], out[4], out[5])
 
 @cython.boundscheck(False)
 @cython.wraparound(False)
@@ -231,6 +658,18 @@ def natural_wetbulb( temp_air, temp_dew, pres, speed, solar, fdir, cza ):
 
     return out 
 
+def _guess_values(guess, size):
+    """Initial guesses in Kelvin; zero (0) where not given or not finite"""
+
+    if guess is None:
+        return numpy.zeros(size, dtype=numpy.float32)
+    values = first_touch_copy(
+        numpy.broadcast_to(guess.to('kelvin').magnitude, (size,)).ravel()
+    )
+    values[~numpy.isfinite(values)] = 0.0
+    return values
+
+@profiled('liljegren')
 @cython.boundscheck(False)  # Deactivate bounds checking
 @cython.wraparound(False)   # Deactivate negative indexing.
 @cython.initializedcheck(False)   # Deactivate initialization checking.
@@ -245,6 +684,11 @@ def wetbulb_globe(
         dT        = None,
         min_speed = None,
         d_globe   = None,
+        f_db      = None,
+        cosz      = None,
+        tg_guess   = None,
+        tnwb_guess = None,
+        iterations = False,
         **kwargs,
     ): 
 
@@ -288,6 +732,17 @@ def wetbulb_globe(
             is 2 knots, and is larger than LILJEGREN_MIN_SPEED.
         d_globe (Quantity) : Diameter of the black globe thermometer
             unit of distance
+        f_db (ndarray) : Fraction of solar irradiance due to direct beam.
+            If set along with cosz, solar parameters are not computed and
+            solar must already be adjusted (see solar_parameters())
+        cosz (ndarray) : Cosine of solar zenith angle
+        tg_guess (Quantity) : Initial guess of globe temperature for the
+            solver at each point (e.g., from a coarser grid or an earlier
+            time); unit of temperature. NaN to use the default guess
+        tnwb_guess (Quantity) : Initial guess of natural wet bulb
+            temperature; unit of temperature
+        iterations (bool) : If set, also return the total number of solver
+            iterations at each point
 
     Returns:
         dict :
@@ -297,6 +752,8 @@ def wetbulb_globe(
             - Twbg : Wet bulb-globe temperatures as Quantity
             - Speed : Estimated 2m wind speed as Quantity; will be same as input if already 2m wind speed 
             - min_speed : Minimum speed that adjusted wind speed is clipped to as Quantity 
+            - iterations : Solver iterations of each point; only if the
+              iterations keyword is set
 
     Reference: 
         Liljegren, J. C., R. A. Carhart, P. Lawday, S. Tschopp, and R. Sharp:
@@ -364,39 +821,307 @@ def wetbulb_globe(
         lat = lat.repeat( size )
         lon = lon.repeat( size )
 
-    #solar_adj, cza, fdir = solar_parameters(
-    solar_adj, cza, fdir = sparms(
+    if f_db is not None and cosz is not None:
+        solar_adj = numpy.asarray(solar.to('watt/m**2').magnitude)
+        cza       = numpy.asarray(cosz)
+        fdir      = numpy.asarray(f_db)
+    else:
+        raw = solar.to('watt/m**2').magnitude
+        #solar_adj, cza, fdir = solar_parameters(
+        with stage('solar', size=size):
+            solar_adj, cza, fdir = sparms(
+                datetime,
+                lat,
+                lon,
+                raw,
+                gmt,
+                avg,
+                **kwargs,
+            )
+        if metrics_enabled():
+            metrics_record('liljegren', normsolar_clipped=normsolar_clipped(raw, solar_adj, cza))
+
+    # Define output array; pages are first written (set to NaN) by the
+    # compute loop so that each lands on the NUMA node of its thread
+    out = numpy.empty( (6, size), dtype = numpy.float32 )
+
+    # Define array views for faster/parallel iteration. Internal float
+    # buffers are copied in parallel with the same static partition as
+    # the compute loop uses by default; see first_touch_copy() for
+    # other schedules
+    cdef:
+        Py_ssize_t k
+        bint  warm = tg_guess is not None or tnwb_guess is not None
+        bint  count = iterations
+        bint  stats = threads_enabled()
+        bint  counting = metrics_enabled()
+        int   tid, flags
+        double t0
+        float [:,::1] outView = out 
+        numpy.int64_t [::1] countView
+        float [::1] tg_guessView
+        float [::1] tnwb_guessView
+        int   [::1] iterView
+        numpy.int64_t [::1] statElemView
+        numpy.int64_t [::1] statIterView
+        double        [::1] statBusyView
+
+        int   [::1] urbanView  = urban.astype( numpy.int32   )
+
+        float [::1] solar_adjView
+        float [::1] czaView
+        float [::1] fdirView
+        float [::1] presView
+        float [::1] temp_airView
+        float [::1] speedView
+        float [::1] zspeedView
+        float [::1] dTView
+        float [::1] relhumView
+
+    with stage('units', size=size):
+        pres_hPa     = pres.to('hPa').magnitude
+        temp_air_K   = temp_air.to('kelvin').magnitude
+        speed_ms     = speed.to('m/s').magnitude
+        zspeed_m     = zspeed.to('meter').magnitude
+        dT_degC      = dT.to('degree_Celsius').magnitude
+
+    with stage('relhum', size=size):
+        relhum = rhTd(temp_air, temp_dew).magnitude
+
+    with stage('copy', size=size):
+        solar_adjView   = first_touch_copy( solar_adj )
+        czaView         = first_touch_copy( cza )
+        fdirView        = first_touch_copy( fdir )
+        presView        = first_touch_copy( pres_hPa )
+        temp_airView    = first_touch_copy( temp_air_K )
+        speedView       = first_touch_copy( speed_ms )
+        zspeedView      = first_touch_copy( zspeed_m )
+        dTView          = first_touch_copy( dT_degC )
+        relhumView      = first_touch_copy( relhum )
+
+
+    # Guesses are passed to the solvers in Kelvin; zero (0) selects the
+    # default guess
+    if warm:
+        tg_guessView   = _guess_values(tg_guess,   size)
+        tnwb_guessView = _guess_values(tnwb_guess, size)
+    iters = numpy.zeros( size if count or stats else 1, dtype = numpy.int32 )
+    iterView = iters
+
+    # Per-thread counters for load imbalance; see profiling.profile()
+    nslot = openmp.omp_get_max_threads() * _THREAD_PAD if stats else 1
+    stat_elems   = numpy.zeros( nslot, dtype = numpy.int64 )
+    stat_iters   = numpy.zeros( nslot, dtype = numpy.int64 )
+    stat_busy    = numpy.zeros( nslot, dtype = numpy.float64 )
+    statElemView = stat_elems
+    statIterView = stat_iters
+    statBusyView = stat_busy
+
+    # Per-thread counters of failed and clipped points; see pywbgt.metrics
+    counts    = _metric_slots(counting)
+    countView = counts
+
+    # Iterate (in parallel) over all values in the input arrays
+    openmp.omp_set_schedule( _schedule_kind, _schedule_chunk )
+    with stage('solver', size=size):
+        for i in prange( size, nogil=True, schedule='runtime' ):
+            if stats:
+                t0 = openmp.omp_get_wtime()
+            for k in range(6):
+                outView[k,i] = NAN
+            flags = _wetbulb_globe_point_warm(
+                temp_airView[i],
+                relhumView[i],
+                presView[i],
+                speedView[i],
+                zspeedView[i],
+                dTView[i],
+                urbanView[i],
+                solar_adjView[i],
+                fdirView[i],
+                czaView[i],
+                _min_speed,
+                _d_globe,
+                &outView[0,i],
+                size,
+                tg_guessView[i]   if warm else 0.0,
+                tnwb_guessView[i] if warm else 0.0,
+                &iterView[i] if count or stats else NULL,
+            )
+            if counting:
+                _count_point(&countView[openmp.omp_get_thread_num() * _THREAD_PAD], flags)
+            if stats:
+                tid = openmp.omp_get_thread_num() * _THREAD_PAD
+                statElemView[tid] += 1
+                statIterView[tid] += iterView[i]
+                statBusyView[tid] += openmp.omp_get_wtime() - t0
+    if stats:
+        record_region('solver', stat_elems, stat_iters, stat_busy)
+    if counting:
+        record_slots('liljegren', counts)
+
+    # Return dict with unit-aware values
+    res = {
+        'Tg'        : units.Quantity(out[0,:],   'degree_Celsius'),
+        'Tpsy'      : units.Quantity(out[1,:],   'degree_Celsius'),
+        'Tnwb'      : units.Quantity(out[2,:],   'degree_Celsius'),
+        'Twbg'      : units.Quantity(out[3,:],   'degree_Celsius'),
+        'solar'     : units.Quantity(out[4,:],   'watt/meter**2'),
+        'speed'     : units.Quantity(out[5,:],   'meter/second'),
+        'min_speed' : units.Quantity(_min_speed, 'meter/second'),
+    }
+    if count:
+        res['iterations'] = iters
+    return res
+
+def _metric_slots(bint counting):
+    """Per-thread slots of the metrics counters; one if not counting"""
+
+    return numpy.zeros(
+        openmp.omp_get_max_threads() * _THREAD_PAD if counting else 1,
+        dtype = numpy.int64,
+    )
+
+def _station_values(stations, key, unit, default, nstation):
+    """
+    Per-station values of a column in the station table
+
+    Values may be Quantity or plain numbers, the latter assumed to be in
+    unit. A missing column is filled with default.
+
+    """
+
+    val = stations.get(key) if hasattr(stations, 'get') else None
+    if val is None:
+        return numpy.full(nstation, default, dtype=numpy.float32)
+    if hasattr(val, 'to'):
+        val = val.to(unit).magnitude
+    return numpy.resize(
+        numpy.asarray(val, dtype=numpy.float32),
+        nstation,
+    )
+
+@cython.boundscheck(False)  # Deactivate bounds checking
+@cython.wraparound(False)   # Deactivate negative indexing.
+@cython.initializedcheck(False)   # Deactivate initialization checking.
+@cython.always_allow_keywords(True)
+def wetbulb_globe_ragged(
+        datetime, offsets, stations,
+        solar, pres, temp_air, temp_dew, speed,
+        gmt       = None,
+        avg       = None,
+        dT        = None,
+        min_speed = None,
+        **kwargs,
+    ):
+    """
+    Calculate the outdoor wet bulb-globe temperature for many stations
+
+    Same as wetbulb_globe(), but for a ragged collection of station
+    records (e.g., ISD or MADIS archives) where each station has its own
+    number of observations. Station metadata are given once per station
+    and looked up in the kernel, rather than being broadcast to every
+    observation. The observations of station j are in elements offsets[j]
+    to offsets[j+1] of the observation arrays. Stations are distributed
+    over threads dynamically so that long and short records balance.
+
+    Arguments:
+        datetime (pandas.DatetimeIndex) : Datetime of each observation
+        offsets (ndarray) : Index of first observation of each station with
+            the total number of observations as the last element
+        stations (Mapping) : Station metadata table (e.g., dict of arrays,
+            pandas.DataFrame) with one (1) row per station and columns:
+                - lat : Latitude of station; decimal. Required
+                - lon : Longitude of station; decimal. Required
+                - urban : Urban (1) or rural (0) flag; default is 0
+                - zspeed : Height of wind speed measurement; Quantity or
+                  meters. Default is 10 m
+                - d_globe : Diameter of black globe thermometer; Quantity
+                  or meters. Default is 0.0508 m
+                - elev, pressure, temp : Passed to solar_parameters_ragged()
+        solar (Quantity) : Solar irradiance; unit of power over area
+        pres (Quantity) : Barometric pressure; unit of pressure
+        temp_air (Quantity) : Air (dry bulb) temperature; unit of temperature
+        temp_dew (Quantity) : Dew point temperature; unit of temperature
+        speed (Quantity) : Wind speed; unit of speed
+
+    Keyword arguments:
+        gmt (ndarray) : LST-GMT difference  (hours; negative in USA); per
+            observation or per station
+        avg (ndarray) : Averaging time of the meteorological inputs
+            (minutes); per observation or per station
+        dT (Quantity) : Vertical temperature difference (upper minus
+            lower) for each observation. Default is -1 degree Celsius
+        min_speed (Quantity) : Sets the minimum speed for the height-adjusted
+            wind speed
+
+    Returns:
+        dict : Same as wetbulb_globe()
+
+    """
+
+    cdef:
+        Py_ssize_t i, j, size = datetime.shape[0]
+        Py_ssize_t nstation
+        float _min_speed
+        int   flags
+        bint  counting = metrics_enabled()
+
+    offsets  = numpy.ascontiguousarray(offsets, dtype=numpy.int64)
+    nstation = offsets.shape[0] - 1
+    if nstation < 1 or offsets[0] != 0 or offsets[nstation] != size:
+        raise Exception("Station offsets must start at zero (0) and end at number of observations!")
+    if numpy.any(numpy.diff(offsets) < 0):
+        raise Exception("Station offsets must be non-decreasing!")
+
+    if dT is None:
+        dT = (
+            units.degree_Celsius *
+            numpy.full(size, -1.0, dtype=numpy.float32)
+        )
+
+    _min_speed = max(
+        MIN_SPEED if min_speed is None else min_speed,
+        LILJEGREN_MIN_SPEED,
+    ).to('meter/second').magnitude
+
+    raw = numpy.asarray(solar.to('watt/m**2').magnitude, dtype=numpy.float64)
+    solar_adj, cza, fdir = sparms_ragged(
         datetime,
-        lat,
-        lon,
-        solar.to('watt/m**2').magnitude,
+        offsets,
+        stations['lat'],
+        stations['lon'],
+        raw,
         gmt,
         avg,
+        elev     = stations.get('elev'),
+        pressure = stations.get('pressure'),
+        temp     = stations.get('temp'),
         **kwargs,
     )
+    if counting:
+        metrics_record('liljegren', normsolar_clipped=normsolar_clipped(raw, solar_adj, cza))
 
-    # Define output array for storing WBGT status code
-    out = numpy.full( (6, size), numpy.nan, dtype = numpy.float32 )
+    out    = numpy.full( (6, size), numpy.nan, dtype = numpy.float32 )
+    counts = _metric_slots(counting)
 
-    # Define array views for faster/parallel iteration
     cdef:
-        int daytime, stability_class
-        float Tg, Tpsy, Tnwb, Twbg, est_speed  
-    
-        float [:,::1] outView = out 
+        float [:,::1] outView = out
+        numpy.int64_t [::1] countView = counts
 
-        float [::1] latView    = lat.astype(   numpy.float32 )
-        float [::1] lonView    = lon.astype(   numpy.float32 )
-        int   [::1] urbanView  = urban.astype( numpy.int32   )
+        numpy.int64_t [::1] offsetsView = offsets
 
-        float [::1] solar_adjView   =  solar_adj.astype( numpy.float32 )
-        float [::1] czaView         = cza.astype( numpy.float32)
-        float [::1] fdirView        = fdir.astype( numpy.float32)
+        int   [::1] urbanView   = _station_values(stations, 'urban', None, 0, nstation).astype( numpy.int32 )
+        float [::1] zspeedView  = _station_values(stations, 'zspeed',  'meter', 10.0,     nstation)
+        float [::1] d_globeView = _station_values(stations, 'd_globe', 'meter', _D_GLOBE, nstation)
+
+        float [::1] solar_adjView   = solar_adj.astype( numpy.float32 )
+        float [::1] czaView         = cza.astype( numpy.float32 )
+        float [::1] fdirView        = fdir.astype( numpy.float32 )
 
         float [::1] presView        =     pres.to('hPa'           ).magnitude.astype( numpy.float32 )
         float [::1] temp_airView    = temp_air.to('kelvin'        ).magnitude.astype( numpy.float32 )
         float [::1] speedView       =    speed.to('m/s'           ).magnitude.astype( numpy.float32 )
-        float [::1] zspeedView      =   zspeed.to('meter'         ).magnitude.astype( numpy.float32 )
         float [::1] dTView          =       dT.to('degree_Celsius').magnitude.astype( numpy.float32 )
         float [::1] relhumView      = (
             rhTd(temp_air, temp_dew)
@@ -404,80 +1129,338 @@ def wetbulb_globe(
             .astype( numpy.float32 )
         )
 
-
-    # Iterate (in parallel) over all values in the input arrays
-    for i in prange( size, nogil=True ):
-        if zspeedView[i] == _REF_HEIGHT:
-            est_speed = fmaxf(speedView[i], _min_speed)
-        else:
-            if czaView[i] > 0.0:
-                daytime = 1
-            stability_class = stab_srdt(
-                daytime,
+    # Iterate (in parallel) over stations; records can differ greatly in
+    # length so stations are handed out dynamically
+    for j in prange( nstation, nogil=True, schedule='dynamic' ):
+        for i in range( offsetsView[j], offsetsView[j+1] ):
+            flags = _wetbulb_globe_point(
+                temp_airView[i],
+                relhumView[i],
+                presView[i],
                 speedView[i],
-                solar_adjView[i],
+                zspeedView[j],
                 dTView[i],
-            )
-            est_speed = est_wind_speed(
-                speedView[i],
-                zspeedView[i],
-                stability_class,
-                urbanView[i],
+                urbanView[j],
+                solar_adjView[i],
+                fdirView[i],
+                czaView[i],
                 _min_speed,
+                d_globeView[j],
+                &outView[0,i],
+                size,
             )
- 
-        # Ensure that variables are defined for each thread
-        Tg = Tglobe(
-            temp_airView[i],
-            relhumView[i],
-            presView[i],
-            est_speed,
-            solar_adjView[i],
-            fdirView[i],
+            if counting:
+                _count_point(&countView[openmp.omp_get_thread_num() * _THREAD_PAD], flags)
+    if counting:
+        record_slots('liljegren', counts)
+
+    return {
+        'Tg'        : units.Quantity(out[0,:],   'degree_Celsius'),
+        'Tpsy'      : units.Quantity(out[1,:],   'degree_Celsius'),
+        'Tnwb'      : units.Quantity(out[2,:],   'degree_Celsius'),
+        'Twbg'      : units.Quantity(out[3,:],   'degree_Celsius'),
+        'solar'     : units.Quantity(out[4,:],   'watt/meter**2'),
+        'speed'     : units.Quantity(out[5,:],   'meter/second'),
+        'min_speed' : units.Quantity(_min_speed, 'meter/second'),
+    }
+
+def _point_values(val, unit, default, npoint):
+    """Per-point values of a Quantity or number; default if None"""
+
+    if val is None:
+        return numpy.full(npoint, default, dtype=numpy.float32)
+    if hasattr(val, 'to'):
+        val = val.to(unit).magnitude
+    return numpy.broadcast_to(
+        numpy.asarray(val, dtype=numpy.float32),
+        (npoint,),
+    ).copy()
+
+@cython.boundscheck(False)  # Deactivate bounds checking
+@cython.wraparound(False)   # Deactivate negative indexing.
+@cython.initializedcheck(False)   # Deactivate initialization checking.
+@cython.always_allow_keywords(True)
+def wetbulb_globe_ensemble(
+        solar_adj, fdir, cza,
+        pres, temp_air, temp_dew, speed,
+        urban     = None,
+        zspeed    = None,
+        dT        = None,
+        min_speed = None,
+        d_globe   = None,
+    ):
+    """
+    Calculate the outdoor wet bulb-globe temperature for an ensemble
+
+    Same as wetbulb_globe(), but for several members on the same points.
+    Meteorological inputs have a leading member axis, while the cosine of
+    the solar zenith angle and the point metadata are given once and
+    shared by all members. Members and points are iterated over together
+    in one parallel loop.
+
+    Arguments:
+        solar_adj (ndarray) : Adjusted solar irradiance (W/m**2) with shape
+            (nmember, npoint); see solar.adjust_solar_members()
+        fdir (ndarray) : Fraction of direct beam; shape (nmember, npoint)
+        cza (ndarray) : Cosine of solar zenith angle of each point
+        pres (Quantity) : Barometric pressure; (nmember, npoint)
+        temp_air (Quantity) : Air (dry bulb) temperature; (nmember, npoint)
+        temp_dew (Quantity) : Dew point temperature; (nmember, npoint)
+        speed (Quantity) : Wind speed; (nmember, npoint)
+
+    Keyword arguments:
+        urban (ndarray) : Urban (1) or rural (0) flag of each point
+        zspeed (Quantity) : Height of wind speed measurement of each point.
+            Default is 10 m
+        dT (Quantity) : Vertical temperature difference (upper minus
+            lower); (nmember, npoint). Default is -1 degree Celsius
+        min_speed (Quantity) : Sets the minimum speed for the height-adjusted
+            wind speed
+        d_globe (Quantity) : Diameter of the black globe thermometer
+
+    Returns:
+        dict : Same as wetbulb_globe(), with values of shape
+            (nmember, npoint)
+
+    """
+
+    cdef:
+        Py_ssize_t j, k, m, i, nmember, npoint, size
+        float _min_speed, _d_globe
+        int   flags
+        bint  counting = metrics_enabled()
+
+    nmember, npoint = solar_adj.shape
+    size = nmember * npoint
+
+    _min_speed = max(
+        MIN_SPEED if min_speed is None else min_speed,
+        LILJEGREN_MIN_SPEED,
+    ).to('meter/second').magnitude
+    _d_globe = _D_GLOBE if d_globe is None else d_globe.to('meter').magnitude
+
+    def member_values(val, unit):
+        return first_touch_copy(
+            numpy.broadcast_to(val.to(unit).magnitude, (nmember, npoint)).ravel()
+        )
+
+    out    = numpy.empty( (6, size), dtype = numpy.float32 )
+    counts = _metric_slots(counting)
+
+    cdef:
+        float [:,::1] outView = out
+        numpy.int64_t [::1] countView = counts
+
+        int   [::1] urbanView  = _point_values(urban,  None,    0,    npoint).astype( numpy.int32 )
+        float [::1] zspeedView = _point_values(zspeed, 'meter', 10.0, npoint)
+        float [::1] czaView    = _point_values(cza,    None,    0.0,  npoint)
+
+        float [::1] solar_adjView = first_touch_copy( numpy.ravel(solar_adj) )
+        float [::1] fdirView      = first_touch_copy( numpy.ravel(fdir) )
+
+        float [::1] presView     = member_values(pres,     'hPa')
+        float [::1] temp_airView = member_values(temp_air, 'kelvin')
+        float [::1] speedView    = member_values(speed,    'm/s')
+        float [::1] relhumView   = first_touch_copy(
+            numpy.broadcast_to(rhTd(temp_air, temp_dew).magnitude, (nmember, npoint)).ravel()
+        )
+        float [::1] dTView
+
+    if dT is None:
+        dTView = numpy.full(size, -1.0, dtype=numpy.float32)
+    else:
+        dTView = member_values(dT, 'degree_Celsius')
+
+    # Iterate (in parallel) over members and points together; point
+    # values are shared by all members
+    for k in prange( size, nogil=True, schedule='static' ):
+        m = k // npoint
+        i = k - m * npoint
+        for j in range(6):
+            outView[j,k] = NAN
+        flags = _wetbulb_globe_point(
+            temp_airView[k],
+            relhumView[k],
+            presView[k],
+            speedView[k],
+            zspeedView[i],
+            dTView[k],
+            urbanView[i],
+            solar_adjView[k],
+            fdirView[k],
             czaView[i],
+            _min_speed,
             _d_globe,
+            &outView[0,k],
+            size,
         )
-        if Tg == -9999:
-            continue
+        if counting:
+            _count_point(&countView[openmp.omp_get_thread_num() * _THREAD_PAD], flags)
+    if counting:
+        record_slots('liljegren', counts)
 
-        Tnwb = Twb(
-            temp_airView[i],
-            relhumView[i],
-            presView[i],
-            est_speed,
-            solar_adjView[i],
-            fdirView[i],
-            czaView[i],
-            1,
+    out = out.reshape(6, nmember, npoint)
+    return {
+        'Tg'        : units.Quantity(out[0],     'degree_Celsius'),
+        'Tpsy'      : units.Quantity(out[1],     'degree_Celsius'),
+        'Tnwb'      : units.Quantity(out[2],     'degree_Celsius'),
+        'Twbg'      : units.Quantity(out[3],     'degree_Celsius'),
+        'solar'     : units.Quantity(out[4],     'watt/meter**2'),
+        'speed'     : units.Quantity(out[5],     'meter/second'),
+        'min_speed' : units.Quantity(_min_speed, 'meter/second'),
+    }
+
+@cython.boundscheck(False)  # Deactivate bounds checking
+@cython.wraparound(False)   # Deactivate negative indexing.
+@cython.initializedcheck(False)   # Deactivate initialization checking.
+@cython.always_allow_keywords(True)
+def wetbulb_globe_interp(
+        index, weight, cza, dist,
+        solar, pres, temp_air, temp_dew, speed,
+        urban     = None,
+        zspeed    = None,
+        dT        = None,
+        min_speed = None,
+        d_globe   = None,
+    ):
+    """
+    Calculate the outdoor wet bulb-globe temperature between input times
+
+    Meteorological inputs are given at source times (e.g., hourly) and
+    linearly interpolated to each target time inside the kernel, so the
+    interpolated inputs are never stored. Solar irradiance is adjusted
+    at the target times. As in wetbulb_globe_scalar(), relative humidity
+    is computed without metpy.
+
+    Arguments:
+        index (ndarray) : Index of the source time at or before each of
+            ntarget target times; -1 for targets outside the source times
+        weight (ndarray) : Weight of the following source time for each
+            target time
+        cza (ndarray) : Cosine of solar zenith angle at target times, with
+            shape (ntarget, npoint)
+        dist (ndarray) : Earth-Sun distance (AU) at each target time
+        solar (Quantity) : Solar irradiance; (nsource, npoint)
+        pres (Quantity) : Barometric pressure; (nsource, npoint)
+        temp_air (Quantity) : Air (dry bulb) temperature; (nsource, npoint)
+        temp_dew (Quantity) : Dew point temperature; (nsource, npoint)
+        speed (Quantity) : Wind speed; (nsource, npoint)
+
+    Keyword arguments:
+        urban (ndarray) : Urban (1) or rural (0) flag of each point
+        zspeed (Quantity) : Height of wind speed measurement of each point.
+            Default is 10 m
+        dT (Quantity) : Vertical temperature difference (upper minus
+            lower); (nsource, npoint). Default is -1 degree Celsius
+        min_speed (Quantity) : Sets the minimum speed for the height-adjusted
+            wind speed
+        d_globe (Quantity) : Diameter of the black globe thermometer
+
+    Returns:
+        dict : Same as wetbulb_globe(), with values of shape
+            (ntarget, npoint)
+
+    """
+
+    cdef:
+        Py_ssize_t j, k, t, p, i0, i1, nsource, ntarget, npoint, size
+        float w, ta, td
+        _solar_point sp
+        float _min_speed, _d_globe
+        int   flags
+        bint  counting = metrics_enabled()
+
+    nsource, npoint = temp_air.shape
+    ntarget = cza.shape[0]
+    size    = ntarget * npoint
+
+    _min_speed = max(
+        MIN_SPEED if min_speed is None else min_speed,
+        LILJEGREN_MIN_SPEED,
+    ).to('meter/second').magnitude
+    _d_globe = _D_GLOBE if d_globe is None else d_globe.to('meter').magnitude
+
+    def source_values(val, unit):
+        return numpy.ascontiguousarray(
+            numpy.broadcast_to(val.to(unit).magnitude, (nsource, npoint)),
+            dtype = numpy.float32,
         )
-        if Tnwb == -9999:
-            continue
 
-        Tpsy = Twb(
-            temp_airView[i],
-            relhumView[i],
-            presView[i],
-            est_speed,
-            solar_adjView[i],
-            fdirView[i],
-            czaView[i],
-            0,
+    out    = numpy.empty( (6, size), dtype = numpy.float32 )
+    counts = _metric_slots(counting)
+
+    cdef:
+        float [:,::1] outView = out
+        numpy.int64_t [::1] countView = counts
+
+        numpy.int64_t [::1] indexView  = numpy.ascontiguousarray(index, dtype=numpy.int64)
+        float         [::1] weightView = numpy.ascontiguousarray(weight, dtype=numpy.float32)
+        float       [:,::1] czaView    = numpy.ascontiguousarray(cza, dtype=numpy.float32)
+        double        [::1] distView   = numpy.ascontiguousarray(dist, dtype=numpy.float64)
+
+        int   [::1] urbanView  = _point_values(urban,  None,    0,    npoint).astype( numpy.int32 )
+        float [::1] zspeedView = _point_values(zspeed, 'meter', 10.0, npoint)
+
+        float [:,::1] solarView    = source_values(solar,    'watt/m**2')
+        float [:,::1] presView     = source_values(pres,     'hPa')
+        float [:,::1] temp_airView = source_values(temp_air, 'degree_Celsius')
+        float [:,::1] temp_dewView = source_values(temp_dew, 'degree_Celsius')
+        float [:,::1] speedView    = source_values(speed,    'm/s')
+        float [:,::1] dTView       = source_values(
+            units.Quantity(-1.0, 'degree_Celsius') if dT is None else dT,
+            'degree_Celsius',
         )
- 
-        outView[0,i] = Tg
-        outView[1,i] = Tpsy
-        outView[2,i] = Tnwb
-        outView[3,i] = 0.1*(temp_airView[i]-273.15) + 0.2*Tg + 0.7*Tnwb
-        outView[4,i] = solar_adjView[i]
-        outView[5,i] = est_speed
 
-    # Return dict with unit-aware values
+    # Iterate (in parallel) over target times and points together
+    for k in prange( size, nogil=True, schedule='static' ):
+        t = k // npoint
+        p = k - t * npoint
+        for j in range(6):
+            outView[j,k] = NAN
+        i0 = indexView[t]
+        if i0 < 0:
+            continue
+        i1 = i0 + 1 if i0 + 1 < nsource else i0
+        w  = weightView[t]
+
+        ta      = (1.0-w)*temp_airView[i0,p] + w*temp_airView[i1,p]
+        td      = (1.0-w)*temp_dewView[i0,p] + w*temp_dewView[i1,p]
+        sp = _adjust_solar_point(
+            (1.0-w)*solarView[i0,p] + w*solarView[i1,p],
+            czaView[t,p],
+            distView[t],
+        )
+        flags = _wetbulb_globe_point(
+            ta + 273.15,
+            _relhum(ta, td),
+            (1.0-w)*presView[i0,p]  + w*presView[i1,p],
+            (1.0-w)*speedView[i0,p] + w*speedView[i1,p],
+            zspeedView[p],
+            (1.0-w)*dTView[i0,p]    + w*dTView[i1,p],
+            urbanView[p],
+            sp.solar,
+            sp.fdir,
+            czaView[t,p],
+            _min_speed,
+            _d_globe,
+            &outView[0,k],
+            size,
+        )
+        if counting:
+            _count_point(
+                &countView[openmp.omp_get_thread_num() * _THREAD_PAD],
+                flags | sp.flags,
+            )
+    if counting:
+        record_slots('liljegren', counts)
+
+    out = out.reshape(6, ntarget, npoint)
     return {
-        'Tg'        : units.Quantity(out[0,:],   'degree_Celsius'),
-        'Tpsy'      : units.Quantity(out[1,:],   'degree_Celsius'),
-        'Tnwb'      : units.Quantity(out[2,:],   'degree_Celsius'),
-        'Twbg'      : units.Quantity(out[3,:],   'degree_Celsius'),
-        'solar'     : units.Quantity(out[4,:],   'watt/meter**2'),
-        'speed'     : units.Quantity(out[5,:],   'meter/second'),
+        'Tg'        : units.Quantity(out[0],     'degree_Celsius'),
+        'Tpsy'      : units.Quantity(out[1],     'degree_Celsius'),
+        'Tnwb'      : units.Quantity(out[2],     'degree_Celsius'),
+        'Twbg'      : units.Quantity(out[3],     'degree_Celsius'),
+        'solar'     : units.Quantity(out[4],     'watt/meter**2'),
+        'speed'     : units.Quantity(out[5],     'meter/second'),
         'min_speed' : units.Quantity(_min_speed, 'meter/second'),
     }
@@ -0,0 +1,256 @@
+"""
+Memory footprint accounting and budget-driven chunking
+
+A call on N elements allocates a number of temporary arrays of size N
+(unit conversions, solar geometry, copies for the kernels, output), so the
+peak memory of a call grows linearly with N. footprint() measures the
+temporary bytes per element of a method with given options, and
+plan_chunk_size() turns a memory budget into the number of elements per
+chunk that fits in it:
+
+    from pywbgt import memory
+
+    memory.footprint('liljegren')                       # bytes per element
+    res = memory.wbgt_budget('liljegren', *args, budget=2*2**30)
+    memory.high_water()                                 # measured peak
+
+Memory is measured with tracemalloc, which sees the allocations of numpy
+and the compiled kernels, but not those of the inputs made before a call.
+
+"""
+
+import tracemalloc
+from contextlib import contextmanager
+
+import numpy
+from metpy.units import units
+
+from .batch import iter_chunks, slice_arg
+from .constants import OUTPUT_UNITS
+from .utils import datetime_check
+
+# Sizes used to measure the footprint; the difference of the peaks
+# removes the fixed overhead of a call
+SAMPLE_SIZES = (2**14, 2**16)
+
+_footprints = {}
+_last       = None
+
+class HighWater:
+    """
+    Peak traced memory within a track() context
+
+    Attributes:
+        peak (int) : Peak bytes allocated above the start of the context
+        chunk_size (int) : Elements per chunk; set by wbgt_budget()
+        chunks (int) : Number of chunks; set by wbgt_budget()
+
+    """
+
+    def __init__(self):
+
+        self.peak       = 0
+        self.chunk_size = None
+        self.chunks     = None
+
+    def __repr__(self):
+
+        return (
+            f'HighWater(peak={self.peak}, chunk_size={self.chunk_size}, '
+            f'chunks={self.chunks})'
+        )
+
+@contextmanager
+def track():
+    """
+    Measure the peak memory allocated within the context
+
+    The result is also kept for high_water().
+
+    Returns:
+        HighWater : Peak is set when the context exits
+
+    """
+
+    global _last
+
+    out     = HighWater()
+    tracing = not tracemalloc.is_tracing()
+    if tracing:
+        tracemalloc.start()
+    tracemalloc.reset_peak()
+    start = tracemalloc.get_traced_memory()[0]
+    try:
+        yield out
+    finally:
+        out.peak = tracemalloc.get_traced_memory()[1] - start
+        if tracing:
+            tracemalloc.stop()
+        _last = out
+
+def high_water():
+    """
+    High-water mark of the last track() context or wbgt_budget() call
+
+    Returns:
+        HighWater : None if nothing has been measured
+
+    """
+
+    return _last
+
+def _sample_inputs(size):
+    """Synthetic inputs for measuring the footprint of size elements"""
+
+    from . import synthetic
+
+    return synthetic.args(synthetic.stations(size, missing=0.0))
+
+def _options_key(method, kwargs):
+
+    key = []
+    for name, val in sorted(kwargs.items()):
+        if getattr(val, 'ndim', 0) > 0:
+            key.append((name, 'array'))
+        else:
+            key.append((name, repr(val)))
+    return (method.lower(), tuple(key))
+
+def footprint(method, **kwargs):
+    """
+    Peak temporary memory per element of a WBGT method
+
+    The method is run on synthetic inputs of SAMPLE_SIZES elements and the
+    slope of the peak traced memory is returned. Results are cached by
+    method and options.
+
+    Arguments:
+        method (str) : Name of the method to use
+
+    Keyword arguments:
+        **kwargs : Options passed to wbgt(); e.g., use_spa. Array options
+            are not used for the measurement
+
+    Returns:
+        float : Bytes per element
+
+    """
+
+    from . import wbgt
+
+    key = _options_key(method, kwargs)
+    if key in _footprints:
+        return _footprints[key]
+
+    options = {
+        name : val for name, val in kwargs.items()
+        if getattr(val, 'ndim', 0) == 0
+    }
+    # First call of a method allocates caches (e.g., of imports and unit
+    # registries) that are not part of the per-element cost
+    wbgt(method, *_sample_inputs(SAMPLE_SIZES[0]), **options)
+
+    peaks = []
+    for size in SAMPLE_SIZES:
+        args = _sample_inputs(size)
+        with track() as mark:
+            res = wbgt(method, *args, **options)
+        del res
+        peaks.append(mark.peak)
+
+    nbytes = (peaks[1] - peaks[0]) / (SAMPLE_SIZES[1] - SAMPLE_SIZES[0])
+    if nbytes <= 0:
+        raise Exception(f'Could not measure the footprint of {method}')
+    _footprints[key] = nbytes
+    return nbytes
+
+def plan_chunk_size(method, budget, **kwargs):
+    """
+    Number of elements per chunk that fits in a memory budget
+
+    Arguments:
+        method (str) : Name of the method to use
+        budget (int) : Bytes available for the temporaries of one chunk,
+            including the output of the chunk
+
+    Keyword arguments:
+        **kwargs : Options passed to wbgt(); see footprint()
+
+    Returns:
+        int : Elements per chunk
+
+    """
+
+    nbytes = footprint(method, **kwargs)
+    size   = int(budget // nbytes)
+    if size < 1:
+        raise Exception(
+            f'Memory budget of {budget} bytes is less than one element of '
+            f'{method} ({nbytes:.0f} bytes)'
+        )
+    return size
+
+def wbgt_budget(
+        method, datetime, lat, lon,
+        solar, pres, temp_air, temp_dew, speed,
+        budget,
+        **kwargs,
+    ):
+    """
+    Compute WBGT in chunks that fit in a memory budget
+
+    The chunk size is set by plan_chunk_size() and each chunk is passed to
+    wbgt(); keyword arguments with the same length as the inputs are sliced
+    along with them. The output of the chunks is concatenated at the end,
+    so it is not part of the budget, but it is part of the measured peak,
+    which is available from high_water() afterwards.
+
+    Arguments:
+        method (str) : name of the method to use.
+        datetime (pandas.DatetimeIndex) : Datetime(s) corresponding to data
+        lat (ndarray) : Latitude corresponding to data values (decimal)
+        lon (ndarray) : Longitude corresponding to data values (decimal)
+        solar (Quantity) : solar irradiance; units of any power over area
+        pres (Quantity) : barometric pressure; units of pressure
+        temp_air (Quantity) : air (dry bulb) temperature; units of temperature
+        temp_dew (Quantity) : Dew point temperature; units of temperature
+        speed (Quantity) : wind speed; units of speed
+        budget (int) : Bytes available for the temporaries of one chunk
+
+    Keyword arguments:
+        **kwargs : All other keywords are passed to wbgt()
+
+    Returns:
+        dict : Same as wbgt()
+
+    """
+
+    from . import wbgt
+
+    datetime   = datetime_check(datetime)
+    size       = datetime.shape[0]
+    chunk_size = min(plan_chunk_size(method, budget, **kwargs), max(size, 1))
+
+    args    = (lat, lon, solar, pres, temp_air, temp_dew, speed)
+    results = {var : [] for var in OUTPUT_UNITS}
+    with track() as mark:
+        for _, start, stop in iter_chunks(size, chunk_size):
+            res = wbgt(
+                method,
+                datetime[start:stop],
+                *[slice_arg(arg, start, stop, size) for arg in args],
+                **{
+                    key : slice_arg(val, start, stop, size)
+                    for key, val in kwargs.items()
+                },
+            )
+            for var, unit in OUTPUT_UNITS.items():
+                results[var].append(res[var].to(unit).magnitude)
+            del res
+        mark.chunk_size = chunk_size
+        mark.chunks     = -(-size // chunk_size)
+
+    return {
+        var : units.Quantity(numpy.concatenate(vals), OUTPUT_UNITS[var])
+        for var, vals in results.items()
+    }
@@ -0,0 +1,151 @@
+"""
+Counters of solver failures and clipped inputs
+
+How often the solvers fail, and how often inputs are clipped, is not
+visible in the results; a failed point is just NaN. When metrics are
+enabled, the methods count these events for every call and add them to
+process-wide totals, which can be read as a dict or in the Prometheus
+text format:
+
+    from pywbgt import metrics
+
+    metrics.enable()                 # or set PYWBGT_METRICS=1 before import
+    pywbgt.wbgt('liljegren', *args)
+    metrics.snapshot()               # {method : {counter : count}}
+    metrics.to_prometheus()
+
+The compiled solver loops count into per-thread slots THREAD_PAD elements
+apart, which are added to the totals once per call. When disabled, a loop
+checks one flag per element.
+
+"""
+
+import os
+import threading
+
+import numpy
+
+from .profiling import THREAD_PAD
+
+ENVIRONMENT = 'PYWBGT_METRICS'
+
+# Counter names and descriptions; the compiled kernels count into slots
+# in this order, so there can be no more than THREAD_PAD counters
+COUNTERS = {
+    'points'            : 'Points passed to the solvers',
+    'missing'           : 'Points not solved due to missing (non-finite) inputs',
+    'tglobe_failed'     : 'Points where the globe temperature solver did not converge',
+    'twb_failed'        : 'Points where the natural wet bulb temperature solver did not converge',
+    'speed_clipped'     : 'Points where the 2 m wind speed was raised to min_speed',
+    'normsolar_clipped' : 'Points where solar irradiance was clipped to NORMSOLAR_MAX times the top-of-atmosphere value',
+}
+
+_enabled = os.environ.get(ENVIRONMENT, '').lower() not in ('', '0', 'false', 'no')
+_lock    = threading.Lock()
+_totals  = {}
+
+def enable():
+    """Start counting; returns the previous state"""
+
+    global _enabled
+
+    previous = _enabled
+    _enabled = True
+    return previous
+
+def disable():
+    """Stop counting; the totals are kept. Returns the previous state"""
+
+    global _enabled
+
+    previous = _enabled
+    _enabled = False
+    return previous
+
+def enabled():
+    """True if counting"""
+
+    return _enabled
+
+def reset():
+    """Set all totals to zero"""
+
+    with _lock:
+        _totals.clear()
+
+def record(method, **counts):
+    """
+    Add counts to the totals of a method
+
+    Arguments:
+        method (str) : Name of the method
+        **counts : Count of any of COUNTERS
+
+    """
+
+    with _lock:
+        totals = _totals.setdefault(method, dict.fromkeys(COUNTERS, 0))
+        for key, val in counts.items():
+            totals[key] += int(val)
+
+def record_slots(method, slots):
+    """
+    Add per-thread counts of a compiled kernel to the totals of a method
+
+    Arguments:
+        method (str) : Name of the method
+        slots (ndarray) : Counts of each thread, THREAD_PAD elements per
+            thread, in the order of COUNTERS
+
+    """
+
+    sums = numpy.asarray(slots).reshape(-1, THREAD_PAD).sum(axis=0)
+    record(method, **dict(zip(COUNTERS, sums.tolist())))
+
+def speed_clipped(speed, min_speed):
+    """Number of speeds, after clipping, at min_speed (or below); NaN are not counted"""
+
+    return int(numpy.count_nonzero(numpy.asarray(speed) <= min_speed))
+
+def snapshot(clear=False):
+    """
+    Current totals
+
+    Keyword arguments:
+        clear (bool) : If set, set the totals to zero after reading them
+
+    Returns:
+        dict : Counts of COUNTERS for each method that has run
+
+    """
+
+    with _lock:
+        out = {method : dict(totals) for method, totals in _totals.items()}
+        if clear:
+            _totals.clear()
+    return out
+
+def to_prometheus(prefix='pywbgt'):
+    """
+    Current totals in the Prometheus text exposition format
+
+    Each counter is a metric named {prefix}_{counter}_total, labelled
+    with the method.
+
+    Keyword arguments:
+        prefix (str) : Prefix of the metric names
+
+    Returns:
+        str : Metrics, one sample per line
+
+    """
+
+    totals = snapshot()
+    lines  = []
+    for key, desc in COUNTERS.items():
+        name = f'{prefix}_{key}_total'
+        lines.append(f'# HELP {name} {desc}')
+        lines.append(f'# TYPE {name} counter')
+        for method in sorted(totals):
+            lines.append(f'{name}{{method="{method}"}} {totals[method][key]}')
+    return '\n'.join(lines) + '\n'
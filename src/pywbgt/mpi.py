@@ -0,0 +1,257 @@
+"""
+MPI domain-decomposed driver
+
+Split a gridded (time, lat, lon) domain across MPI ranks for hindcasts
+too large for one node. Each rank reads only its own slab of the input
+Dataset, computes solar geometry and WBGT for its own points, and writes
+its output to its own file. Reductions, such as daily maxima and zone
+aggregates, are gathered and merged on the root rank.
+
+Runs under MPI with, e.g.:
+
+    mpirun -n 4 python hindcast.py
+
+Requires the mpi4py package to run with more than one (1) rank; without
+it, the driver runs as a single rank.
+
+"""
+
+import copy
+import os
+
+import numpy
+from metpy.units import units
+
+from .constants import OUTPUT_UNITS
+from .accessors import WBGTDatasetAccessor, _compute_block
+from .utils import atomic_savez
+
+try:
+    from mpi4py import MPI
+except ImportError:
+    MPI = None
+
+class SerialComm:
+    """
+    Stand-in for an MPI communicator with a single rank
+
+    Used when mpi4py is not installed.
+
+    """
+
+    rank = 0
+    size = 1
+
+    def Get_rank(self):
+        return self.rank
+
+    def Get_size(self):
+        return self.size
+
+    def gather(self, obj, root=0):
+        return [obj]
+
+    def bcast(self, obj, root=0):
+        return obj
+
+    def Barrier(self):
+        pass
+
+def get_comm(comm=None):
+    """Return comm, or the world communicator if None"""
+
+    if comm is not None:
+        return comm
+    if MPI is not None:
+        return MPI.COMM_WORLD
+    return SerialComm()
+
+def split_bounds(size, nparts, part):
+    """
+    Bounds of one part of a balanced split
+
+    The first size % nparts parts get one (1) extra element.
+
+    Arguments:
+        size (int) : Number of elements to split
+        nparts (int) : Number of parts
+        part (int) : Index of the part
+
+    Returns:
+        tuple : Start and stop index of the part
+
+    """
+
+    base, extra = divmod(size, nparts)
+    start = part * base + min(part, extra)
+    return start, start + base + (1 if part < extra else 0)
+
+def rank_path(outdir, rank):
+    """Path to the output file for a rank"""
+
+    return os.path.join(outdir, f'rank_{rank:05d}.npz')
+
+def load_ranks(outdir, variables=None):
+    """
+    Load and assemble per-rank files written by wbgt_mpi()
+
+    Arguments:
+        outdir (str) : Directory containing rank files
+
+    Keyword arguments:
+        variables (list) : Names of variables to load. Default is all
+
+    Returns:
+        dict : Variables with shape (time, lat, lon) as Quantity
+
+    """
+
+    files = sorted(
+        os.path.join(outdir, item) for item in os.listdir(outdir)
+        if item.startswith('rank_') and item.endswith('.npz')
+    )
+    if variables is None:
+        variables = list(OUTPUT_UNITS)
+
+    data = {}
+    for path in files:
+        with numpy.load(path) as slab:
+            index = [slice(None)] * 3
+            index[int(slab['axis'])] = slice(int(slab['start']), int(slab['stop']))
+            for var in variables:
+                if var not in data:
+                    data[var] = numpy.full(
+                        tuple(slab['shape']), numpy.nan, dtype=slab[var].dtype,
+                    )
+                data[var][tuple(index)] = slab[var]
+
+    return {
+        var : units.Quantity(vals, OUTPUT_UNITS[var])
+        for var, vals in data.items()
+    }
+
+def wbgt_mpi(
+        method, dataset,
+        comm        = None,
+        axis        = 'time',
+        mapping     = None,
+        input_units = None,
+        outdir      = None,
+        reductions  = None,
+        **kwargs,
+    ):
+    """
+    Compute WBGT over a gridded Dataset, decomposed across MPI ranks
+
+    Every rank must call this function with the same arguments. The
+    domain is split into contiguous slabs along one dimension, and each
+    rank reads only its slab of the input variables, so the Dataset
+    should be opened lazily (e.g., with xarray.open_mfdataset).
+
+    Arguments:
+        method (str) : name of the method to use.
+        dataset (xarray.Dataset) : Input variables with 1-D time, lat, and
+            lon coordinates; variables are found as in the Dataset
+            accessor (see pywbgt.accessors)
+
+    Keyword arguments:
+        comm (MPI.Comm) : Communicator to use. Default is COMM_WORLD
+        axis (str) : Coordinate to split the domain along; one of 'time',
+            'lat', or 'lon'
+        mapping (dict) : Explicit mapping of argument name to variable
+            name
+        input_units (dict) : Units of input variables keyed by argument
+            name; overrides the variables' units attributes
+        outdir (str) : Directory to write output of each rank to
+        reductions (dict) : Reductions (see pywbgt.reductions) to update
+            with the output of each rank and gather on rank zero (0);
+            keyed by name
+        **kwargs : All other keywords are passed to wbgt()
+
+    Returns:
+        dict :
+            - slab : Slice of the domain along axis computed by this rank
+            - reductions : Result of each reduction on rank zero (0);
+              None on other ranks
+            - files : Paths of all rank files; only if outdir set
+            - If outdir is NOT set, the output variables for the slab of
+              this rank are also included
+
+    """
+
+    comm       = get_comm(comm)
+    rank, size = comm.Get_rank(), comm.Get_size()
+    reductions = reductions or {}
+
+    accessor  = WBGTDatasetAccessor(dataset)
+    variables = accessor.variables(mapping)
+    in_units  = accessor.input_units(variables, input_units)
+    coords    = [accessor._coordinate(key) for key in ('time', 'lat', 'lon')]
+    dims      = [coord.dims[0] for coord in coords]
+    shape     = tuple(coord.size for coord in coords)
+
+    iaxis = ('time', 'lat', 'lon').index(axis)
+    start, stop = split_bounds(shape[iaxis], size, rank)
+    slab  = {dims[iaxis] : slice(start, stop)}
+
+    # Only the slab of each variable is read
+    coords = [coord.isel(slab) if dim in slab else coord for coord, dim in zip(coords, dims)]
+    values = [var.isel(slab).transpose(*dims).values for var in variables.values()]
+    time   = coords[0].values[:, None, None]
+    lat    = coords[1].values[None, :, None]
+    lon    = coords[2].values[None, None, :]
+
+    out = {'slab' : slice(start, stop), 'reductions' : None}
+    if stop > start:
+        outputs = dict(zip(
+            OUTPUT_UNITS,
+            _compute_block(
+                time, lat, lon, *values,
+                method      = method,
+                input_units = in_units,
+                kwargs      = kwargs,
+            ),
+        ))
+
+        if reductions:
+            flat = numpy.broadcast_arrays(time, lat, lon, values[0])[:3]
+            res  = {var : val.ravel() for var, val in outputs.items()}
+            for red in reductions.values():
+                red.update(flat[0].ravel(), flat[1].ravel(), flat[2].ravel(), res)
+
+        if outdir is not None:
+            os.makedirs(outdir, exist_ok=True)
+            atomic_savez(
+                rank_path(outdir, rank),
+                axis  = iaxis,
+                start = start,
+                stop  = stop,
+                shape = numpy.asarray(shape),
+                **outputs,
+            )
+        else:
+            out.update({
+                var : units.Quantity(val, OUTPUT_UNITS[var])
+                for var, val in outputs.items()
+            })
+
+    states = comm.gather(
+        {name : red.state() for name, red in reductions.items()},
+        root = 0,
+    )
+    if rank == 0:
+        for other_states in states[1:]:
+            for name, red in reductions.items():
+                other = copy.deepcopy(red)
+                other.load(other_states[name])
+                red.merge(other)
+        out['reductions'] = {name : red.result() for name, red in reductions.items()}
+
+    if outdir is not None:
+        comm.Barrier()
+        out['files'] = [
+            rank_path(outdir, index) for index in range(size)
+            if os.path.isfile(rank_path(outdir, index))
+        ]
+
+    return out
@@ -0,0 +1,166 @@
+"""
+Coarse-to-fine warm start for high-resolution grids
+
+Globe and natural wet bulb temperatures vary smoothly over a high
+resolution grid compared with the tolerance of the Liljegren solvers.
+Here the solvers are first run on a grid coarsened by block averaging,
+and the coarse solution is interpolated back to the full grid as the
+initial guess of the full resolution solve, so that each fine grid cell
+needs fewer iterations. This is the spatial analogue of using the
+previous time step as the initial guess.
+
+The result agrees with a cold start to within the solver tolerance.
+
+"""
+
+import numpy
+from pandas import DatetimeIndex
+from metpy.units import units
+
+from .liljegren import wetbulb_globe
+from .utils import datetime_check
+
+FACTOR = 4
+
+def coarsen(values, factor):
+    """
+    Block mean over the last two (2) dimensions, ignoring NaN
+
+    Edge blocks are smaller if a dimension is not a multiple of factor.
+
+    Arguments:
+        values (ndarray) : Array with at least two (2) dimensions
+        factor (int) : Number of fine cells per coarse cell along each
+            dimension
+
+    Returns:
+        ndarray : Coarsened array
+
+    """
+
+    values = numpy.asarray(values, dtype=numpy.float64)
+    valid  = numpy.isfinite(values)
+    total  = numpy.where(valid, values, 0.0)
+    count  = valid.astype(numpy.float64)
+    for axis in (-2, -1):
+        index = numpy.arange(0, values.shape[axis], factor)
+        total = numpy.add.reduceat(total, index, axis=axis)
+        count = numpy.add.reduceat(count, index, axis=axis)
+    with numpy.errstate(invalid='ignore'):
+        return numpy.where(count > 0, total / numpy.maximum(count, 1), numpy.nan)
+
+def _weights(nfine, ncoarse, factor):
+    """Bilinear interpolation indices and weights along one dimension"""
+
+    # Position of fine cell centers in units of coarse cells; a coarse
+    # cell center is at the mean position of its (possibly partial) block
+    centers = numpy.array([
+        numpy.arange(i*factor, min((i+1)*factor, nfine)).mean()
+        for i in range(ncoarse)
+    ])
+    pos = numpy.interp(numpy.arange(nfine), centers, numpy.arange(ncoarse))
+    lo  = numpy.minimum(numpy.floor(pos).astype(int), max(ncoarse-2, 0))
+    hi  = numpy.minimum(lo + 1, ncoarse - 1)
+    return lo, hi, pos - lo
+
+def upsample(coarse, shape, factor):
+    """
+    Bilinear interpolation of a coarsened array back to the fine grid
+
+    Arguments:
+        coarse (ndarray) : Output of coarsen()
+        shape (tuple) : Shape of the last two (2) dimensions of the fine grid
+        factor (int) : Factor used by coarsen()
+
+    Returns:
+        ndarray : Interpolated array
+
+    """
+
+    ylo, yhi, wy = _weights(shape[0], coarse.shape[-2], factor)
+    xlo, xhi, wx = _weights(shape[1], coarse.shape[-1], factor)
+    wy = wy[:, None]
+
+    rows = coarse[..., ylo, :] * (1.0 - wy) + coarse[..., yhi, :] * wy
+    return rows[..., xlo] * (1.0 - wx) + rows[..., xhi] * wx
+
+def _solve(datetime, lat, lon, met, **kwargs):
+    """Liljegren WBGT on a (time, y, x) grid"""
+
+    ntime = datetime.size
+    npnt  = lat.size
+    res   = wetbulb_globe(
+        DatetimeIndex(numpy.repeat(datetime.values, npnt)),
+        numpy.tile(lat.ravel(), ntime),
+        numpy.tile(lon.ravel(), ntime),
+        *(val.ravel() for val in met),
+        **kwargs,
+    )
+    shape = (ntime,) + lat.shape
+    return {
+        key : val.reshape(shape) if getattr(val, 'size', 1) == ntime*npnt else val
+        for key, val in res.items()
+    }
+
+def wbgt_multires(
+        datetime, lat, lon,
+        solar, pres, temp_air, temp_dew, speed,
+        factor = FACTOR,
+        **kwargs,
+    ):
+    """
+    Liljegren WBGT on a grid, warm started from a coarsened grid
+
+    Arguments:
+        datetime (pandas.DatetimeIndex) : Datetime of each time step
+        lat (ndarray) : Latitude; either 1-D (y) coordinate or 2-D (y, x)
+        lon (ndarray) : Longitude; either 1-D (x) coordinate or 2-D (y, x)
+        solar (Quantity) : solar irradiance; (time, y, x)
+        pres (Quantity) : barometric pressure; (time, y, x)
+        temp_air (Quantity) : air (dry bulb) temperature; (time, y, x)
+        temp_dew (Quantity) : Dew point temperature; (time, y, x)
+        speed (Quantity) : wind speed; (time, y, x)
+
+    Keyword arguments:
+        factor (int) : Number of fine cells per coarse cell along each
+            spatial dimension. One (1) disables the warm start
+        **kwargs : All other keywords are passed to
+            liljegren.wetbulb_globe() for both grids, so must be scalars
+            (e.g., iterations=True to return solver iterations)
+
+    Returns:
+        dict : Same as pywbgt.wbgt(), with values of shape (time, y, x)
+
+    """
+
+    datetime = datetime_check(datetime)
+    met      = [solar, pres, temp_air, temp_dew, speed]
+    shape    = met[0].shape
+    if datetime.size != shape[0]:
+        raise Exception('Size mismatch between datetime and first dimension of inputs!')
+
+    lat = numpy.asarray(lat, dtype=numpy.float64)
+    lon = numpy.asarray(lon, dtype=numpy.float64)
+    if lat.ndim == 1 and lon.ndim == 1:
+        lat, lon = numpy.meshgrid(lat, lon, indexing='ij')
+    lat = numpy.broadcast_to(lat, shape[1:])
+    lon = numpy.broadcast_to(lon, shape[1:])
+
+    if factor <= 1 or min(shape[1:]) < 2*factor:
+        return _solve(datetime, lat, lon, met, **kwargs)
+
+    coarse = _solve(
+        datetime, coarsen(lat, factor), coarsen(lon, factor),
+        [units.Quantity(coarsen(val.magnitude, factor), val.units) for val in met],
+        **{key : val for key, val in kwargs.items() if key != 'iterations'},
+    )
+
+    guesses = {
+        key : units.Quantity(
+            upsample(coarse[var].to('kelvin').magnitude, shape[1:], factor).ravel(),
+            'kelvin',
+        )
+        for key, var in (('tg_guess', 'Tg'), ('tnwb_guess', 'Tnwb'))
+    }
+
+    return _solve(datetime, lat, lon, met, **guesses, **kwargs)
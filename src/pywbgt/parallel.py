@@ -0,0 +1,207 @@
+"""
+Thread control for the parallel kernels
+
+The solar geometry is computed by numba kernels, and WBGT by Cython
+kernels parallelized with OpenMP. By default numba starts its own pool
+of threads (TBB or workqueue), so a process using both has two pools
+competing for the same cores. When this module is imported, numba is
+switched to its OpenMP threading layer, which uses the same OpenMP
+runtime as the Cython kernels, so only one pool of worker threads
+exists per process. Setting the NUMBA_THREADING_LAYER environment
+variable overrides this.
+
+The number of threads used by all kernels is set with set_num_threads().
+If threadpoolctl is installed, a controller for numba is registered so
+that threadpoolctl.threadpool_limits() limits numba as well as the
+OpenMP runtime used by the Cython kernels.
+
+On multi-socket (NUMA) nodes, threads should be bound to cores so that
+each stays near the memory it first touched; see thread_binding().
+
+"""
+
+import os
+from contextlib import contextmanager
+
+import numba
+
+from .liljegren import get_openmp_threads, set_openmp_threads
+
+try:
+    import threadpoolctl
+except ImportError:
+    threadpoolctl = None
+
+# Layer used when none is requested through the environment
+THREADING_LAYER = 'omp'
+
+# OpenMP environment that binds threads to cores, spread over sockets
+BINDING_ENVIRONMENT = {
+    'OMP_PROC_BIND' : 'spread',
+    'OMP_PLACES'    : 'cores',
+}
+
+def _omp_layer_available():
+
+    try:
+        from numba.np.ufunc import omppool
+    except ImportError:
+        return False
+    return omppool.openmp_vendor is not None
+
+def configure_threading():
+    """
+    Select the numba threading layer shared with the Cython kernels
+
+    Has no effect if the NUMBA_THREADING_LAYER environment variable is
+    set, if the OpenMP layer is not available, or once numba has started
+    its threads.
+
+    Returns:
+        str : Name of the requested threading layer
+
+    """
+
+    if 'NUMBA_THREADING_LAYER' in os.environ:
+        return numba.config.THREADING_LAYER
+    if numba.config.THREADING_LAYER == 'default' and _omp_layer_available():
+        numba.config.THREADING_LAYER = THREADING_LAYER
+    return numba.config.THREADING_LAYER
+
+def max_threads():
+    """Largest number of threads that set_num_threads() can use"""
+
+    return numba.config.NUMBA_NUM_THREADS
+
+def thread_counts(nmax=None):
+    """Powers of two up to nmax, and nmax; default is max_threads()"""
+
+    nmax   = nmax or max_threads()
+    counts = [2**i for i in range(nmax.bit_length()) if 2**i <= nmax]
+    if counts[-1] != nmax:
+        counts.append(nmax)
+    return counts
+
+def get_num_threads():
+    """Number of threads used by kernels called from this thread"""
+
+    return min(numba.get_num_threads(), get_openmp_threads())
+
+def set_num_threads(nthreads):
+    """
+    Set number of threads used by kernels called from this thread
+
+    Applies to both the numba and Cython (OpenMP) kernels. As with
+    numba.set_num_threads() and omp_set_num_threads(), the setting is
+    per calling thread, so each thread of, e.g., a dask worker can have
+    its own budget.
+
+    Arguments:
+        nthreads (int) : Number of threads; None for max_threads()
+
+    Returns:
+        int : Previous number of threads
+
+    """
+
+    previous = get_num_threads()
+    if nthreads is None:
+        nthreads = max_threads()
+    nthreads = min(max(int(nthreads), 1), max_threads())
+    numba.set_num_threads(nthreads)
+    set_openmp_threads(nthreads)
+    return previous
+
+def numa_nodes():
+    """Number of NUMA nodes on this machine; one (1) if unknown"""
+
+    try:
+        nodes = os.listdir('/sys/devices/system/node')
+    except OSError:
+        return 1
+    return max(sum(node.startswith('node') and node[4:].isdigit() for node in nodes), 1)
+
+def thread_binding():
+    """
+    Report how OpenMP threads are bound to cores
+
+    The OpenMP runtime reads OMP_PROC_BIND and OMP_PLACES when it starts,
+    so they must be set in the environment before Python starts, e.g.:
+
+        OMP_PROC_BIND=spread OMP_PLACES=cores python script.py
+
+    Unbound threads may migrate between sockets, away from the pages they
+    first touched. Binding is recommended when numa_nodes() is more than
+    one (1).
+
+    Returns:
+        dict :
+            - OMP_PROC_BIND, OMP_PLACES : Current values; None if not set
+            - cpus : Number of CPUs this process may run on
+            - numa_nodes : Number of NUMA nodes
+            - recommended : Environment to set; empty if already bound or
+              only one (1) NUMA node
+
+    """
+
+    current = {key : os.environ.get(key) for key in BINDING_ENVIRONMENT}
+    nodes   = numa_nodes()
+    if hasattr(os, 'sched_getaffinity'):
+        cpus = len(os.sched_getaffinity(0))
+    else:
+        cpus = os.cpu_count()
+
+    recommended = {}
+    if nodes > 1 and current['OMP_PROC_BIND'] in (None, 'false'):
+        recommended = dict(BINDING_ENVIRONMENT)
+
+    return {
+        **current,
+        'cpus'        : cpus,
+        'numa_nodes'  : nodes,
+        'recommended' : recommended,
+    }
+
+@contextmanager
+def num_threads(nthreads):
+    """
+    Limit threads used by kernels called from the current thread
+
+    Arguments:
+        nthreads (int) : Maximum number of threads; None for no limit
+
+    """
+
+    if nthreads is None:
+        yield
+        return
+
+    previous = set_num_threads(nthreads)
+    try:
+        yield
+    finally:
+        set_num_threads(previous)
+
+if threadpoolctl is not None:
+    class NumbaController(threadpoolctl.LibController):
+        """threadpoolctl controller for the numba threading layer"""
+
+        user_api          = 'numba'
+        internal_api      = 'numba'
+        filename_prefixes = ('omppool', 'tbbpool', 'workqueue')
+
+        def get_num_threads(self):
+            return numba.get_num_threads()
+
+        def set_num_threads(self, num_threads):
+            numba.set_num_threads(min(max(int(num_threads), 1), max_threads()))
+
+        def get_version(self):
+            return numba.__version__
+
+        def set_additional_attributes(self):
+            self.threading_layer = self.prefix
+
+    threadpoolctl.register(NumbaController)
+
+configure_threading()
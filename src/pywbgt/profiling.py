@@ -0,0 +1,351 @@
+"""
+Per-stage timing instrumentation
+
+The methods mark their stages (unit conversion, relative humidity, solar
+geometry, buffer copies, solvers, ...) with stage(). Nothing is recorded
+unless a profile() is active, in which case the wall time, number of
+elements, and optionally the bytes allocated by each stage are recorded,
+along with the method the stage ran under:
+
+    import pywbgt
+
+    with pywbgt.profile(memory=True) as prof:
+        pywbgt.wbgt('liljegren', *args)
+
+    prof.to_dict()
+    prof.to_chrome_trace('wbgt.json')   # open in chrome://tracing or Perfetto
+
+Stages nest; e.g., the datetime_adjust and solar_geometry stages are
+inside the solar stage, which is inside the wetbulb_globe stage of the
+method. When disabled, a stage costs one global lookup.
+
+With profile(threads=True), the parallel solver loops also count the
+elements, solver iterations, and busy time of each OpenMP thread, so
+that load imbalance between threads can be measured; see
+Profile.imbalance().
+
+"""
+
+import functools
+import json
+import os
+import threading
+import time
+import tracemalloc
+from contextlib import contextmanager
+
+import numpy
+
+# Per-thread counters of the compiled kernels are this many elements
+# apart, so that threads do not share cache lines
+THREAD_PAD = 8
+
+_active = None
+_local  = threading.local()
+
+class _NullStage:
+    """Stage used when no profile is active"""
+
+    __slots__ = ()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        return False
+
+_NULL_STAGE = _NullStage()
+
+class _Stage:
+
+    __slots__ = ('prof', 'name', 'method', 'size', 'start', 'current', 'peak')
+
+    def __init__(self, prof, name, method, size):
+
+        self.prof   = prof
+        self.name   = name
+        self.method = method
+        self.size   = size
+
+    def __enter__(self):
+
+        stack = _stack()
+        if self.method is None and stack:
+            self.method = stack[-1].method
+        if self.prof.memory:
+            current, peak = tracemalloc.get_traced_memory()
+            if stack:
+                stack[-1].peak = max(stack[-1].peak, peak)
+            tracemalloc.reset_peak()
+            self.current = self.peak = current
+        stack.append(self)
+        self.start = time.perf_counter_ns()
+        return self
+
+    def __exit__(self, *args):
+
+        stop  = time.perf_counter_ns()
+        stack = _stack()
+        stack.pop()
+        nbytes = None
+        if self.prof.memory:
+            self.peak = max(self.peak, tracemalloc.get_traced_memory()[1])
+            nbytes    = self.peak - self.current
+            if stack:
+                stack[-1].peak = max(stack[-1].peak, self.peak)
+        self.prof.events.append({
+            'name'    : self.name,
+            'method'  : self.method,
+            'start'   : (self.start - self.prof.start) / 1.0e9,
+            'seconds' : (stop - self.start) / 1.0e9,
+            'size'    : self.size,
+            'bytes'   : nbytes,
+            'depth'   : len(stack),
+            'thread'  : threading.get_ident(),
+        })
+        return False
+
+def _stack():
+
+    stack = getattr(_local, 'stack', None)
+    if stack is None:
+        stack = _local.stack = []
+    return stack
+
+class Profile:
+    """
+    Stage timings recorded by profile()
+
+    Attributes:
+        events (list) : One dict per stage call, in order of completion,
+            with the stage name, method, start and duration (seconds,
+            from the start of the profile), number of elements, bytes
+            allocated (peak traced memory above that at the start of the
+            stage; None unless memory is set), nesting depth, and thread
+        regions (list) : One dict per parallel loop, if threads is set,
+            with the region name, method, and the elements, solver
+            iterations, and busy seconds of each thread
+
+    """
+
+    def __init__(self, memory=False, threads=False):
+
+        self.memory  = memory
+        self.threads = threads
+        self.events  = []
+        self.regions = []
+        self.start   = time.perf_counter_ns()
+
+    def to_dict(self):
+        """
+        Totals of each stage of each method
+
+        Returns:
+            dict : Keyed by method, then by stage, of dicts with the number
+                of calls, total seconds, elements, and bytes. Stages run
+                outside of any method are under None
+
+        """
+
+        out = {}
+        for event in self.events:
+            stages = out.setdefault(event['method'], {})
+            total  = stages.setdefault(
+                event['name'],
+                {'calls' : 0, 'seconds' : 0.0, 'elements' : 0, 'bytes' : None},
+            )
+            total['calls']    += 1
+            total['seconds']  += event['seconds']
+            total['elements'] += event['size'] or 0
+            if event['bytes'] is not None:
+                total['bytes'] = (total['bytes'] or 0) + event['bytes']
+        return out
+
+    def imbalance(self):
+        """
+        Load imbalance of each parallel region of each method
+
+        The imbalance of a quantity is its maximum over threads divided by
+        its mean over threads, so one (1) is perfectly balanced and the
+        number of threads means all work was done by one thread. Per-thread
+        totals over all calls of a region are used.
+
+        Returns:
+            dict : Keyed by method, then by region, of dicts with the
+                number of calls and threads, the per-thread totals of
+                elements, iterations, and busy seconds, and the imbalance
+                of each
+
+        """
+
+        keys = ('elements', 'iterations', 'busy')
+        out  = {}
+        for region in self.regions:
+            regions = out.setdefault(region['method'], {})
+            total   = regions.setdefault(
+                region['name'], {'calls' : 0, **{key : [] for key in keys}},
+            )
+            total['calls'] += 1
+            for key in keys:
+                total[key].append(region[key])
+
+        # Thread counts may differ between calls; missing threads did no work
+        for regions in out.values():
+            for total in regions.values():
+                nthreads = max(len(val) for val in total['elements'])
+                total['threads'] = nthreads
+                for key in keys:
+                    total[key] = sum(
+                        numpy.pad(val, (0, nthreads - len(val))) for val in total[key]
+                    )
+                total['imbalance'] = {key : _imbalance(total[key]) for key in keys}
+                for key in keys:
+                    total[key] = total[key].tolist()
+        return out
+
+    def to_chrome_trace(self, path=None):
+        """
+        Stage calls in the Chrome trace event format
+
+        Keyword arguments:
+            path (str) : If given, the trace is also written to this JSON
+                file, which can be opened in chrome://tracing or Perfetto
+
+        Returns:
+            dict : Trace with one complete ('X') event per stage call
+
+        """
+
+        pid   = os.getpid()
+        trace = {
+            'traceEvents' : [
+                {
+                    'name' : event['name'],
+                    'cat'  : event['method'] or 'pywbgt',
+                    'ph'   : 'X',
+                    'ts'   : event['start'] * 1.0e6,
+                    'dur'  : event['seconds'] * 1.0e6,
+                    'pid'  : pid,
+                    'tid'  : event['thread'],
+                    'args' : {
+                        'elements' : event['size'],
+                        'bytes'    : event['bytes'],
+                    },
+                }
+                for event in self.events
+            ],
+            'displayTimeUnit' : 'ms',
+        }
+        if path is not None:
+            with open(path, 'w') as fid:
+                json.dump(trace, fid)
+        return trace
+
+def _imbalance(values):
+    """Maximum over mean; NaN if there is no work"""
+
+    mean = numpy.mean(values)
+    return float(numpy.max(values) / mean) if mean > 0 else float('nan')
+
+@contextmanager
+def profile(memory=False, threads=False):
+    """
+    Record the stages of all WBGT calculations within the context
+
+    Keyword arguments:
+        memory (bool) : If set, also record bytes allocated by each stage
+            using tracemalloc. This slows down the calculations, and
+            allocations of concurrent threads are attributed to whichever
+            stage is recording
+        threads (bool) : If set, also record per-thread counters of the
+            parallel solver loops; see Profile.imbalance(). This adds two
+            timer calls per element
+
+    Returns:
+        Profile : Recorded stage timings
+
+    """
+
+    global _active
+
+    prof     = Profile(memory, threads)
+    previous = _active
+    tracing  = memory and not tracemalloc.is_tracing()
+    if tracing:
+        tracemalloc.start()
+    _active = prof
+    try:
+        yield prof
+    finally:
+        _active = previous
+        if tracing:
+            tracemalloc.stop()
+
+def stage(name, size=None, method=None):
+    """
+    Context manager marking a stage of a calculation
+
+    Arguments:
+        name (str) : Name of the stage
+
+    Keyword arguments:
+        size (int) : Number of elements processed
+        method (str) : Name of the WBGT method; default is that of the
+            enclosing stage
+
+    """
+
+    if _active is None:
+        return _NULL_STAGE
+    return _Stage(_active, name, method, size)
+
+def threads_enabled():
+    """True if per-thread counters are being recorded"""
+
+    return _active is not None and _active.threads
+
+def record_region(name, elements, iterations, busy):
+    """
+    Record per-thread counters of a parallel region
+
+    Called by the compiled kernels after a parallel loop when
+    threads_enabled() is true. Counters of thread i are at element
+    i*THREAD_PAD of each array.
+
+    Arguments:
+        name (str) : Name of the parallel region
+        elements (ndarray) : Number of elements processed by each thread
+        iterations (ndarray) : Number of solver iterations of each thread
+        busy (ndarray) : Seconds spent computing by each thread
+
+    """
+
+    if _active is None:
+        return
+    stack = _stack()
+    _active.regions.append({
+        'name'       : name,
+        'method'     : stack[-1].method if stack else None,
+        'elements'   : numpy.asarray(elements)[::THREAD_PAD].copy(),
+        'iterations' : numpy.asarray(iterations)[::THREAD_PAD].copy(),
+        'busy'       : numpy.asarray(busy)[::THREAD_PAD].copy(),
+    })
+
+def profiled(method, name='wetbulb_globe'):
+    """
+    Decorator marking a whole function as a stage of method
+
+    The number of elements is the size of the first argument.
+
+    """
+
+    def decorator(func):
+        @functools.wraps(func)
+        def wrapper(*args, **kwargs):
+            if _active is None:
+                return func(*args, **kwargs)
+            size = getattr(args[0], 'size', None) if args else None
+            with _Stage(_active, name, method, size):
+                return func(*args, **kwargs)
+        return wrapper
+    return decorator
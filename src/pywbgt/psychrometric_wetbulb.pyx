@@ -6,66 +6,19 @@ Algorithms for computing psychrometric wetbulb temperature
 from cython.parallel import prange
 import numpy
 
-from libc.math cimport exp, fabsf
-
 cimport numpy
 cimport cython
 
-from metpy.calc import relative_humidity_from_dewpoint as relative_humidity
-
-cdef:
-    float C0  =   26.66082
-    float C1  =    0.0091379024
-    float C2  = 6106.396
-
-    float Cp  = 1004.0    # J/K/kg
-    float L   =    2.54e6 # J/kg
-    float eps =    0.622
-    float f   = Cp/L/eps
-
-cdef float saturation( float T ) nogil:
-
-    return <float>exp( <float>C0 - C1*T - C2/T )
-
-cdef float _iribarne_wb( float temp_a, float temp_d, float pres, int maxfev, float xtol) nogil:
-    """
-    Iteratively compute the wet-bulb temperature 
-
-    Uses the Iribarne and Godson (1981) method to calculate the
-    wet-bulb temperature given dry-bulb temperature, dew point
-    temperature, and atmospheric pressure.
-
-    Arguments:
-        temp_a : Dry-bulb temperature (Kelvin)
-        temp_d : Dew-point temperature (Kelvin)
-        pres   : Atmoshperic pressure (hPa)
-        maxfev : Maximum number of iterations to perform
-        xtol : Calculation will terminate if the relative error between
-            two consecutive iterates is at most xtol
-
-    Returns:
-        float : Wet-bulb temperature in Kelvin
+from .cpsychrometric_wetbulb cimport *
 
-    """
-
-    cdef float e_sat, e_atm, e_wb, e_adj, temp_w, denom, numer, adjust 
-
-    e_sat = saturation( temp_a )
-    e_atm = saturation( temp_d )
-    e_adj = (e_sat-e_atm)/(temp_a-temp_d)
-
-    temp_w  = (temp_a*f*pres + temp_d*e_adj)/(f*pres + e_adj)
+from metpy.calc import relative_humidity_from_dewpoint as relative_humidity
 
-    while maxfev > 0:                                                             # While have NOT reached max iteration
-        e_wb    = saturation( temp_w )                                                     # Compute saturation vapor pressure for wet-bulb temperature
-        numer   = f*pres*(temp_a-temp_w) - (e_wb-e_atm)                                                # Computer error
-        denom   = e_wb*(C1-C2/temp_w**2) - f*pres
-        adjust  = numer / denom
-        temp_w -= adjust 
-        if fabsf(adjust) < xtol: return temp_w
-        maxfev -= 1
+# ISA level of the solver; see pywbgt.isa
+def _isa_level():
+    return iribarne_isa_level()
 
-    return 0.0/0.0
+def _isa_select(int level):
+    return iribarne_isa_select(level) == 0
 
 @cython.binding(True)
 def stull( temp_a, temp_d ):
@@ -147,6 +100,11 @@ def iribarne(temp_a, temp_d, pres=None, **kwargs):
             pres.astype(  numpy.float32 )
         )
 
+    # As before the solver was moved to C, saturated air (dew point equal
+    # to air temperature) is a division by zero
+    if numpy.any( numpy.asarray(temp_a_view) == numpy.asarray(temp_d_view) ):
+        raise ZeroDivisionError( 'float division' )
+
     for i in prange( size, nogil=True ):
         out_view[i] = _iribarne_wb(
             temp_a_view[i],
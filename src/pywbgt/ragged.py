@@ -0,0 +1,122 @@
+"""
+Ragged station records
+
+Station archives (e.g., ISD, MADIS) hold many stations with records of
+very different lengths. Rather than broadcasting each station's metadata
+to every observation, the observations of all stations are stored end to
+end in flat arrays and a table of offsets marks where each station's
+record starts. Station metadata (latitude, longitude, urban flag, wind
+measurement height, ...) are then stored once per station.
+
+"""
+
+import numpy
+from metpy.units import units
+
+from .liljegren import wetbulb_globe_ragged
+
+def ragged_offsets(station_ids):
+    """
+    Compute station offsets from sorted station identifiers
+
+    Arguments:
+        station_ids (ndarray) : Station identifier for each observation;
+            observations of each station must be contiguous
+
+    Returns:
+        tuple : Unique station identifiers, in order of appearance, and
+            offsets of the first observation of each station with the
+            total number of observations as the last element
+
+    """
+
+    station_ids = numpy.asarray(station_ids)
+    if station_ids.size == 0:
+        return station_ids, numpy.zeros(1, dtype=numpy.int64)
+
+    starts = numpy.flatnonzero(station_ids[1:] != station_ids[:-1]) + 1
+    starts = numpy.concatenate([[0], starts])
+    ids    = station_ids[starts]
+    if numpy.unique(ids).size != ids.size:
+        raise Exception('Observations of each station must be contiguous!')
+
+    return ids, numpy.append(starts, station_ids.size).astype(numpy.int64)
+
+def expand_stations(offsets, values):
+    """
+    Repeat per-station values for each observation of the station
+
+    Arguments:
+        offsets (ndarray) : Station offsets; see ragged_offsets()
+        values (ndarray, Quantity) : One (1) value per station
+
+    Returns:
+        ndarray, Quantity : One (1) value per observation
+
+    """
+
+    counts = numpy.diff(offsets)
+    if hasattr(values, 'units'):
+        return units.Quantity(numpy.repeat(values.magnitude, counts), values.units)
+    return numpy.repeat(values, counts)
+
+def wbgt_ragged(
+        method, datetime, offsets, stations,
+        solar, pres, temp_air, temp_dew, speed,
+        **kwargs,
+    ):
+    """
+    Estimate wet bulb globe temperature for ragged station records
+
+    For the Liljegren method, station metadata are looked up in the
+    kernel and stations are processed in parallel. For the other methods,
+    which do not need per-station metadata in their inner loops, the
+    latitude, longitude and zspeed of each station are expanded to the
+    observations and passed to wbgt().
+
+    Arguments:
+        method (str) : name of the method to use.
+        datetime (pandas.DatetimeIndex) : Datetime of each observation
+        offsets (ndarray) : Index of first observation of each station with
+            the total number of observations as the last element
+        stations (Mapping) : Station metadata table with one (1) row per
+            station; see liljegren.wetbulb_globe_ragged()
+        solar (Quantity) : solar irradiance; units of any power over area
+        pres (Quantity) : barometric pressure; units of pressure
+        temp_air (Quantity) : air (dry bulb) temperature; units of temperature
+        temp_dew (Quantity) : Dew point temperature; units of temperature
+        speed (Quantity) : wind speed; units of speed
+
+    Keyword arguments:
+        **kwargs : All other keywords are passed to the algorithm
+
+    Returns:
+        dict : Output of the algorithm for each observation
+
+    """
+
+    from . import wbgt
+
+    method = method.lower()
+    if method == 'liljegren':
+        return wetbulb_globe_ragged(
+            datetime, offsets, stations,
+            solar, pres, temp_air, temp_dew, speed,
+            **kwargs,
+        )
+
+    offsets = numpy.asarray(offsets, dtype=numpy.int64)
+    zspeed  = stations.get('zspeed')
+    if zspeed is not None:
+        if not hasattr(zspeed, 'to'):
+            zspeed = units.Quantity(numpy.asarray(zspeed, dtype=float), 'meter')
+        kwargs['zspeed'] = expand_stations(offsets, zspeed)
+
+    return wbgt(
+        method,
+        datetime,
+        expand_stations(offsets, numpy.asarray(stations['lat'], dtype=float)),
+        expand_stations(offsets, numpy.asarray(stations['lon'], dtype=float)),
+        solar, pres, temp_air, temp_dew, speed,
+        **kwargs,
+    )
@@ -0,0 +1,527 @@
+"""
+Mergeable reductions over WBGT output
+
+Reductions are updated one chunk of output at a time and can save and
+restore their running state as a flat dict of numpy arrays. This lets the
+chunked drivers store the state in a checkpoint file and resume a job
+without re-reading chunks that were already processed.
+
+"""
+
+import numpy
+
+from .utils import datetime_check
+
+# Earliest day of the latest chunk before any chunk is seen
+NO_DAY = numpy.iinfo(numpy.int64).min
+
+def _days(datetime):
+    """Day (since the Unix epoch) of each datetime"""
+
+    return (
+        datetime_check(datetime)
+        .values
+        .astype('datetime64[D]')
+        .astype(numpy.int64)
+    )
+
+class _Daily:
+    """
+    Running state of a reduction keyed by day and an integer key
+
+    The state of each day is a set of dense arrays indexed by key (e.g.,
+    a location or zone), so a chunk only updates the days and keys it
+    contains. While chunks arrive in time order, the days before the
+    earliest day of the latest chunk are complete; flush() returns each
+    of them once, so that a checkpoint only writes them once. A flushed
+    day that receives more data (i.e., the chunks are not in time order)
+    is open again and is saved with the open days from then on.
+
+    Subclasses set FIELDS, the dtype and fill value of the arrays of a
+    day, and RECORDS, the dtype of each array of the flat state, and
+    implement _nkey(), _add(), and _records().
+
+    """
+
+    FIELDS  = {}
+    RECORDS = {}
+
+    def __init__(self):
+        self._clear()
+
+    def _clear(self):
+        self._state   = {}
+        self._open    = set()
+        self._begin   = NO_DAY
+        self._ordered = True
+
+    def _touch(self, day):
+        """
+        Arrays of each day of a chunk
+
+        Arguments:
+            day (ndarray) : Day of each value of the chunk
+
+        Returns:
+            generator : Arrays of each day, and the indices of the values
+                of the day in the chunk
+
+        """
+
+        if day.size == 0:
+            return
+        first = day.min()
+        if first < self._begin:
+            self._ordered = False
+        elif self._ordered:
+            self._begin = first
+
+        nkey  = self._nkey()
+        order = numpy.argsort(day, kind='stable')
+        days, start = numpy.unique(day[order], return_index=True)
+        for today, index in zip(days.tolist(), numpy.split(order, start[1:])):
+            self._open.add(today)
+            arrays = self._state.get(today)
+            size   = 0 if arrays is None else arrays[next(iter(self.FIELDS))].size
+            if size < nkey:
+                # Grow at least twofold, so that days updated as keys are
+                # added (e.g., station after station) are not copied each time
+                grown = {}
+                for name, (dtype, fill) in self.FIELDS.items():
+                    grown[name] = numpy.full(max(nkey, 2*size), fill, dtype=dtype)
+                    if arrays is not None:
+                        grown[name][:size] = arrays[name]
+                arrays = self._state[today] = grown
+            yield arrays, index
+
+    def _collect(self, days):
+        """State of days as a dict of flat arrays"""
+
+        parts = [self._records(day, self._state[day]) for day in sorted(days)]
+        return {
+            key : numpy.concatenate(
+                [part[key] for part in parts] + [numpy.empty(0, dtype=dtype)],
+            )
+            for key, dtype in self.RECORDS.items()
+        }
+
+    def flush(self):
+        """
+        State of the days completed since the last flush
+
+        Returns:
+            dict : Flat arrays, as for state(), of the days before the
+                earliest day of the latest chunk that were not flushed
+                before; empty if the chunks are not in time order
+
+        """
+
+        days = {day for day in self._open if self._ordered and day < self._begin}
+        self._open -= days
+        return self._collect(days)
+
+    def state(self, flushed=True):
+        """
+        Return running state as a dict of arrays
+
+        Keyword arguments:
+            flushed (bool) : If unset, leave out the days returned by
+                flush(); restore with load(state, flushed)
+
+        """
+
+        days = self._state if flushed else self._open
+        out  = self._collect(days)
+        out['begin']   = numpy.int64(self._begin)
+        out['ordered'] = numpy.bool_(self._ordered)
+        return out
+
+    def load(self, state, flushed=()):
+        """
+        Restore running state from dict of arrays
+
+        Arguments:
+            state (dict) : Running state; see state()
+
+        Keyword arguments:
+            flushed (list) : Outputs of flush(), in order, if state was
+                saved without the flushed days
+
+        """
+
+        self._clear()
+        for part in (*flushed, state):
+            # Each holds the whole state of its days; a day opened again
+            # after it was flushed is also in a later one
+            for day in numpy.unique(part['day']).tolist():
+                self._state.pop(day, None)
+            self._open = set()
+            self._add(part)
+        self._begin   = int(state.get('begin', NO_DAY))
+        self._ordered = bool(state.get('ordered', True))
+
+    def merge(self, other):
+        """
+        Merge the state of another reduction of the same kind into this one
+
+        """
+
+        self._add(other.state())
+
+class DailyMax(_Daily):
+    """
+    Daily maximum of a variable at each location
+
+    Maxima are tracked for each unique (day, latitude, longitude)
+    combination seen in the data. Locations are numbered as they are
+    first seen, and each day holds the maxima of all locations.
+
+    Keyword arguments:
+        var (str) : Name of the variable to reduce; must be a key in the
+            dict returned by the WBGT algorithms. Default is Twbg
+
+    """
+
+    FIELDS  = {
+        'value' : (numpy.float64, numpy.nan),
+        'seen'  : (numpy.bool_,   False),
+    }
+    RECORDS = {
+        'day'   : numpy.int64,
+        'lat'   : numpy.float64,
+        'lon'   : numpy.float64,
+        'value' : numpy.float64,
+    }
+
+    def __init__(self, var='Twbg'):
+        self.var = var
+        super().__init__()
+
+    def _clear(self):
+        super()._clear()
+        self.lat   = numpy.empty(0, dtype=numpy.float64)
+        self.lon   = numpy.empty(0, dtype=numpy.float64)
+        # Sorted locations as complex numbers, which sort by real, then
+        # imaginary, part (i.e., latitude, then longitude), their index,
+        # and the rank of each index in that order
+        self._keys = numpy.empty(0, dtype=numpy.complex128)
+        self._sort = numpy.empty(0, dtype=numpy.int64)
+        self._rank = numpy.empty(0, dtype=numpy.int64)
+
+    def _nkey(self):
+        return self.lat.size
+
+    def _locations(self, lat, lon):
+        """Index of each location, numbering locations not seen before"""
+
+        key = (
+            numpy.asarray(lat, dtype=numpy.float64) +
+            1j*numpy.asarray(lon, dtype=numpy.float64)
+        )
+        uniq, inverse = numpy.unique(key, return_inverse=True)
+        index = numpy.full(uniq.size, -1, dtype=numpy.int64)
+        if self._keys.size > 0:
+            pos   = numpy.minimum(numpy.searchsorted(self._keys, uniq), self._keys.size-1)
+            found = self._keys[pos] == uniq
+            index[found] = self._sort[pos[found]]
+
+        new = index < 0
+        if new.any():
+            index[new] = numpy.arange(self.lat.size, self.lat.size + new.sum())
+            self.lat   = numpy.concatenate([self.lat, uniq[new].real])
+            self.lon   = numpy.concatenate([self.lon, uniq[new].imag])
+            keys       = numpy.concatenate([self._keys, uniq[new]])
+            order      = numpy.argsort(keys, kind='stable')
+            self._keys = keys[order]
+            self._sort = numpy.concatenate([self._sort, index[new]])[order]
+            self._rank = numpy.empty(self._sort.size, dtype=numpy.int64)
+            self._rank[self._sort] = numpy.arange(self._sort.size)
+        return index[inverse.ravel()]
+
+    def update(self, datetime, lat, lon, result):
+        """
+        Update maxima with a chunk of output
+
+        Arguments:
+            datetime (pandas.DatetimeIndex) : Datetime(s) of the chunk
+            lat (ndarray) : Latitude(s) of the chunk
+            lon (ndarray) : Longitude(s) of the chunk
+            result (dict) : Output from a WBGT algorithm for the chunk
+
+        """
+
+        value = result[self.var]
+        value = numpy.asarray(getattr(value, 'magnitude', value), dtype=numpy.float64)
+        size  = value.size
+        self._add({
+            'day'   : _days(datetime),
+            'lat'   : numpy.resize(lat, size),
+            'lon'   : numpy.resize(lon, size),
+            'value' : value,
+        })
+
+    def _add(self, state):
+
+        loc   = self._locations(state['lat'], state['lon'])
+        value = numpy.asarray(state['value'], dtype=numpy.float64)
+        for arrays, index in self._touch(numpy.asarray(state['day'], dtype=numpy.int64)):
+            # NaN values (non-converged points) do not contribute to the max
+            numpy.fmax.at(arrays['value'], loc[index], value[index])
+            arrays['seen'][loc[index]] = True
+
+    def _records(self, day, arrays):
+
+        seen  = numpy.flatnonzero(arrays['seen'][:self.lat.size])
+        index = seen[numpy.argsort(self._rank[seen])]
+        return {
+            'day'   : numpy.full(index.size, day, dtype=numpy.int64),
+            'lat'   : self.lat[index],
+            'lon'   : self.lon[index],
+            'value' : arrays['value'][index],
+        }
+
+    def result(self):
+        """
+        Final value of the reduction
+
+        Returns:
+            dict : Arrays of day (numpy.datetime64), lat, lon, and
+                daily maximum values
+
+        """
+
+        state = self._collect(self._state)
+        return {
+            'day'   : state['day'].astype('datetime64[D]'),
+            'lat'   : state['lat'],
+            'lon'   : state['lon'],
+            self.var : state['value'],
+        }
+
+class Histogram:
+    """
+    Fixed-bin histogram sketch of a variable
+
+    A histogram is a small, exactly mergeable sketch of the distribution of
+    a variable that can be used to estimate quantiles over records too long
+    to hold in memory.
+
+    Keyword arguments:
+        var (str) : Name of the variable to reduce; must be a key in the
+            dict returned by the WBGT algorithms. Default is Twbg
+        bins (ndarray) : Bin edges of the histogram. Default is 0.1 degree
+            bins from -50 to 60
+
+    """
+
+    def __init__(self, var='Twbg', bins=None):
+        self.var    = var
+        self.bins   = (
+            numpy.linspace(-50.0, 60.0, 1101) if bins is None else
+            numpy.asarray(bins, dtype=numpy.float64)
+        )
+        self.counts = numpy.zeros(self.bins.size-1, dtype=numpy.int64)
+
+    def update(self, datetime, lat, lon, result):
+        """
+        Update counts with a chunk of output
+
+        Arguments:
+            datetime (pandas.DatetimeIndex) : Datetime(s) of the chunk
+            lat (ndarray) : Latitude(s) of the chunk
+            lon (ndarray) : Longitude(s) of the chunk
+            result (dict) : Output from a WBGT algorithm for the chunk
+
+        """
+
+        value = result[self.var]
+        value = numpy.asarray(getattr(value, 'magnitude', value))
+        self.counts += numpy.histogram(value[numpy.isfinite(value)], self.bins)[0]
+
+    def merge(self, other):
+        """
+        Merge the state of another Histogram into this one
+
+        """
+
+        if not numpy.array_equal(self.bins, other.bins):
+            raise Exception('Can only merge histograms with same bins!')
+        self.counts += other.counts
+
+    def quantile(self, quant):
+        """
+        Estimate quantile(s) by interpolating within bins
+
+        Arguments:
+            quant (float, ndarray) : Quantile(s) to estimate; between 0 and 1
+
+        Returns:
+            float, ndarray : Estimated value(s) at quantile(s)
+
+        """
+
+        cdf = numpy.concatenate([[0], numpy.cumsum(self.counts)])
+        if cdf[-1] == 0:
+            return numpy.full(numpy.shape(quant), numpy.nan)
+        return numpy.interp(numpy.asarray(quant) * cdf[-1], cdf, self.bins)
+
+    def state(self):
+        """Return running state as a dict of arrays"""
+
+        return {'bins' : self.bins, 'counts' : self.counts}
+
+    def load(self, state):
+        """Restore running state from dict of arrays"""
+
+        self.bins   = state['bins']
+        self.counts = state['counts']
+
+    def result(self):
+        """
+        Final value of the reduction
+
+        Returns:
+            dict : Arrays of bin edges and counts
+
+        """
+
+        return self.state()
+
+def grid_index(coord, values):
+    """
+    Index of values in a grid coordinate
+
+    Arguments:
+        coord (ndarray) : Grid coordinate values; ascending or descending
+        values (ndarray) : Values to locate
+
+    Returns:
+        ndarray : Index of each value in coord, or -1 if not on the grid
+
+    """
+
+    coord  = numpy.asarray(coord, dtype=numpy.float64)
+    values = numpy.asarray(values, dtype=numpy.float64)
+    order  = numpy.argsort(coord)
+    pos    = numpy.clip(
+        numpy.searchsorted(coord[order], values),
+        0,
+        coord.size-1,
+    )
+    index  = order[pos]
+    return numpy.where(numpy.isclose(coord[index], values), index, -1)
+
+class ZoneStats(_Daily):
+    """
+    Daily statistics of a variable aggregated over zones
+
+    Each grid point is assigned to a zone (e.g., a county or region) and
+    the count, sum, and maximum of the variable are tracked for each
+    unique (day, zone) combination.
+
+    Arguments:
+        lat (ndarray) : Latitude coordinate of the zone grid
+        lon (ndarray) : Longitude coordinate of the zone grid
+        zone (ndarray) : Integer zone of each grid point with shape
+            (lat.size, lon.size); negative values are not in any zone
+
+    Keyword arguments:
+        var (str) : Name of the variable to reduce; must be a key in the
+            dict returned by the WBGT algorithms. Default is Twbg
+
+    """
+
+    FIELDS  = {
+        'count' : (numpy.int64,   0),
+        'sum'   : (numpy.float64, 0.0),
+        'max'   : (numpy.float64, -numpy.inf),
+    }
+    RECORDS = {
+        'day'   : numpy.int64,
+        'zone'  : numpy.int64,
+        'count' : numpy.int64,
+        'sum'   : numpy.float64,
+        'max'   : numpy.float64,
+    }
+
+    def __init__(self, lat, lon, zone, var='Twbg'):
+        self.var      = var
+        self.grid_lat = numpy.asarray(lat, dtype=numpy.float64)
+        self.grid_lon = numpy.asarray(lon, dtype=numpy.float64)
+        self.grid     = numpy.asarray(zone, dtype=numpy.int64)
+        super().__init__()
+
+    def _nkey(self):
+        return max(int(self.grid.max(initial=-1)) + 1, 0)
+
+    def update(self, datetime, lat, lon, result):
+        """
+        Update statistics with a chunk of output
+
+        Arguments:
+            datetime (pandas.DatetimeIndex) : Datetime(s) of the chunk
+            lat (ndarray) : Latitude(s) of the chunk
+            lon (ndarray) : Longitude(s) of the chunk
+            result (dict) : Output from a WBGT algorithm for the chunk
+
+        """
+
+        value = result[self.var]
+        value = numpy.asarray(getattr(value, 'magnitude', value), dtype=numpy.float64)
+        size  = value.size
+        day   = _days(datetime)
+
+        ilat = grid_index(self.grid_lat, numpy.resize(lat, size))
+        ilon = grid_index(self.grid_lon, numpy.resize(lon, size))
+        zone = numpy.where(
+            (ilat >= 0) & (ilon >= 0),
+            self.grid[ilat, ilon],
+            -1,
+        )
+
+        keep  = (zone >= 0) & numpy.isfinite(value)
+        value = value[keep]
+        self._add({
+            'day'   : day[keep],
+            'zone'  : zone[keep],
+            'count' : numpy.ones(value.size, dtype=numpy.int64),
+            'sum'   : value,
+            'max'   : value,
+        })
+
+    def _add(self, state):
+
+        zone = numpy.asarray(state['zone'], dtype=numpy.int64)
+        for arrays, index in self._touch(numpy.asarray(state['day'], dtype=numpy.int64)):
+            size = arrays['count'].size
+            arrays['count'] += numpy.bincount(zone[index], state['count'][index], size).astype(numpy.int64)
+            arrays['sum']   += numpy.bincount(zone[index], state['sum'][index], size)
+            numpy.maximum.at(arrays['max'], zone[index], state['max'][index])
+
+    def _records(self, day, arrays):
+
+        index = numpy.flatnonzero(arrays['count'])
+        return {
+            'day'  : numpy.full(index.size, day, dtype=numpy.int64),
+            'zone' : index,
+            **{name : arrays[name][index] for name in ('count', 'sum', 'max')},
+        }
+
+    def result(self):
+        """
+        Final value of the reduction
+
+        Returns:
+            dict : Arrays of day (numpy.datetime64), zone, number of
+                points, and mean and maximum of the variable
+
+        """
+
+        state = self._collect(self._state)
+        return {
+            'day'   : state['day'].astype('datetime64[D]'),
+            'zone'  : state['zone'],
+            'count' : state['count'],
+            'mean'  : state['sum'] / numpy.maximum(state['count'], 1),
+            'max'   : state['max'],
+        }
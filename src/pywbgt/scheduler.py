@@ -0,0 +1,316 @@
+"""
+Work-stealing task scheduler
+
+Computing several methods over the same points with one parallel loop
+per method leaves threads idle: the cheap Dimiceli methods finish long
+before the iterative Liljegren and Bernard solvers, and the loops of
+one method cannot start until those of the previous one end. Here the
+work is split into per-chunk tasks instead, and run on a pool of
+threads that each keep a double-ended queue (deque) of tasks.
+
+A worker pushes the tasks it spawns onto the back of its own deque and
+pops from the back, so dependent work runs while its inputs are still
+in cache. A worker with an empty deque steals from the front of another
+worker's deque, taking the oldest (and usually largest remaining) work,
+so fast tasks fill the gaps left by slow ones.
+
+Each chunk starts with a solar geometry task, shared by all methods,
+that spawns one WBGT task per method. The compiled kernels release the
+GIL and are limited to one (1) thread inside a task, so the pool
+provides all of the parallelism.
+
+"""
+
+import os
+import random
+import threading
+from collections import deque
+
+import numpy
+from metpy.units import units
+
+from .batch import iter_chunks, slice_arg
+from .constants import OUTPUT_UNITS
+from .parallel import set_num_threads
+from .solar import SOLAR_KWARGS, solar_parameters, normsolar_clipped
+from .utils import datetime_check
+from . import metrics, tuning
+
+CHUNK_SIZE = 2**14
+
+# Relative cost of each method. Method tasks are spawned cheapest first,
+# so the spawning worker, popping newest first, starts the most expensive
+# task while idle workers steal the cheap ones
+METHOD_COST = {
+    'liljegren'    : 3,
+    'bernard'      : 2,
+    'dimiceli'     : 1,
+    'dimiceli_nws' : 1,
+}
+
+_local = threading.local()
+
+class WorkStealingPool:
+    """
+    Pool of threads scheduling tasks with work-stealing deques
+
+    Tasks are submitted from outside the pool with submit(), and may
+    spawn more tasks with spawn(). Call wait() to block until all tasks,
+    including spawned tasks, have finished.
+
+    Keyword arguments:
+        nworkers (int) : Number of worker threads. Default is the number
+            of CPUs
+        kernel_threads (int) : Number of threads the compiled kernels may
+            use within a task. Default is one (1)
+
+    """
+
+    def __init__(self, nworkers=None, kernel_threads=1):
+
+        self.nworkers       = nworkers or os.cpu_count()
+        self.kernel_threads = kernel_threads
+        self.deques         = [deque() for _ in range(self.nworkers)]
+        self.executed       = [0] * self.nworkers
+        self.steals         = [0] * self.nworkers
+
+        self._cond     = threading.Condition()
+        self._pending  = 0
+        self._next     = 0
+        self._errors   = []
+        self._shutdown = False
+        self._threads  = [
+            threading.Thread(target=self._worker, args=(index,), daemon=True)
+            for index in range(self.nworkers)
+        ]
+        for thread in self._threads:
+            thread.start()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.shutdown()
+
+    def submit(self, func, *args, **kwargs):
+        """Add a task from outside the pool; tasks are dealt round robin"""
+
+        with self._cond:
+            index      = self._next
+            self._next = (self._next + 1) % self.nworkers
+            self._pending += 1
+            self.deques[index].append((func, args, kwargs))
+            self._cond.notify_all()
+
+    def spawn(self, func, *args, **kwargs):
+        """
+        Add a task from inside a running task
+
+        The task is pushed onto the back of the calling worker's deque; if
+        not called from a worker, this is the same as submit().
+
+        """
+
+        index = getattr(_local, 'index', None)
+        if getattr(_local, 'pool', None) is not self or index is None:
+            return self.submit(func, *args, **kwargs)
+
+        with self._cond:
+            self._pending += 1
+            self.deques[index].append((func, args, kwargs))
+            self._cond.notify_all()
+
+    def wait(self):
+        """Block until all tasks have finished; re-raise first task error"""
+
+        with self._cond:
+            while self._pending > 0:
+                self._cond.wait()
+            errors, self._errors = self._errors, []
+        if errors:
+            raise errors[0]
+
+    def shutdown(self):
+        """Stop the worker threads once they are idle"""
+
+        with self._cond:
+            self._shutdown = True
+            self._cond.notify_all()
+        for thread in self._threads:
+            thread.join()
+
+    def stats(self):
+        """Number of tasks executed and stolen by each worker"""
+
+        return {
+            'executed' : list(self.executed),
+            'steals'   : list(self.steals),
+        }
+
+    def _take(self, index, rng):
+        """Pop own newest task, or steal oldest task of another worker"""
+
+        try:
+            return self.deques[index].pop()
+        except IndexError:
+            pass
+
+        victims = [i for i in range(self.nworkers) if i != index]
+        rng.shuffle(victims)
+        for victim in victims:
+            try:
+                task = self.deques[victim].popleft()
+            except IndexError:
+                continue
+            self.steals[index] += 1
+            return task
+        return None
+
+    def _worker(self, index):
+
+        _local.pool  = self
+        _local.index = index
+        set_num_threads(self.kernel_threads)
+        rng = random.Random(index)
+
+        while True:
+            task = self._take(index, rng)
+            if task is None:
+                with self._cond:
+                    if self._shutdown and self._pending == 0:
+                        return
+                    # Re-check under the lock so a push is not missed
+                    if not any(self.deques):
+                        self._cond.wait()
+                continue
+
+            func, args, kwargs = task
+            try:
+                func(*args, **kwargs)
+            except Exception as err:
+                with self._cond:
+                    self._errors.append(err)
+            self.executed[index] += 1
+            with self._cond:
+                self._pending -= 1
+                if self._pending == 0:
+                    self._cond.notify_all()
+
+def _method_task(out, method, start, stop, args, kwargs):
+    """Compute one method for one chunk and write it to out"""
+
+    from . import wbgt
+
+    res = wbgt(method, *args, **kwargs)
+    for i, (var, unit) in enumerate(OUTPUT_UNITS.items()):
+        out['values'][i, start:stop] = res[var].to(unit).magnitude
+    if start == 0:
+        out['min_speed'] = res.get('min_speed')
+
+def _chunk_task(pool, outputs, methods, start, stop, args, kwargs, solar_kwargs):
+    """Compute solar geometry for one chunk, then spawn its method tasks"""
+
+    datetime, lat, lon, solar = args[:4]
+    size = stop - start
+    raw  = numpy.asarray(solar.to('watt/m**2').magnitude, dtype=numpy.float64)
+    solar_adj, cza, fdir = solar_parameters(
+        datetime,
+        numpy.broadcast_to(numpy.asarray(lat, dtype=numpy.float64), (size,)).copy(),
+        numpy.broadcast_to(numpy.asarray(lon, dtype=numpy.float64), (size,)).copy(),
+        raw,
+        **solar_kwargs,
+    )
+    # The methods get adjusted solar, so count clipping for each of them here
+    if metrics.enabled():
+        clipped = normsolar_clipped(raw, solar_adj, cza)
+        for method in methods:
+            metrics.record(method.lower(), normsolar_clipped=clipped)
+    args = (*args[:3], units.Quantity(solar_adj, 'watt/m**2'), *args[4:])
+    for method in methods:
+        pool.spawn(
+            _method_task, outputs[method], method, start, stop,
+            args, {**kwargs, 'f_db' : fdir, 'cosz' : cza},
+        )
+
+def wbgt_tasks(
+        methods, datetime, lat, lon,
+        solar, pres, temp_air, temp_dew, speed,
+        chunk_size = None,
+        nworkers   = None,
+        pool       = None,
+        **kwargs,
+    ):
+    """
+    Estimate WBGT with several methods using the work-stealing scheduler
+
+    Arguments:
+        methods (list) : Names of the methods to use
+        datetime (pandas.DatetimeIndex) : Datetime(s) corresponding to data
+        lat (ndarray) : Latitude corresponding to data values (decimal).
+        lon (ndarray) : Longitude corresponding to data values (decimal).
+        solar (Quantity) : solar irradiance; units of any power over area
+        pres (Quantity) : barometric pressure; units of pressure
+        temp_air (Quantity) : air (dry bulb) temperature; units of temperature
+        temp_dew (Quantity) : Dew point temperature; units of temperature
+        speed (Quantity) : wind speed; units of speed
+
+    Keyword arguments:
+        chunk_size (int) : Number of points per task. Default is the
+            smallest tuned chunk size of the methods (see pywbgt.tuning),
+            or CHUNK_SIZE
+        nworkers (int) : Number of worker threads, if pool not given
+        pool (WorkStealingPool) : Pool to run tasks on. Default is to
+            create one for this call
+        **kwargs : All other keywords are passed to wbgt(); arrays with
+            one value per point are split into chunks with the inputs
+
+    Returns:
+        dict : Output of each method, keyed by method name, in the same
+            form as pywbgt.wbgt()
+
+    """
+
+    methods  = [method.lower() for method in methods]
+    datetime = datetime_check(datetime)
+    size     = datetime.size
+    if chunk_size is None:
+        chunk_size = min(tuning.chunk_size(method, CHUNK_SIZE) for method in methods)
+
+    if len(lat) == 1:
+        lat = numpy.repeat(lat, size)
+        lon = numpy.repeat(lon, size)
+
+    solar_kwargs = {key : kwargs.pop(key) for key in SOLAR_KWARGS if key in kwargs}
+    outputs = {
+        method : {
+            'values'    : numpy.full((len(OUTPUT_UNITS), size), numpy.nan),
+            'min_speed' : None,
+        }
+        for method in methods
+    }
+    order = sorted(methods, key=lambda method: METHOD_COST.get(method, 1))
+
+    own  = pool is None
+    pool = pool or WorkStealingPool(nworkers)
+    try:
+        args = (datetime, lat, lon, solar, pres, temp_air, temp_dew, speed)
+        for _, start, stop in iter_chunks(size, chunk_size):
+            pool.submit(
+                _chunk_task, pool, outputs, order, start, stop,
+                tuple(slice_arg(arg, start, stop, size) for arg in args),
+                {key : slice_arg(val, start, stop, size) for key, val in kwargs.items()},
+                {key : slice_arg(val, start, stop, size) for key, val in solar_kwargs.items()},
+            )
+        pool.wait()
+    finally:
+        if own:
+            pool.shutdown()
+
+    res = {}
+    for method, out in outputs.items():
+        res[method] = {
+            var : units.Quantity(out['values'][i], unit)
+            for i, (var, unit) in enumerate(OUTPUT_UNITS.items())
+        }
+        res[method]['min_speed'] = out['min_speed']
+    return res
@@ -0,0 +1,593 @@
+"""
+Local WBGT compute service
+
+A long-lived process that keeps the compiled kernels warm and serves
+WBGT over HTTP, either on a localhost port or a Unix domain socket.
+Concurrent small requests are micro-batched: requests that arrive within
+a short latency window are concatenated into one vectorized call of the
+algorithm and the results split back out per request.
+
+Start from the command line:
+
+    pywbgt-service --port 8765
+    pywbgt-service --socket /tmp/pywbgt.sock
+
+Requests are POSTed to /wbgt as JSON objects with the keys method,
+datetime (ISO strings or Unix seconds), lat, lon, solar, pres, temp_air,
+temp_dew, speed and, optionally, input_units. Throughput and latency
+counters are available with a GET of /metrics.
+
+"""
+
+import argparse
+import http.client
+import json
+import os
+import queue
+import socket
+import socketserver
+import stat
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+import numpy
+import pandas
+from metpy.units import units
+
+from .constants import METHODS, OUTPUT_UNITS
+
+HOST      = '127.0.0.1'
+PORT      = 8765
+MAX_WAIT  = 0.005
+MAX_BATCH = 2**16
+
+# Units assumed for inputs if not specified in the request
+INPUT_UNITS = {
+    'solar'    : 'watt/meter**2',
+    'pres'     : 'hPa',
+    'temp_air' : 'degree_Celsius',
+    'temp_dew' : 'degree_Celsius',
+    'speed'    : 'meter/second',
+}
+
+class Metrics:
+    """
+    Thread-safe throughput and latency counters
+
+    """
+
+    def __init__(self):
+        self._lock  = threading.Lock()
+        self.start  = time.time()
+        self.counts = {
+            'requests'       : 0,
+            'points'         : 0,
+            'batches'        : 0,
+            'errors'         : 0,
+            'latency_sum'    : 0.0,
+            'latency_max'    : 0.0,
+            'kernel_seconds' : 0.0,
+        }
+
+    def batch(self, nrequests, npoints, seconds):
+        """Record a batch sent to the kernel"""
+
+        with self._lock:
+            self.counts['batches']        += 1
+            self.counts['requests']       += nrequests
+            self.counts['points']         += npoints
+            self.counts['kernel_seconds'] += seconds
+
+    def latency(self, seconds, error=False):
+        """
+        Record the latency of a completed request
+
+        Failed requests are only counted as errors, so that the latency
+        statistics are those of the requests that were answered.
+
+        """
+
+        with self._lock:
+            if error:
+                self.counts['errors'] += 1
+                return
+            self.counts['latency_sum'] += seconds
+            self.counts['latency_max']  = max(self.counts['latency_max'], seconds)
+
+    def snapshot(self):
+        """
+        Current value of counters
+
+        Returns:
+            dict : Raw counters plus uptime, rates, and means
+
+        """
+
+        with self._lock:
+            out = dict(self.counts)
+        uptime = time.time() - self.start
+        nreq   = max(out['requests'], 1)
+        out.update({
+            'uptime_seconds'      : uptime,
+            'requests_per_second' : out['requests'] / uptime,
+            'points_per_second'   : out['points'] / uptime,
+            'latency_mean'        : out['latency_sum'] / nreq,
+            'requests_per_batch'  : out['requests'] / max(out['batches'], 1),
+        })
+        return out
+
+class _Request:
+    """A parsed request waiting to be batched"""
+
+    __slots__ = ('key', 'args', 'size', 'received', 'event', 'result', 'error')
+
+    def __init__(self, key, args, size):
+        self.key      = key
+        self.args     = args
+        self.size     = size
+        self.received = time.perf_counter()
+        self.event    = threading.Event()
+        self.result   = None
+        self.error    = None
+
+def parse_request(data):
+    """
+    Convert JSON request to a batchable request
+
+    Arguments:
+        data (dict) : Decoded JSON request
+
+    Returns:
+        _Request
+
+    """
+
+    method = data.get('method', 'liljegren').lower()
+    if method not in METHODS:
+        raise Exception(f"Method '{method}' not supported!")
+
+    dates = data['datetime']
+    if not isinstance(dates, list):
+        dates = [dates]
+    numeric = len(dates) > 0 and isinstance(dates[0], (int, float))
+    dates   = (
+        pandas.to_datetime(dates, unit='s') if numeric else
+        pandas.to_datetime(dates, format='ISO8601')
+    )
+    if dates.tz is not None:
+        dates = dates.tz_convert('UTC').tz_localize(None)
+    size = dates.size
+
+    args = {'datetime' : dates.values}
+    for key in ('lat', 'lon', *INPUT_UNITS):
+        val = numpy.asarray(data[key], dtype=numpy.float64)
+        if val.size not in (1, size):
+            raise Exception(f"Size mismatch between '{key}' and datetime!")
+        args[key] = numpy.resize(val, size)
+
+    in_units = {**INPUT_UNITS, **data.get('input_units', {})}
+    for var, unit in INPUT_UNITS.items():
+        try:
+            units.Quantity(1.0, in_units[var]).to(unit)
+        except Exception as err:
+            raise Exception(f"Invalid units for '{var}': {err}") from err
+    key      = (method, tuple(in_units[var] for var in INPUT_UNITS))
+    return _Request(key, args, size)
+
+class Batcher:
+    """
+    Collect requests into batches and run the WBGT kernels
+
+    The first request of a batch starts the latency window; any requests
+    arriving before the window closes (or until max_batch points are
+    collected) are computed with it. Requests in a batch with the same
+    method and input units share one call to wbgt(); if that call fails,
+    the requests are retried one at a time.
+
+    Keyword arguments:
+        max_wait (float) : Length of latency window (seconds)
+        max_batch (int) : Maximum number of points per batch
+        metrics (Metrics) : Counters to update
+
+    """
+
+    def __init__(self, max_wait=MAX_WAIT, max_batch=MAX_BATCH, metrics=None):
+        self.max_wait  = max_wait
+        self.max_batch = max_batch
+        self.metrics   = metrics or Metrics()
+        self._queue    = queue.Queue()
+        self._thread   = threading.Thread(target=self._run, daemon=True)
+
+    def start(self):
+        self._thread.start()
+
+    def stop(self):
+        self._queue.put(None)
+        self._thread.join()
+
+    def submit(self, request, timeout=None):
+        """
+        Queue request and wait for result
+
+        Returns:
+            dict : Output variables as lists, keyed by name
+
+        """
+
+        self._queue.put(request)
+        if not request.event.wait(timeout):
+            raise Exception('Timed out waiting for result!')
+        self.metrics.latency(
+            time.perf_counter() - request.received,
+            request.error is not None,
+        )
+        if request.error is not None:
+            raise request.error
+        return request.result
+
+    def _run(self):
+
+        while True:
+            first = self._queue.get()
+            if first is None:
+                return
+
+            batch    = [first]
+            npoints  = first.size
+            deadline = first.received + self.max_wait
+            stop     = False
+            while npoints < self.max_batch:
+                timeout = deadline - time.perf_counter()
+                if timeout <= 0:
+                    break
+                try:
+                    req = self._queue.get(timeout=timeout)
+                except queue.Empty:
+                    break
+                if req is None:
+                    stop = True
+                    break
+                batch.append(req)
+                npoints += req.size
+
+            groups = {}
+            for req in batch:
+                groups.setdefault(req.key, []).append(req)
+            for key, reqs in groups.items():
+                self._compute(key, reqs)
+
+            if stop:
+                return
+
+    def _compute(self, key, reqs):
+        """
+        Run one vectorized call for requests with the same key
+
+        If the call fails, each request is run on its own so that one bad
+        request only fails itself, not the others in its batch.
+
+        """
+
+        try:
+            results = self._wbgt(key, reqs)
+        except Exception as err:
+            if len(reqs) > 1:
+                for req in reqs:
+                    self._compute(key, [req])
+                return
+            reqs[0].error = err
+        else:
+            for req, result in zip(reqs, results):
+                req.result = result
+
+        for req in reqs:
+            req.event.set()
+
+    def _wbgt(self, key, reqs):
+        """Call wbgt() on concatenated requests; returns result of each"""
+
+        from . import wbgt
+
+        method, in_units = key
+        args = {
+            name : numpy.concatenate([req.args[name] for req in reqs])
+            for name in reqs[0].args
+        }
+        start = time.perf_counter()
+        res   = wbgt(
+            method,
+            pandas.DatetimeIndex(args['datetime']),
+            args['lat'],
+            args['lon'],
+            *(
+                units.Quantity(args[var], unit)
+                for var, unit in zip(INPUT_UNITS, in_units)
+            ),
+        )
+        self.metrics.batch(
+            len(reqs), args['lat'].size, time.perf_counter()-start,
+        )
+
+        bounds = numpy.cumsum([req.size for req in reqs])[:-1]
+        split  = {
+            var : numpy.split(
+                numpy.asarray(res[var].to(unit).magnitude, dtype=numpy.float64),
+                bounds,
+            )
+            for var, unit in OUTPUT_UNITS.items()
+        }
+        return [
+            {
+                var : [None if val != val else val for val in vals[i].tolist()]
+                for var, vals in split.items()
+            }
+            for i in range(len(reqs))
+        ]
+
+class _Handler(BaseHTTPRequestHandler):
+
+    protocol_version = 'HTTP/1.1'
+
+    def log_message(self, *args):
+        pass
+
+    def _send(self, code, body):
+
+        data = json.dumps(body).encode()
+        self.send_response(code)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def do_GET(self):
+
+        if self.path.rstrip('/') == '/metrics':
+            self._send(200, self.server.service.metrics.snapshot())
+        elif self.path.rstrip('/') == '/health':
+            self._send(200, {'status' : 'ok'})
+        else:
+            self._send(404, {'error' : f'Unknown path: {self.path}'})
+
+    def do_POST(self):
+
+        if self.path.rstrip('/') != '/wbgt':
+            self._send(404, {'error' : f'Unknown path: {self.path}'})
+            return
+
+        service = self.server.service
+        try:
+            length = int(self.headers.get('Content-Length', 0))
+            req    = parse_request(json.loads(self.rfile.read(length)))
+        except Exception as err:
+            service.metrics.latency(0.0, error=True)
+            self._send(400, {'error' : str(err)})
+            return
+
+        try:
+            self._send(200, service.batcher.submit(req))
+        except Exception as err:
+            self._send(500, {'error' : str(err)})
+
+class _UnixHTTPServer(socketserver.ThreadingMixIn, socketserver.UnixStreamServer):
+
+    daemon_threads = True
+
+def _remove_stale_socket(path):
+    """
+    Remove a Unix domain socket left behind by a service that has exited
+
+    Nothing is done if path does not exist. An exception is raised if
+    path is not a socket, or if something is still listening on it.
+
+    """
+
+    try:
+        mode = os.lstat(path).st_mode
+    except FileNotFoundError:
+        return
+    if not stat.S_ISSOCK(mode):
+        raise Exception( f'Not a socket, refusing to replace it : {path}!' )
+
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    try:
+        sock.connect(path)
+    except ConnectionRefusedError:
+        os.remove(path)
+        return
+    finally:
+        sock.close()
+    raise Exception( f'Socket is in use by another service : {path}!' )
+
+class WBGTService:
+    """
+    WBGT compute service
+
+    Keyword arguments:
+        host (str) : Address to listen on; localhost by default
+        port (int) : Port to listen on. Use zero (0) for any free port
+        socket_path (str) : Listen on this Unix domain socket instead of
+            a TCP port. A socket left behind by an exited service is
+            replaced; any other file at the path is an error
+        max_wait (float) : Micro-batching latency window (seconds)
+        max_batch (int) : Maximum number of points per kernel call
+        warmup (bool) : Compile/load all kernels before serving
+
+    """
+
+    def __init__(
+            self,
+            host        = HOST,
+            port        = PORT,
+            socket_path = None,
+            max_wait    = MAX_WAIT,
+            max_batch   = MAX_BATCH,
+            warmup      = True,
+        ):
+
+        self.metrics = Metrics()
+        self.batcher = Batcher(max_wait, max_batch, self.metrics)
+        if warmup:
+            self.warmup()
+
+        if socket_path is not None:
+            _remove_stale_socket(socket_path)
+            self.server = _UnixHTTPServer(socket_path, _Handler)
+        else:
+            self.server = ThreadingHTTPServer((host, port), _Handler)
+            self.server.daemon_threads = True
+        self.server.service = self
+        self.socket_path    = socket_path
+        self._thread        = None
+
+    @property
+    def address(self):
+        """Address the service is listening on"""
+
+        return self.server.server_address
+
+    def warmup(self):
+        """
+        Run each algorithm once so kernels are compiled before serving
+
+        This also starts the numba and OpenMP thread pools from the main
+        thread; some threading layers (e.g., TBB) hang at exit if first
+        started from the batching thread.
+
+        """
+
+        from . import wbgt
+
+        dates = pandas.DatetimeIndex(['2000-06-01 18:00', '2000-06-02 06:00'])
+        args  = (
+            numpy.array([35.0, 35.0]),
+            numpy.array([-80.0, -80.0]),
+            *(
+                units.Quantity(numpy.array(vals), unit)
+                for vals, unit in zip(
+                    ([800.0, 0.0], [1000.0]*2, [30.0]*2, [20.0]*2, [3.0]*2),
+                    INPUT_UNITS.values(),
+                )
+            ),
+        )
+        for method in METHODS:
+            wbgt(method, dates, *args)
+
+    def start(self):
+        """Start serving in a background thread"""
+
+        self.batcher.start()
+        self._thread = threading.Thread(target=self.server.serve_forever, daemon=True)
+        self._thread.start()
+        return self
+
+    def serve_forever(self):
+        """Serve until interrupted"""
+
+        self.batcher.start()
+        try:
+            self.server.serve_forever()
+        finally:
+            self._close()
+
+    def shutdown(self):
+        """Stop a service started with start()"""
+
+        self.server.shutdown()
+        if self._thread is not None:
+            self._thread.join()
+        self._close()
+
+    def _close(self):
+
+        self.server.server_close()
+        self.batcher.stop()
+        if self.socket_path is not None and os.path.exists(self.socket_path):
+            os.remove(self.socket_path)
+
+class _UnixHTTPConnection(http.client.HTTPConnection):
+
+    def __init__(self, path, timeout=None):
+        super().__init__('localhost', timeout=timeout)
+        self._path = path
+
+    def connect(self):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.settimeout(self.timeout)
+        self.sock.connect(self._path)
+
+def request(data=None, host=HOST, port=PORT, socket_path=None, path=None, timeout=None):
+    """
+    Send request to a running service
+
+    Keyword arguments:
+        data (dict) : Request to POST to /wbgt. If None, the metrics are
+            requested instead
+        host (str) : Host of the service
+        port (int) : Port of the service
+        socket_path (str) : Unix domain socket of the service; overrides
+            host and port
+        path (str) : Request path; default depends on data
+        timeout (float) : Socket timeout (seconds)
+
+    Returns:
+        dict : Decoded JSON response
+
+    """
+
+    if socket_path is not None:
+        conn = _UnixHTTPConnection(socket_path, timeout=timeout)
+    else:
+        conn = http.client.HTTPConnection(host, port, timeout=timeout)
+
+    try:
+        if data is None:
+            conn.request('GET', path or '/metrics')
+        else:
+            conn.request(
+                'POST',
+                path or '/wbgt',
+                body    = json.dumps(data),
+                headers = {'Content-Type' : 'application/json'},
+            )
+        resp = conn.getresponse()
+        body = json.loads(resp.read())
+    finally:
+        conn.close()
+
+    if resp.status != 200:
+        raise Exception(f"Service error ({resp.status}): {body.get('error')}")
+    return body
+
+def main():
+    """Command line entry point"""
+
+    parser = argparse.ArgumentParser(description='Local WBGT compute service')
+    parser.add_argument('--host', default=HOST, help='Address to listen on')
+    parser.add_argument('--port', type=int, default=PORT, help='Port to listen on')
+    parser.add_argument('--socket', help='Listen on Unix domain socket instead of port')
+    parser.add_argument(
+        '--max-wait', type=float, default=MAX_WAIT*1.0e3,
+        help='Micro-batching latency window (milliseconds)',
+    )
+    parser.add_argument(
+        '--max-batch', type=int, default=MAX_BATCH,
+        help='Maximum number of points per kernel call',
+    )
+    args = parser.parse_args()
+
+    service = WBGTService(
+        host        = args.host,
+        port        = args.port,
+        socket_path = args.socket,
+        max_wait    = args.max_wait/1.0e3,
+        max_batch   = args.max_batch,
+    )
+    try:
+        service.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+if __name__ == "__main__":
+    main()
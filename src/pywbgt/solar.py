@@ -14,6 +14,7 @@ import numpy as np
 from numba import njit, prange
 from pvlib import spa
 
+from .profiling import stage
 from .utils import datetime_adjust
 from .liljegren import (
     LILJEGREN_CZA_MIN, LILJEGREN_NORMSOLAR_MAX, LILJEGREN_SOLAR_CONST,
@@ -24,6 +25,9 @@ ELEV     =    0.00
 PRESSURE = 1013.25
 TEMP     =   15.00
 
+# Keywords used for solar geometry only; see solar_parameters()
+SOLAR_KWARGS = ('gmt', 'avg', 'elev', 'pressure', 'temp')
+
 def solar_parameters(
     datetime, lat, lon, solar,
     gmt      = None,
@@ -74,11 +78,39 @@ def solar_parameters(
  
     """
 
-    datetime = (
-        datetime_adjust(datetime, gmt, avg)
-        .values        
-        .astype(np.int64)
-    )/1.0e9
+    datetime, lat, lon, elev, pressure, temp = _solar_inputs(
+        datetime, lat, lon, gmt, avg, elev, pressure, temp,
+    )
+
+    with stage('solar_geometry', size=datetime.size):
+        return _solar_parameters(
+            datetime,
+            lat,
+            lon,
+            solar,
+            elev,
+            pressure,
+            temp,
+            0,
+            0,
+        )
+
+def _solar_inputs(datetime, lat, lon, gmt, avg, elev, pressure, temp):
+    """
+    Adjust times and expand locations for solar geometry
+
+    Returns:
+        tuple : Unix time (seconds) and latitude, longitude, elevation,
+            pressure, and temperature of each point; see solar_parameters()
+
+    """
+
+    with stage('datetime_adjust', size=datetime.size):
+        datetime = (
+            datetime_adjust(datetime, gmt, avg)
+            .values        
+            .astype(np.int64)
+        )/1.0e9
 
     ntime = datetime.shape[0]
 
@@ -103,19 +135,157 @@ def solar_parameters(
     elif temp.size <= 1:
         temp = temp.repeat(ntime)
    
-    return _solar_parameters(
+    return datetime, lat, lon, elev, pressure, temp
+
+def sun_geometry(
+    datetime, lat, lon,
+    gmt      = None,
+    avg      = None,
+    elev     = None,
+    pressure = None,
+    temp     = None,
+     **kwargs
+):
+    """
+    Solar geometry that does not depend on solar irradiance
+
+    Used when several sets of irradiance share times and locations
+    (e.g., ensemble members); pass the result to adjust_solar_members().
+
+    Arguments:
+        See solar_parameters(); solar irradiance is not needed
+
+    Returns:
+        tuple : Cosine of solar zenith angle and Earth-Sun distance (AU)
+            of each point
+
+    """
+
+    datetime, lat, lon, elev, pressure, temp = _solar_inputs(
+        datetime, lat, lon, gmt, avg, elev, pressure, temp,
+    )
+    return _sun_geometry(datetime, lat, lon, elev, pressure, temp, 0, 0)
+
+@njit(parallel=True, nogil=True)
+def _sun_geometry(unixtime, lat, lon, elev, pressure, temp, delta_t, atmos_refract):
+
+    cza  = np.empty(unixtime.size, dtype=np.float32)
+    dist = np.empty(unixtime.size, dtype=np.float64)
+    for i in prange(unixtime.size):
+        cza[i], dist[i] = _sun_position(
+            unixtime[i], lat[i], lon[i], elev[i], pressure[i], temp[i],
+            delta_t, atmos_refract,
+        )
+
+    return cza, dist
+
+@njit(parallel=True, nogil=True)
+def adjust_solar_members(solar, cza, R):
+    """
+    Adjust solar irradiance of several members sharing solar geometry
+
+    Arguments:
+        solar (ndarray) : Solar irradiance (Watt/m**2) with shape
+            (nmember, npoint)
+        cza (ndarray) : Cosine of solar zenith angle of each point
+        R (ndarray) : Earth-Sun distance (AU) of each point
+
+    Returns:
+        tuple : Adjusted solar irradiance and fraction of direct beam,
+            each with shape (nmember, npoint)
+
+    """
+
+    nmember, npoint = solar.shape
+    solar_adj = np.empty((nmember, npoint), dtype=np.float32)
+    fdir      = np.empty((nmember, npoint), dtype=np.float32)
+    for k in prange(nmember * npoint):
+        m = k // npoint
+        i = k - m * npoint
+        solar_adj[m, i], fdir[m, i] = _adjust_solar(solar[m, i], cza[i], R[i])
+
+    return solar_adj, fdir
+
+def solar_parameters_ragged(
+    datetime, offsets, lat, lon, solar,
+    gmt      = None,
+    avg      = None,
+    elev     = None,
+    pressure = None,
+    temp     = None,
+     **kwargs
+):
+    """
+    Calculate solar parameters for a ragged set of stations
+
+    Same as solar_parameters(), but the location parameters are given
+    once per station rather than per observation. The observations for
+    station j are in elements offsets[j] to offsets[j+1] of datetime
+    and solar.
+
+    Arguments:
+        datetime (pandas.DatetimeIndex) : Datetime(s) corresponding to data
+        offsets (ndarray) : Index of first observation of each station with
+            the total number of observations as the last element
+        lat (ndarray) : Latitude of each station; decimal
+        lon (ndarray) : Longitude of each station; decimal
+        solar (ndarray) : Solar irradiance values (Watt/m**2)
+
+    Keyword arguments:
+        gmt (ndarray) : LST-GMT difference  (hours; negative in USA); per
+            observation or per station
+        avg (ndarray) : averaging time of the meteorological inputs
+            (minutes); per observation or per station
+        elev (ndarray) : Elevation of each station (meters).
+            Default is 0 m, or sea level.
+        pressure (ndarray) : Average yearly pressure at each station (hPa).
+            Default is 1013.25 hPa
+        temp (ndarray) : Average yearly temperature at each station (degC)
+            Default is 15.0 C
+
+    Returns:
+        tuple : Three (3) ndarrays containing:
+            - Potentially modified solar radiation values
+            - cosine of zenith angle
+            - fraction of solar irradiance due to the direct beam
+
+    """
+
+    offsets  = np.asarray(offsets, dtype=np.int64)
+    counts   = np.diff(offsets)
+    nstation = counts.size
+
+    # Time offsets given per station are expanded to observations
+    if gmt is not None and np.size(gmt) == nstation and nstation > 1:
+        gmt = np.repeat(gmt, counts)
+    if avg is not None and np.size(avg) == nstation and nstation > 1:
+        avg = np.repeat(avg, counts)
+
+    datetime = (
+        datetime_adjust(datetime, gmt, avg)
+        .values
+        .astype(np.int64)
+    )/1.0e9
+
+    def station_param(val, default):
+        if val is None:
+            return np.full(nstation, default)
+        return np.resize(np.asarray(val, dtype=np.float64), nstation)
+
+    return _solar_parameters_ragged(
         datetime,
-        lat,
-        lon,
+        offsets,
+        np.resize(np.asarray(lat, dtype=np.float64), nstation),
+        np.resize(np.asarray(lon, dtype=np.float64), nstation),
         solar,
-        elev,
-        pressure,
-        temp,
+        station_param(elev,     ELEV),
+        station_param(pressure, PRESSURE),
+        station_param(temp,     TEMP),
         0,
         0,
     )
 
-@njit(parallel=True)
+@njit(parallel=True, nogil=True)
 def _solar_parameters(
     unixtime,
     lat,
@@ -147,79 +317,352 @@ def _solar_parameters(
 
     """
 
-    cza   = np.empty(unixtime.size, dtype=np.float32)
-    fdir  = np.empty(unixtime.size, dtype=np.float32)
+    # Adjusted irradiance is written to a new array; solar may be a
+    # read-only or caller-owned buffer (e.g., Arrow or xarray data)
+    solar_adj = np.empty(unixtime.size, dtype=np.float64)
+    cza       = np.empty(unixtime.size, dtype=np.float32)
+    fdir      = np.empty(unixtime.size, dtype=np.float32)
 
     for i in prange(unixtime.size):
-        jd    = spa.julian_day(unixtime[i])
-        jde   = spa.julian_ephemeris_day(jd, delta_t)
-        jc    = spa.julian_century(jd)
-        jce   = spa.julian_ephemeris_century(jde)
-        jme   = spa.julian_ephemeris_millennium(jce)
-        R     = spa.heliocentric_radius_vector(jme)
-
-        L     = spa.heliocentric_longitude(jme)
-        B     = spa.heliocentric_latitude(jme)
-        Theta = spa.geocentric_longitude(L)
-        beta  = spa.geocentric_latitude(B)
-        x0    = spa.mean_elongation(jce)
-        x1    = spa.mean_anomaly_sun(jce)
-        x2    = spa.mean_anomaly_moon(jce)
-        x3    = spa.moon_argument_latitude(jce)
-        x4    = spa.moon_ascending_longitude(jce)
-        
-        l_o_nutation = np.empty((2,))
-        spa.longitude_obliquity_nutation(jce, x0, x1, x2, x3, x4, l_o_nutation)
-
-        delta_psi     = l_o_nutation[0]
-        delta_epsilon = l_o_nutation[1]
-        epsilon0      = spa.mean_ecliptic_obliquity(jme)
-        epsilon       = spa.true_ecliptic_obliquity(epsilon0, delta_epsilon)
-        delta_tau     = spa.aberration_correction(R)
-        lamd          = spa.apparent_sun_longitude(Theta, delta_psi, delta_tau)
-        v0            = spa.mean_sidereal_time(jd, jc)
-        v             = spa.apparent_sidereal_time(v0, delta_psi, epsilon)
-        alpha         = spa.geocentric_sun_right_ascension(lamd, epsilon, beta)
-        delta         = spa.geocentric_sun_declination(lamd, epsilon, beta)
-
-        H           = spa.local_hour_angle(v, lon[i], alpha)
-        xi          = spa.equatorial_horizontal_parallax(R)
-        u           = spa.uterm(lat[i])
-        x           = spa.xterm(u, lat[i], elev[i])
-        y           = spa.yterm(u, lat[i], elev[i])
-        delta_alpha = spa.parallax_sun_right_ascension(x, xi, H, delta)
-        delta_prime = spa.topocentric_sun_declination(
-            delta, x, y, xi, delta_alpha, H,
-        )
-        H_prime     = spa.topocentric_local_hour_angle(H, delta_alpha)
-        e0          = spa.topocentric_elevation_angle_without_atmosphere(
-            lat[i], delta_prime, H_prime,
-        )
-        delta_e     = spa.atmospheric_refraction_correction(
-            pressure[i], temp[i], e0, atmos_refract,
+        cza[i], dist = _sun_position(
+            unixtime[i], lat[i], lon[i], elev[i], pressure[i], temp[i],
+            delta_t, atmos_refract,
         )
+        solar_adj[i], fdir[i] = _adjust_solar(solar[i], cza[i], dist)
 
-        cza[i] = np.cos(
-            np.deg2rad(90.0-spa.topocentric_elevation_angle(e0, delta_e))
-        )
+    return solar_adj, cza, fdir
+
+@njit(parallel=True, nogil=True)
+def _solar_parameters_ragged(
+    unixtime,
+    offsets,
+    lat,
+    lon,
+    solar,
+    elev,
+    pressure,
+    temp,
+    delta_t,
+    atmos_refract,
+):
+    """
+    Ragged version of _solar_parameters()
+
+    Location parameters (lat, lon, elev, pressure, temp) are given once
+    per station, and the observations for station j are in elements
+    offsets[j] to offsets[j+1] of the other arrays. Stations are
+    processed in parallel.
+
+    Arguments:
+        See arguments for _solar_parameters() and solar_parameters_ragged()
+
+    Returns:
+        tuple : Adjusted solar irradiance, cosine of solar zenith angle, and
+            fraction of direct beam radiation
+
+    """
+
+    # Adjusted irradiance is written to a new array; solar may be a
+    # read-only or caller-owned buffer (e.g., Arrow or xarray data)
+    solar_adj = np.empty(unixtime.size, dtype=np.float64)
+    cza       = np.empty(unixtime.size, dtype=np.float32)
+    fdir      = np.empty(unixtime.size, dtype=np.float32)
+
+    for j in prange(offsets.size-1):
+        for i in range(offsets[j], offsets[j+1]):
+            cza[i], dist = _sun_position(
+                unixtime[i], lat[j], lon[j], elev[j], pressure[j], temp[j],
+                delta_t, atmos_refract,
+            )
+            solar_adj[i], fdir[i] = _adjust_solar(solar[i], cza[i], dist)
+
+    return solar_adj, cza, fdir
+
+@njit(parallel=True, nogil=True)
+def sun_geocentric(unixtime, delta_t=0.0):
+    """
+    Location independent part of the sun position for many times
+
+    Arguments:
+        unixtime (ndarray) : Seconds since the Unix epoch
 
-        if (cza[i] < LILJEGREN_CZA_MIN):
-            solar[i] = 0.0
-            fdir[i]  = 0.0
-        else:
-            toasolar = LILJEGREN_SOLAR_CONST * max(cza[i], 0.0) / R**2
-    
-            # Limit maximum value of norm solar 
-            normsolar  = min(
-                solar[i]/toasolar,
-                LILJEGREN_NORMSOLAR_MAX,
+    Keyword arguments:
+        delta_t (float) : Difference between terrestrial and universal time
+
+    Returns:
+        ndarray : Array with shape (5, unixtime.size) of the outputs of
+            _sun_geocentric() for each time
+
+    """
+
+    geo = np.empty((5, unixtime.size), dtype=np.float64)
+    for i in prange(unixtime.size):
+        R, xi, v, alpha, delta = _sun_geocentric(unixtime[i], delta_t)
+        geo[0, i] = R
+        geo[1, i] = xi
+        geo[2, i] = v
+        geo[3, i] = alpha
+        geo[4, i] = delta
+
+    return geo
+
+@njit(parallel=True, nogil=True)
+def sun_geometry_grid(geo, lat, lon, elev, pressure, temp, atmos_refract=0.0):
+    """
+    Cosine of solar zenith angle for all combinations of time and location
+
+    The time independent terms of each location are computed only once.
+
+    Arguments:
+        geo (ndarray) : Output of sun_geocentric() for ntime times
+        lat (ndarray) : Latitude of each of npoint locations (decimal)
+        lon (ndarray) : Longitude of each location (decimal)
+        elev (ndarray) : Elevation of each location (meters)
+        pressure (ndarray) : Average yearly pressure at each location (hPa)
+        temp (ndarray) : Average yearly temperature at each location (degC)
+
+    Keyword arguments:
+        atmos_refract (float) : Atmospheric refraction at sunrise/sunset
+
+    Returns:
+        ndarray : Cosine of solar zenith angle with shape (ntime, npoint)
+
+    """
+
+    cza = np.empty((geo.shape[1], lat.size), dtype=np.float32)
+    for j in prange(lat.size):
+        x, y = _station_terms(lat[j], elev[j])
+        for i in range(geo.shape[1]):
+            cza[i, j] = _sun_topocentric(
+                geo[1, i], geo[2, i], geo[3, i], geo[4, i],
+                lat[j], lon[j], x, y, pressure[j], temp[j], atmos_refract,
             )
 
-            solar[i] = normsolar * toasolar
-            if normsolar > 0.0:
-                fdir[i] = np.exp(3.0-1.34*normsolar-1.65/normsolar)
-                fdir[i] = max(min(fdir[i], 0.9), 0.0)
-            else:
-                fdir[i] = 0.0
+    return cza
+
+@njit(parallel=True, nogil=True)
+def adjust_solar(solar, cza, R):
+    """
+    Adjust solar irradiance and compute fraction of direct beam
+
+    Vectorized version of _adjust_solar()
+
+    Arguments:
+        solar (ndarray) : Solar irradiance values (Watt/m**2)
+        cza (ndarray) : Cosine of solar zenith angle
+        R (ndarray) : Earth-Sun distance (AU)
+
+    Returns:
+        tuple : Adjusted solar irradiance and fraction of direct beam
+
+    """
+
+    solar_adj = np.empty(solar.size, dtype=np.float32)
+    fdir      = np.empty(solar.size, dtype=np.float32)
+    for i in prange(solar.size):
+        solar_adj[i], fdir[i] = _adjust_solar(solar[i], cza[i], R[i])
+
+    return solar_adj, fdir
+
+def normsolar_clipped(solar, solar_adj, cza):
+    """
+    Count the points where solar irradiance was clipped by the adjustment
+
+    While the sun is up, the adjusted irradiance is only less than the
+    input where normsolar was clipped to LILJEGREN_NORMSOLAR_MAX; clipping
+    by less than one part in a million is not counted, so that rounding
+    is not mistaken for it. Used by pywbgt.metrics.
+
+    Arguments:
+        solar (ndarray) : Solar irradiance before adjustment (Watt/m**2)
+        solar_adj (ndarray) : Solar irradiance after adjustment (Watt/m**2)
+        cza (ndarray) : Cosine of solar zenith angle
+
+    Returns:
+        int : Number of clipped points
+
+    """
+
+    solar = np.asarray(solar, dtype=np.float64)
+    return int(np.count_nonzero(
+        (np.asarray(cza) >= LILJEGREN_CZA_MIN) &
+        (np.asarray(solar_adj) < solar * (1.0 - 1.0e-6))
+    ))
+
+@njit
+def _sun_position(
+    unixtime,
+    lat,
+    lon,
+    elev,
+    pressure,
+    temp,
+    delta_t,
+    atmos_refract,
+):
+    """
+    Cosine of solar zenith angle and Earth-Sun distance at a single point
+
+    Arguments:
+        See arguments for solar_position()
+
+    Returns:
+        tuple : Cosine of solar zenith angle and Earth-Sun distance (AU)
+
+    """
+
+    R, xi, v, alpha, delta = _sun_geocentric(unixtime, delta_t)
+    x, y = _station_terms(lat, elev)
+    cza  = _sun_topocentric(
+        xi, v, alpha, delta, lat, lon, x, y, pressure, temp, atmos_refract,
+    )
+
+    return cza, R
+
+@njit
+def _sun_geocentric(unixtime, delta_t):
+    """
+    Location independent part of the sun position
+
+    Arguments:
+        unixtime (float) : Seconds since the Unix epoch
+        delta_t (float) : Difference between terrestrial and universal time
+
+    Returns:
+        tuple : Earth-Sun distance (AU), equatorial horizontal parallax,
+            apparent sidereal time, geocentric sun right ascension, and
+            geocentric sun declination; the latter four in degrees
+
+    """
+
+    jd    = spa.julian_day(unixtime)
+    jde   = spa.julian_ephemeris_day(jd, delta_t)
+    jc    = spa.julian_century(jd)
+    jce   = spa.julian_ephemeris_century(jde)
+    jme   = spa.julian_ephemeris_millennium(jce)
+    R     = spa.heliocentric_radius_vector(jme)
+
+    L     = spa.heliocentric_longitude(jme)
+    B     = spa.heliocentric_latitude(jme)
+    Theta = spa.geocentric_longitude(L)
+    beta  = spa.geocentric_latitude(B)
+    x0    = spa.mean_elongation(jce)
+    x1    = spa.mean_anomaly_sun(jce)
+    x2    = spa.mean_anomaly_moon(jce)
+    x3    = spa.moon_argument_latitude(jce)
+    x4    = spa.moon_ascending_longitude(jce)
+
+    l_o_nutation = np.empty((2,))
+    spa.longitude_obliquity_nutation(jce, x0, x1, x2, x3, x4, l_o_nutation)
+
+    delta_psi     = l_o_nutation[0]
+    delta_epsilon = l_o_nutation[1]
+    epsilon0      = spa.mean_ecliptic_obliquity(jme)
+    epsilon       = spa.true_ecliptic_obliquity(epsilon0, delta_epsilon)
+    delta_tau     = spa.aberration_correction(R)
+    lamd          = spa.apparent_sun_longitude(Theta, delta_psi, delta_tau)
+    v0            = spa.mean_sidereal_time(jd, jc)
+    v             = spa.apparent_sidereal_time(v0, delta_psi, epsilon)
+    alpha         = spa.geocentric_sun_right_ascension(lamd, epsilon, beta)
+    delta         = spa.geocentric_sun_declination(lamd, epsilon, beta)
+    xi            = spa.equatorial_horizontal_parallax(R)
+
+    return R, xi, v, alpha, delta
+
+@njit
+def _station_terms(lat, elev):
+    """
+    Time independent terms of the topocentric sun position
+
+    Arguments:
+        lat (float) : Latitude of location (decimal)
+        elev (float) : Elevation of location (meters)
+
+    Returns:
+        tuple : The x and y terms of the SPA parallax correction
+
+    """
+
+    u = spa.uterm(lat)
+    return spa.xterm(u, lat, elev), spa.yterm(u, lat, elev)
+
+@njit
+def _sun_topocentric(
+    xi,
+    v,
+    alpha,
+    delta,
+    lat,
+    lon,
+    x,
+    y,
+    pressure,
+    temp,
+    atmos_refract,
+):
+    """
+    Cosine of solar zenith angle at a location
+
+    Arguments:
+        xi, v, alpha, delta : Output from _sun_geocentric()
+        lat (float) : Latitude of location (decimal)
+        lon (float) : Longitude of location (decimal)
+        x, y : Output from _station_terms()
+        pressure (float) : Average yearly pressure at location (hPa)
+        temp (float) : Average yearly temperature at location (degC)
+        atmos_refract (float) : Atmospheric refraction at sunrise/sunset
+
+    Returns:
+        float : Cosine of solar zenith angle
+
+    """
+
+    H           = spa.local_hour_angle(v, lon, alpha)
+    delta_alpha = spa.parallax_sun_right_ascension(x, xi, H, delta)
+    delta_prime = spa.topocentric_sun_declination(
+        delta, x, y, xi, delta_alpha, H,
+    )
+    H_prime     = spa.topocentric_local_hour_angle(H, delta_alpha)
+    e0          = spa.topocentric_elevation_angle_without_atmosphere(
+        lat, delta_prime, H_prime,
+    )
+    delta_e     = spa.atmospheric_refraction_correction(
+        pressure, temp, e0, atmos_refract,
+    )
+
+    return np.cos(
+        np.deg2rad(90.0-spa.topocentric_elevation_angle(e0, delta_e))
+    )
+
+@njit
+def _adjust_solar(solar, cza, R):
+    """
+    Adjust solar irradiance and compute fraction of direct beam
+
+    Arguments:
+        solar (float) : Solar irradiance (Watt/m**2)
+        cza (float) : Cosine of solar zenith angle
+        R (float) : Earth-Sun distance (AU)
+
+    Returns:
+        tuple : Adjusted solar irradiance and fraction of direct beam
+
+    """
+
+    if (cza < LILJEGREN_CZA_MIN):
+        return 0.0, 0.0
+
+    toasolar = LILJEGREN_SOLAR_CONST * max(cza, 0.0) / R**2
+
+    # Limit maximum value of norm solar 
+    normsolar  = min(
+        solar/toasolar,
+        LILJEGREN_NORMSOLAR_MAX,
+    )
+
+    solar = normsolar * toasolar
+    if normsolar > 0.0:
+        fdir = np.exp(3.0-1.34*normsolar-1.65/normsolar)
+        return solar, max(min(fdir, 0.9), 0.0)
 
-    return solar, cza, fdir
+    return solar, 0.0
@@ -0,0 +1,71 @@
+/*
+ * Globe temperature solver of the Bernard method
+ *
+ * The solver of bernard.pyx in plain C so that it can be compiled for
+ * several ISA levels; see bernard_isa.c. The arithmetic, including the
+ * float and double types of each operation, is that of the Cython code
+ * it replaces, so the baseline level gives identical results.
+ */
+
+#include	<math.h>
+#include	<stddef.h>
+
+#define	BERNARD_MAX_ITER	50
+#define	BERNARD_CTOK		((float)273.15)
+#define	BERNARD_CONVERGE	((float)1.0E-3)
+#define	BERNARD_ALPHA_SFC	((float)0.00)
+#define	BERNARD_EPSILON	((float)0.98)		/* Emissivity of black globe */
+#define	BERNARD_SIGMAB		((float)5.670374419e-8)	/* pywbgt.constants.SIGMA */
+
+/*
+ * Convective heat transfer coefficient; temperatures in Kelvin, speed
+ * in meter/second
+ */
+static double conv_heat_trans_coeff(double temp_g, double temp_air, double speed)
+{
+	double coeff, delta_t = temp_g - temp_air;
+
+	coeff = pow(
+		pow(10.9*pow(speed, 0.566), 3.0) +
+		pow(0.35 + 1.77*pow(fabs(delta_t), 0.25), 3.0),
+		1.0/3.0
+	);
+	if (delta_t < 0.0) return -coeff;
+	return coeff;
+}
+
+/*
+ * Globe temperature (Kelvin) through iterative solver; air temperature
+ * in Celsius. The number of iterations is written to niter unless it is
+ * NULL. Returns NaN if the solver does not converge.
+ */
+static double globe_temperature(double temp_air, double esat, double speed, double pres,
+	float solar, float f_db, float cosz, int *niter)
+{
+	int ii;
+	double h, temp_g_new, temp_g;
+
+	(void)esat;
+	(void)pres;
+
+	temp_air = temp_air + BERNARD_CTOK;
+	temp_g   = temp_air;
+	for (ii = 0; ii < BERNARD_MAX_ITER; ii++) {
+		h = conv_heat_trans_coeff(temp_g, temp_air, speed);
+		temp_g_new = pow(
+			pow(temp_air, 4.0) +
+			(double)(solar/BERNARD_SIGMAB)/2.0 * ((1.0 + f_db*(1.0/2.0/(double)cosz - 1.0)) + BERNARD_ALPHA_SFC) -
+			h/(double)BERNARD_EPSILON/(double)BERNARD_SIGMAB * (temp_g - temp_air),
+			0.25
+		);
+
+		if (fabs(temp_g_new - temp_g) < BERNARD_CONVERGE) {
+			if (niter != NULL) *niter = ii + 1;
+			return temp_g_new;
+		}
+		temp_g = 0.9*temp_g + 0.1*temp_g_new;
+	}
+
+	if (niter != NULL) *niter = BERNARD_MAX_ITER;
+	return NAN;
+}
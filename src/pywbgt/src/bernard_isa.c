@@ -0,0 +1,57 @@
+/*
+ * Multi-ISA build of the Bernard globe temperature solver; see isa.h
+ */
+
+#include "isa.h"
+#include "bernard_c.c"
+
+#ifdef PYWBGT_ISA_X86
+
+#define conv_heat_trans_coeff PYWBGT_ISA_NAME(conv_heat_trans_coeff)
+#define globe_temperature     PYWBGT_ISA_NAME(globe_temperature)
+
+#define PYWBGT_ISA_SOURCE "bernard_c.c"
+#include "isa_clones.h"
+#undef PYWBGT_ISA_SOURCE
+
+#undef conv_heat_trans_coeff
+#undef globe_temperature
+
+#endif /* PYWBGT_ISA_X86 */
+
+/* Solver of one ISA level */
+typedef struct {
+	int level;
+	double (*globe_temperature)(double, double, double, double, float, float, float, int *);
+} bernard_isa_t;
+
+static const bernard_isa_t bernard_isa_levels[PYWBGT_ISA_COUNT] = {
+	{PYWBGT_ISA_BASELINE, globe_temperature},
+#ifdef PYWBGT_ISA_X86
+	{PYWBGT_ISA_AVX2,   globe_temperature_avx2},
+	{PYWBGT_ISA_AVX512, globe_temperature_avx512},
+#else
+	{PYWBGT_ISA_AVX2,   globe_temperature},
+	{PYWBGT_ISA_AVX512, globe_temperature},
+#endif
+};
+
+/* Level in use; baseline until bernard_isa_select() is called */
+static const bernard_isa_t *bernard_isa = &bernard_isa_levels[PYWBGT_ISA_BASELINE];
+
+/* Solver used by the Cython kernels; see cbernard.pxd */
+#define bernard_globe_temperature (*PYWBGT_ISA_LOAD(bernard_isa)->globe_temperature)
+
+/* Level in use */
+static int bernard_isa_level(void)
+{
+	return PYWBGT_ISA_LOAD(bernard_isa)->level;
+}
+
+/* Use the solver of level; returns -1 if it is not supported */
+static int bernard_isa_select(int level)
+{
+	if (!pywbgt_isa_supported(level)) return -1;
+	PYWBGT_ISA_STORE(bernard_isa, &bernard_isa_levels[level]);
+	return 0;
+}
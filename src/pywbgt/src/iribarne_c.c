@@ -0,0 +1,52 @@
+/*
+ * Iribarne and Godson (1981) psychrometric wet bulb temperature
+ *
+ * The solver of psychrometric_wetbulb.pyx in plain C so that it can be
+ * compiled for several ISA levels; see iribarne_isa.c. The arithmetic is
+ * that of the Cython code it replaces, in single precision, so the
+ * baseline level gives identical results.
+ */
+
+#include	<math.h>
+
+#define	IRIBARNE_C0	((float)26.66082)
+#define	IRIBARNE_C1	((float)0.0091379024)
+#define	IRIBARNE_C2	((float)6106.396)
+#define	IRIBARNE_CP	((float)1004.0)	/* J/K/kg */
+#define	IRIBARNE_L	((float)2.54e6)		/* J/kg */
+#define	IRIBARNE_EPS	((float)0.622)
+#define	IRIBARNE_F	(IRIBARNE_CP/IRIBARNE_L/IRIBARNE_EPS)
+
+/* Saturation vapor pressure (hPa); temperature in Kelvin */
+static float saturation(float T)
+{
+	return (float)exp(IRIBARNE_C0 - IRIBARNE_C1*T - IRIBARNE_C2/T);
+}
+
+/*
+ * Iteratively compute the wet bulb temperature (Kelvin) from dry bulb
+ * and dew point temperature (Kelvin) and pressure (hPa). Stops when the
+ * adjustment is less than xtol; returns NaN if that does not happen
+ * within maxfev iterations.
+ */
+static float iribarne_wb(float temp_a, float temp_d, float pres, int maxfev, float xtol)
+{
+	float e_sat, e_atm, e_wb, e_adj, temp_w, denom, numer, adjust;
+
+	e_sat  = saturation(temp_a);
+	e_atm  = saturation(temp_d);
+	e_adj  = (e_sat - e_atm)/(temp_a - temp_d);
+	temp_w = (temp_a*IRIBARNE_F*pres + temp_d*e_adj)/(IRIBARNE_F*pres + e_adj);
+
+	while (maxfev > 0) {
+		e_wb    = saturation(temp_w);
+		numer   = IRIBARNE_F*pres*(temp_a - temp_w) - (e_wb - e_atm);
+		denom   = e_wb*(IRIBARNE_C1 - IRIBARNE_C2/powf(temp_w, 2.0f)) - IRIBARNE_F*pres;
+		adjust  = numer/denom;
+		temp_w -= adjust;
+		if (fabsf(adjust) < xtol) return temp_w;
+		maxfev -= 1;
+	}
+
+	return NAN;
+}
@@ -0,0 +1,57 @@
+/*
+ * Multi-ISA build of the Iribarne wet bulb solver; see isa.h
+ */
+
+#include "isa.h"
+#include "iribarne_c.c"
+
+#ifdef PYWBGT_ISA_X86
+
+#define saturation  PYWBGT_ISA_NAME(saturation)
+#define iribarne_wb PYWBGT_ISA_NAME(iribarne_wb)
+
+#define PYWBGT_ISA_SOURCE "iribarne_c.c"
+#include "isa_clones.h"
+#undef PYWBGT_ISA_SOURCE
+
+#undef saturation
+#undef iribarne_wb
+
+#endif /* PYWBGT_ISA_X86 */
+
+/* Solver of one ISA level */
+typedef struct {
+	int level;
+	float (*iribarne_wb)(float, float, float, int, float);
+} iribarne_isa_t;
+
+static const iribarne_isa_t iribarne_isa_levels[PYWBGT_ISA_COUNT] = {
+	{PYWBGT_ISA_BASELINE, iribarne_wb},
+#ifdef PYWBGT_ISA_X86
+	{PYWBGT_ISA_AVX2,   iribarne_wb_avx2},
+	{PYWBGT_ISA_AVX512, iribarne_wb_avx512},
+#else
+	{PYWBGT_ISA_AVX2,   iribarne_wb},
+	{PYWBGT_ISA_AVX512, iribarne_wb},
+#endif
+};
+
+/* Level in use; baseline until iribarne_isa_select() is called */
+static const iribarne_isa_t *iribarne_isa = &iribarne_isa_levels[PYWBGT_ISA_BASELINE];
+
+/* Solver used by the Cython kernels; see cpsychrometric_wetbulb.pxd */
+#define iribarne_wetbulb (*PYWBGT_ISA_LOAD(iribarne_isa)->iribarne_wb)
+
+/* Level in use */
+static int iribarne_isa_level(void)
+{
+	return PYWBGT_ISA_LOAD(iribarne_isa)->level;
+}
+
+/* Use the solver of level; returns -1 if it is not supported */
+static int iribarne_isa_select(int level)
+{
+	if (!pywbgt_isa_supported(level)) return -1;
+	PYWBGT_ISA_STORE(iribarne_isa, &iribarne_isa_levels[level]);
+	return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * Instruction set (ISA) levels of the multi-versioned kernels
+ *
+ * Each *_isa.c file compiles its C kernels once for the baseline of the
+ * target (SSE2 on x86-64) and, on x86-64 with GCC or Clang, again for
+ * AVX2+FMA and for AVX-512 by including isa_clones.h. The kernels are
+ * called through a table of function pointers per level; the table in
+ * use is published with an atomic pointer store, so a thread calling a
+ * kernel always sees one complete table, never a mix of two levels.
+ */
+
+#ifndef PYWBGT_ISA_H
+#define PYWBGT_ISA_H
+
+#define PYWBGT_ISA_BASELINE 0
+#define PYWBGT_ISA_AVX2     1
+#define PYWBGT_ISA_AVX512   2
+#define PYWBGT_ISA_COUNT    3
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PYWBGT_ISA_X86
+#endif
+
+#define PYWBGT_ISA_CAT_(a, b) a##b
+#define PYWBGT_ISA_CAT(a, b)  PYWBGT_ISA_CAT_(a, b)
+
+/* Name of a function in the copy being compiled by isa_clones.h */
+#define PYWBGT_ISA_NAME(name) PYWBGT_ISA_CAT(name, PYWBGT_ISA_SUFFIX)
+
+/* Load and publish the table in use */
+#if defined(__GNUC__) || defined(__clang__)
+#define PYWBGT_ISA_LOAD(ptr)       __atomic_load_n(&(ptr), __ATOMIC_ACQUIRE)
+#define PYWBGT_ISA_STORE(ptr, val) __atomic_store_n(&(ptr), (val), __ATOMIC_RELEASE)
+#else
+#define PYWBGT_ISA_LOAD(ptr)       (ptr)
+#define PYWBGT_ISA_STORE(ptr, val) ((ptr) = (val))
+#endif
+
+/* Non-zero if the level is compiled in and supported by the CPU and OS */
+static int pywbgt_isa_supported(int level)
+{
+	if (level < 0 || level >= PYWBGT_ISA_COUNT) return 0;
+	if (level == PYWBGT_ISA_BASELINE) return 1;
+#ifdef PYWBGT_ISA_X86
+	__builtin_cpu_init();
+	if (level == PYWBGT_ISA_AVX2)
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	if (level == PYWBGT_ISA_AVX512)
+		return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")
+			&& __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512bw")
+			&& __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+	return 0;
+}
+
+/* Highest supported level */
+static int pywbgt_isa_best(void)
+{
+	int level;
+
+	for (level = PYWBGT_ISA_COUNT - 1; level > PYWBGT_ISA_BASELINE; level--)
+		if (pywbgt_isa_supported(level)) return level;
+	return PYWBGT_ISA_BASELINE;
+}
+
+#endif /* PYWBGT_ISA_H */
@@ -0,0 +1,43 @@
+/*
+ * Compile PYWBGT_ISA_SOURCE again for each ISA level above the baseline
+ *
+ * The including file defines PYWBGT_ISA_SOURCE and renames each external
+ * function of it with PYWBGT_ISA_NAME(); the copies get the suffixes
+ * _avx2 and _avx512. Nothing is compiled unless PYWBGT_ISA_X86 is set.
+ */
+
+#ifdef PYWBGT_ISA_X86
+
+/* AVX2 + FMA */
+#define PYWBGT_ISA_SUFFIX _avx2
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+#include PYWBGT_ISA_SOURCE
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#undef PYWBGT_ISA_SUFFIX
+
+/* AVX-512 (Skylake-SP subset) */
+#define PYWBGT_ISA_SUFFIX _avx512
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f,avx512vl,avx512dq,avx512bw,avx2,fma"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512vl,avx512dq,avx512bw,avx2,fma")
+#endif
+#include PYWBGT_ISA_SOURCE
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#undef PYWBGT_ISA_SUFFIX
+
+#endif /* PYWBGT_ISA_X86 */
@@ -657,7 +657,13 @@ float	lat,		/* north latitude, decimal							*/
  *		 Argonne National Laboratory
  */
  
-float Twb(Tair, rh, Pair, speed, solar, fdir, cza, rad)
+/*  Modified: Twb_guess() takes the first guess of the iteration, so that
+ *  a nearby solution (e.g., from a coarser grid) can be used as a warm
+ *  start, and optionally returns the number of iterations. Twb() uses
+ *  the original first guess.
+ */
+
+float Twb_guess(Tair, rh, Pair, speed, solar, fdir, cza, rad, guess, niter)
 
 float Tair,		/* air (dry bulb) temperature, degC						*/
 	rh,
@@ -665,10 +671,13 @@ float Tair,		/* air (dry bulb) temperature, degC						*/
 	speed,	/* wind speed, m/s								*/
 	solar,	/* solar irradiance, W/m2							*/
 	fdir,		/* fraction of solar irradiance due to direct beam			*/
-	cza;		/* cosine of solar zenith angle						*/
+	cza,		/* cosine of solar zenith angle						*/
+	guess;	/* first guess, K; dew point temperature if not positive		*/
 	
 int	rad;		/* switch to enable/disable radiative heating; 
 			 * no radiative heating --> pyschrometric wet bulb temp		*/
+
+int	*niter;	/* number of iterations; ignored if NULL				*/
 		
 {
 	static float a = 0.56; /* from Bedingfield and Drew */
@@ -688,7 +697,7 @@ int	rad;		/* switch to enable/disable radiative heating;
 	sza       = acos(cza); /* solar zenith angle, radians */
 	eair      = rh * esat(Tair,0);
 	Tdew      = dew_point(eair,0);
-	Twb_prev  = Tdew; /* first guess is the dew point temperature */
+	Twb_prev  = guess > 0.0 ? guess : Tdew; /* default first guess is the dew point temperature */
 	converged = FALSE;
 	iter      = 0;
 	do {
@@ -711,12 +720,22 @@ int	rad;		/* switch to enable/disable radiative heating;
     //printf( "Tref : %f  Twb_new : %f  Twb_prev : %f  \n", Tref, Twb_new, Twb_prev);
 	} while (!converged && iter < MAX_ITER);
   //printf( "Converged : %d\n", converged );
+	if ( niter != NULL ) *niter = iter;
 	if ( converged ) 
 		return (Twb_new-273.15);
 	else
 		return (-9999.);
 }
 
+float Twb(Tair, rh, Pair, speed, solar, fdir, cza, rad)
+
+float Tair, rh, Pair, speed, solar, fdir, cza;
+int	rad;
+
+{
+	return Twb_guess(Tair, rh, Pair, speed, solar, fdir, cza, rad, 0.0, NULL);
+}
+
 /* ============================================================================
  * Purpose: to calculate the convective heat transfer coefficient in W/(m2 K)
  *          for a long cylinder in cross flow.
@@ -760,7 +779,11 @@ float	diameter,	/* cylinder diameter, m								*/
  *		 Argonne National Laboratory
  */
  
-float Tglobe(Tair, rh, Pair, speed, solar, fdir, cza, d_globe)
+/*  Modified: Tglobe_guess() takes the first guess of the iteration and
+ *  optionally returns the number of iterations; see Twb_guess().
+ */
+
+float Tglobe_guess(Tair, rh, Pair, speed, solar, fdir, cza, d_globe, guess, niter)
 
 float Tair,		/* air (dry bulb) temperature, Kelvin						*/
 	rh,		/* relative humidity, fraction between 0 and 1				*/
@@ -769,7 +792,10 @@ float Tair,		/* air (dry bulb) temperature, Kelvin						*/
 	solar,	/* solar irradiance, W/m2							*/
 	fdir,		/* fraction of solar irradiance due to direct beam			*/
 	cza,		/* cosine of solar zenith angle						*/
-  d_globe; /* diameter of black globe thermometer (meters) */
+  d_globe, /* diameter of black globe thermometer (meters) */
+	guess;	/* first guess, K; air temperature if not positive			*/
+
+int	*niter;	/* number of iterations; ignored if NULL				*/
 	
 {
 	float	Tsfc, Tref, Tglobe_prev, Tglobe_new, h,
@@ -782,7 +808,7 @@ float Tair,		/* air (dry bulb) temperature, Kelvin						*/
     };
 	
 	Tsfc = Tair;
-	Tglobe_prev = Tair; /* first guess is the air temperature */
+	Tglobe_prev = guess > 0.0 ? guess : Tair; /* default first guess is the air temperature */
 	converged = FALSE;
 	iter = 0;
 	do {
@@ -802,6 +828,7 @@ float Tair,		/* air (dry bulb) temperature, Kelvin						*/
 
 	} while (!converged && iter < MAX_ITER);
   //printf( "Converged : %d\n", converged );
+	if ( niter != NULL ) *niter = iter;
 	if ( converged ) 
 		return (Tglobe_new-273.15);
 	else
@@ -809,6 +836,14 @@ float Tair,		/* air (dry bulb) temperature, Kelvin						*/
 		//return (0.0/0.0);
 }
 
+float Tglobe(Tair, rh, Pair, speed, solar, fdir, cza, d_globe)
+
+float Tair, rh, Pair, speed, solar, fdir, cza, d_globe;
+
+{
+	return Tglobe_guess(Tair, rh, Pair, speed, solar, fdir, cza, d_globe, 0.0, NULL);
+}
+
 /* ============================================================================
  * Purpose: to calculate the convective heat transfer coefficient, W/(m2 K)
  *          for flow around a sphere.
@@ -1148,8 +1183,13 @@ float	speed,
  *  Author:  James C. Liljegren
  *		 Decision and Information Sciences Division
  *		 Argonne National Laboratory
+ *
+ *  Modified: not compiled if LILJEGREN_NO_MAIN is defined, so that this
+ *  file can be included by programs with their own main(), e.g., the
+ *  benchmark harness in benchmarks/c.
  */		
  
+#ifndef	LILJEGREN_NO_MAIN
 int	main()
 
 {
@@ -1209,4 +1249,5 @@ int	main()
 	
 	exit(0);
 }
+#endif	/* LILJEGREN_NO_MAIN */
 
@@ -0,0 +1,107 @@
+/*
+ * Multi-ISA build of the Liljegren C code; see isa.h
+ *
+ * The solvers are called through liljegren_isa, which
+ * liljegren_isa_select() points at the copy for the chosen level; levels
+ * the CPU does not support cannot be selected.
+ *
+ * Functions are defined in the K&R style, so the pointers are declared
+ * without prototypes and arguments are promoted as for a direct call.
+ */
+
+#include "isa.h"
+
+#define LILJEGREN_NO_MAIN
+#include "liljegren_c.c"
+
+#ifdef PYWBGT_ISA_X86
+
+/* Rename every external function of liljegren_c.c */
+#define solarposition         PYWBGT_ISA_NAME(solarposition)
+#define calc_solar_parameters PYWBGT_ISA_NAME(calc_solar_parameters)
+#define calc_wbgt             PYWBGT_ISA_NAME(calc_wbgt)
+#define Twb_guess             PYWBGT_ISA_NAME(Twb_guess)
+#define Twb                   PYWBGT_ISA_NAME(Twb)
+#define h_cylinder_in_air     PYWBGT_ISA_NAME(h_cylinder_in_air)
+#define Tglobe_guess          PYWBGT_ISA_NAME(Tglobe_guess)
+#define Tglobe                PYWBGT_ISA_NAME(Tglobe)
+#define h_sphere_in_air       PYWBGT_ISA_NAME(h_sphere_in_air)
+#define esat                  PYWBGT_ISA_NAME(esat)
+#define dew_point             PYWBGT_ISA_NAME(dew_point)
+#define viscosity             PYWBGT_ISA_NAME(viscosity)
+#define thermal_cond          PYWBGT_ISA_NAME(thermal_cond)
+#define diffusivity           PYWBGT_ISA_NAME(diffusivity)
+#define evap                  PYWBGT_ISA_NAME(evap)
+#define emis_atm              PYWBGT_ISA_NAME(emis_atm)
+#define daynum                PYWBGT_ISA_NAME(daynum)
+#define est_wind_speed        PYWBGT_ISA_NAME(est_wind_speed)
+#define stab_srdt             PYWBGT_ISA_NAME(stab_srdt)
+
+#define PYWBGT_ISA_SOURCE "liljegren_c.c"
+#include "isa_clones.h"
+#undef PYWBGT_ISA_SOURCE
+
+#undef solarposition
+#undef calc_solar_parameters
+#undef calc_wbgt
+#undef Twb_guess
+#undef Twb
+#undef h_cylinder_in_air
+#undef Tglobe_guess
+#undef Tglobe
+#undef h_sphere_in_air
+#undef esat
+#undef dew_point
+#undef viscosity
+#undef thermal_cond
+#undef diffusivity
+#undef evap
+#undef emis_atm
+#undef daynum
+#undef est_wind_speed
+#undef stab_srdt
+
+#endif /* PYWBGT_ISA_X86 */
+
+/* Solvers of one ISA level */
+typedef struct {
+	int level;
+	float (*Tglobe)();
+	float (*Twb)();
+	float (*Tglobe_guess)();
+	float (*Twb_guess)();
+} liljegren_isa_t;
+
+static const liljegren_isa_t liljegren_isa_levels[PYWBGT_ISA_COUNT] = {
+	{PYWBGT_ISA_BASELINE, Tglobe, Twb, Tglobe_guess, Twb_guess},
+#ifdef PYWBGT_ISA_X86
+	{PYWBGT_ISA_AVX2,   Tglobe_avx2,   Twb_avx2,   Tglobe_guess_avx2,   Twb_guess_avx2},
+	{PYWBGT_ISA_AVX512, Tglobe_avx512, Twb_avx512, Tglobe_guess_avx512, Twb_guess_avx512},
+#else
+	{PYWBGT_ISA_AVX2,   Tglobe, Twb, Tglobe_guess, Twb_guess},
+	{PYWBGT_ISA_AVX512, Tglobe, Twb, Tglobe_guess, Twb_guess},
+#endif
+};
+
+/* Level in use; baseline until liljegren_isa_select() is called */
+static const liljegren_isa_t *liljegren_isa = &liljegren_isa_levels[PYWBGT_ISA_BASELINE];
+
+/* Solvers used by the Cython kernels; see cliljegren.pxd */
+#define liljegren_Tglobe       (*PYWBGT_ISA_LOAD(liljegren_isa)->Tglobe)
+#define liljegren_Twb          (*PYWBGT_ISA_LOAD(liljegren_isa)->Twb)
+#define liljegren_Tglobe_guess (*PYWBGT_ISA_LOAD(liljegren_isa)->Tglobe_guess)
+#define liljegren_Twb_guess    (*PYWBGT_ISA_LOAD(liljegren_isa)->Twb_guess)
+
+/* Level in use */
+static int liljegren_isa_level(void)
+{
+	return PYWBGT_ISA_LOAD(liljegren_isa)->level;
+}
+
+/* Use the solvers of level; returns -1 if it is not supported */
+static int liljegren_isa_select(int level)
+{
+	if (!pywbgt_isa_supported(level)) return -1;
+	PYWBGT_ISA_STORE(liljegren_isa, &liljegren_isa_levels[level]);
+	return 0;
+}
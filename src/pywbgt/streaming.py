@@ -0,0 +1,321 @@
+"""
+Real-time streaming
+
+Sensors typically report every minute, while the Liljegren algorithm
+expects inputs averaged over a window and centered in it. The streaming
+engine keeps a ring buffer of recent samples for each station, updates
+the rolling means in constant time per sample, and emits WBGT for each
+new window using the scalar Liljegren path.
+
+Solar geometry is split into a location independent part, cached by
+timestamp and shared by all stations reporting at the same time, and
+per-station terms computed once when the station is added, so that only
+the cheap topocentric correction is done per window.
+
+"""
+
+import math
+import numbers
+
+import numpy
+from metpy.units import units
+
+from .constants import OUTPUT_UNITS
+from .liljegren import (
+    wetbulb_globe_scalar, LILJEGREN_DEFAULT_MIN_SPEED, LILJEGREN_D_GLOBE,
+)
+from .solar import (
+    ELEV, PRESSURE, TEMP,
+    _sun_geocentric, _station_terms, _sun_topocentric, _adjust_solar,
+)
+
+# Units of input samples if not specified, and the units used internally
+INPUT_UNITS = {
+    'solar'    : 'watt/meter**2',
+    'pres'     : 'hPa',
+    'temp_air' : 'degree_Celsius',
+    'temp_dew' : 'degree_Celsius',
+    'speed'    : 'meter/second',
+}
+
+# Maximum number of timestamps to keep geocentric sun position for
+SOLAR_CACHE_SIZE = 4096
+
+class RollingMean:
+    """
+    Ring buffer with a running mean
+
+    Missing (NaN) values are ignored in the mean. The running sum is
+    recomputed from the buffer each time it wraps around so that rounding
+    errors do not accumulate; this keeps updates constant time when
+    amortized over the window.
+
+    Arguments:
+        size (int) : Number of samples in the window
+
+    """
+
+    __slots__ = ('values', 'size', 'index', 'total', 'valid')
+
+    def __init__(self, size):
+        self.size = size
+        self.reset()
+
+    def reset(self):
+        """Remove all samples from the buffer"""
+
+        self.values = [math.nan] * self.size
+        self.index  = 0
+        self.total  = 0.0
+        self.valid  = 0
+
+    def push(self, value):
+        """Add sample to buffer, replacing the oldest"""
+
+        old = self.values[self.index]
+        if old == old:
+            self.total -= old
+            self.valid -= 1
+        if value == value:
+            self.total += value
+            self.valid += 1
+
+        self.values[self.index] = value
+        self.index += 1
+        if self.index == self.size:
+            self.index = 0
+            self.total = math.fsum(val for val in self.values if val == val)
+
+    def mean(self):
+        """Mean of valid samples in the buffer; NaN if none"""
+
+        return self.total / self.valid if self.valid > 0 else math.nan
+
+class Station:
+    """
+    State of a single station in the streaming engine
+
+    Holds the station metadata, the ring buffers of recent samples, and
+    the time independent solar geometry terms of the station.
+
+    """
+
+    def __init__(
+            self, lat, lon, window,
+            urban    = 0,
+            zspeed   = 10.0,
+            d_globe  = LILJEGREN_D_GLOBE.to('meter').magnitude,
+            elev     = ELEV,
+            pressure = PRESSURE,
+            temp     = TEMP,
+        ):
+        self.lat      = float(lat)
+        self.lon      = float(lon)
+        self.urban    = int(urban)
+        self.zspeed   = float(zspeed)
+        self.d_globe  = float(d_globe)
+        self.pressure = float(pressure)
+        self.temp     = float(temp)
+        self.x, self.y = _station_terms(self.lat, float(elev))
+
+        self.means     = {var : RollingMean(window) for var in INPUT_UNITS}
+        self.times     = [0.0] * window
+        self.count     = 0
+        self.since     = 0
+        self.last_time = None
+
+    def reset(self):
+        """Remove all samples; e.g., after a gap in the data"""
+
+        for mean in self.means.values():
+            mean.reset()
+        self.count     = 0
+        self.since     = 0
+        self.last_time = None
+
+class StreamingWBGT:
+    """
+    Streaming Liljegren WBGT for many stations
+
+    Samples are added one at a time with update(). Once a station has
+    a full window of samples, WBGT is computed from the window means every
+    step samples, with the time stamp at the center of the window.
+
+    Keyword arguments:
+        window (int) : Number of samples to average over
+        step (int) : Number of new samples between outputs; default is
+            every sample (sliding window). Set to window for consecutive,
+            non-overlapping windows
+        interval (float) : Nominal time between samples (seconds). If the
+            time between two samples of a station exceeds window times
+            interval, the station's buffers are cleared
+        input_units (dict) : Units of input samples keyed by argument
+            name. Any not given are taken from INPUT_UNITS
+        min_speed (Quantity) : Minimum speed for the height-adjusted wind
+            speed
+
+    """
+
+    def __init__(
+            self,
+            window      = 15,
+            step        = 1,
+            interval    = 60.0,
+            input_units = None,
+            min_speed   = None,
+        ):
+
+        if window < 1 or step < 1:
+            raise Exception('Window and step must be at least one (1) sample!')
+
+        self.window   = int(window)
+        self.step     = int(step)
+        self.max_gap  = float(window) * float(interval)
+        self.stations = {}
+        self._geo     = {}
+
+        self.min_speed = (
+            LILJEGREN_DEFAULT_MIN_SPEED if min_speed is None else
+            max(min_speed.to('meter/second').magnitude, LILJEGREN_DEFAULT_MIN_SPEED)
+        )
+
+        # Linear (scale, offset) conversion of each input to internal units
+        in_units      = {**INPUT_UNITS, **(input_units or {})}
+        self._convert = {}
+        for var, unit in INPUT_UNITS.items():
+            zero = units.Quantity(0.0, in_units[var]).to(unit).magnitude
+            one  = units.Quantity(1.0, in_units[var]).to(unit).magnitude
+            self._convert[var] = (one - zero, zero)
+
+    def add_station(self, station, lat, lon, **kwargs):
+        """
+        Add station to the engine
+
+        Arguments:
+            station (hashable) : Identifier of the station
+            lat (float) : Latitude of station (decimal)
+            lon (float) : Longitude of station (decimal)
+
+        Keyword arguments:
+            urban (int) : Urban (1) or rural (0) flag
+            zspeed (Quantity) : Height of wind speed measurement; default
+                is 10 m
+            d_globe (Quantity) : Diameter of the black globe thermometer
+            elev (float) : Elevation of station (meters)
+            pressure (float) : Average yearly pressure at station (hPa)
+            temp (float) : Average yearly temperature at station (degC)
+
+        """
+
+        for key in ('zspeed', 'd_globe'):
+            if hasattr(kwargs.get(key), 'to'):
+                kwargs[key] = kwargs[key].to('meter').magnitude
+
+        self.stations[station] = Station(lat, lon, self.window, **kwargs)
+
+    def _sun_geocentric(self, unixtime):
+        """Geocentric sun position, cached by timestamp"""
+
+        geo = self._geo.get(unixtime)
+        if geo is None:
+            if len(self._geo) >= SOLAR_CACHE_SIZE:
+                self._geo.clear()
+            geo = self._geo[unixtime] = _sun_geocentric(unixtime, 0)
+        return geo
+
+    def update(
+            self, station, time,
+            solar, pres, temp_air, temp_dew, speed,
+            dT = -1.0,
+        ):
+        """
+        Add sample for a station
+
+        Samples that are not newer than the previous sample of the station
+        are ignored.
+
+        Arguments:
+            station (hashable) : Identifier of the station; must have been
+                added with add_station()
+            time (float, datetime-like) : Time of the sample; Unix time
+                (seconds) or any value accepted by numpy.datetime64
+            solar (float) : Solar irradiance
+            pres (float) : Barometric pressure
+            temp_air (float) : Air (dry bulb) temperature
+            temp_dew (float) : Dew point temperature
+            speed (float) : Wind speed
+
+        Keyword arguments:
+            dT (float) : Vertical temperature difference (degree Celsius)
+                to use for output of this sample
+
+        Returns:
+            dict : Output for the window ending with this sample, or None
+                if no output is due. Includes the station, the datetime
+                at the center of the window, and each variable in
+                OUTPUT_UNITS as float; NaN if the solvers did not converge
+
+        """
+
+        state = self.stations[station]
+        if isinstance(time, numbers.Real):
+            time = float(time)
+        else:
+            time = numpy.datetime64(time, 'ns').astype(numpy.int64) / 1.0e9
+
+        if state.last_time is not None:
+            if time <= state.last_time:
+                return None
+            if time - state.last_time > self.max_gap:
+                state.reset()
+
+        for var, value in zip(
+                INPUT_UNITS,
+                (solar, pres, temp_air, temp_dew, speed),
+            ):
+            scale, offset = self._convert[var]
+            state.means[var].push(value * scale + offset)
+
+        state.times[state.count % self.window] = time
+        state.last_time = time
+        state.count    += 1
+        state.since    += 1
+        if state.count < self.window or state.since < self.step:
+            return None
+        state.since = 0
+
+        means  = [mean.mean() for mean in state.means.values()]
+        center = 0.5 * (time + state.times[state.count % self.window])
+        return self._compute(station, state, center, means, dT)
+
+    def _compute(self, station, state, center, means, dT):
+        """Compute WBGT for a window of a station"""
+
+        solar, pres, temp_air, temp_dew, speed = means
+
+        R, xi, v, alpha, delta = self._sun_geocentric(center)
+        cza = _sun_topocentric(
+            xi, v, alpha, delta, state.lat, state.lon, state.x, state.y,
+            state.pressure, state.temp, 0,
+        )
+        solar, fdir = _adjust_solar(solar, cza, R)
+
+        res = None
+        if all(val == val for val in means):
+            res = wetbulb_globe_scalar(
+                temp_air, temp_dew, pres, speed, solar, fdir, cza,
+                zspeed    = state.zspeed,
+                dT        = dT,
+                urban     = state.urban,
+                min_speed = self.min_speed,
+                d_globe   = state.d_globe,
+            )
+        if res is None:
+            res = (math.nan,) * len(OUTPUT_UNITS)
+
+        out = {
+            'station'  : station,
+            'datetime' : numpy.datetime64(int(round(center * 1.0e9)), 'ns'),
+        }
+        out.update(zip(OUTPUT_UNITS, res))
+        return out
@@ -0,0 +1,385 @@
+"""
+Seeded synthetic meteorology for benchmarks and tests
+
+Uniform random inputs give misleading solver iteration counts, as most
+points are in regimes that rarely occur (e.g., full sun at night, or
+calm, humid, and hot at once). The fields generated here have realistic
+joint statistics:
+
+    - Irradiance from the true solar geometry (pywbgt.solar) and a clear
+      sky model, reduced by slowly varying cloud cover
+    - Temperature with seasonal and diurnal cycles, a diurnal range that
+      shrinks under clouds, and synoptic anomalies
+    - Dew point below temperature, with a dew point depression that
+      depends on the climate of the site, peaks in the afternoon, and
+      closes at night and under clouds
+    - Low, often calm winds at night and gusty winds by day
+    - Pressure from elevation and synoptic anomalies
+    - Occasional missing (NaN) values
+
+Values are a deterministic function of the seed, the time, and the index
+of the site, so a record can be generated in one call or streamed in
+chunks of any size with identical results:
+
+    from pywbgt import synthetic, wbgt
+
+    met = synthetic.stations(10**6, nstation=100, seed=1)
+    res = wbgt('liljegren', *synthetic.args(met))
+
+    for met in synthetic.stream(10**9, chunk_size=10**7):
+        ...
+
+"""
+
+import numpy
+from metpy.units import units
+from pandas import Timestamp, date_range
+from pandas.tseries.frequencies import to_offset
+
+from .liljegren import LILJEGREN_SOLAR_CONST
+from .solar import PRESSURE, TEMP, adjust_solar, sun_geocentric, sun_geometry_grid
+
+# Order of the arguments of pywbgt.wbgt()
+ARGS  = ('datetime', 'lat', 'lon', 'solar', 'pres', 'temp_air', 'temp_dew', 'speed')
+UNITS = {
+    'solar'    : 'watt/m**2',
+    'pres'     : 'hPa',
+    'temp_air' : 'degC',
+    'temp_dew' : 'degC',
+    'speed'    : 'm/s',
+}
+
+START = '2000-06-01'
+FREQ  = '10min'
+
+# Periods (days) of the synoptic anomalies; incommensurate so that the
+# anomalies do not repeat over long records
+_PERIODS = numpy.array([2.3, 3.7, 5.9, 9.1, 14.3])
+
+# Streams of the hash, one per use
+_SITE, _TEMP, _DEW, _CLOUD, _WIND, _PRES, _NOISE, _GUST, _MISSING = range(9)
+
+def _mix(x):
+    """SplitMix64 finalizer of a uint64 array"""
+
+    x = x ^ (x >> numpy.uint64(30))
+    x = x * numpy.uint64(0xBF58476D1CE4E5B9)
+    x = x ^ (x >> numpy.uint64(27))
+    x = x * numpy.uint64(0x94D049BB133111EB)
+    return x ^ (x >> numpy.uint64(31))
+
+def _uniform(seed, stream, *keys):
+    """
+    Uniform values in (0, 1) hashed from the seed, stream, and keys
+
+    Keys are broadcast integer arrays, e.g., time and site index.
+
+    """
+
+    with numpy.errstate(over='ignore'):
+        h = _mix(numpy.uint64(seed) * numpy.uint64(0x9E3779B97F4A7C15) + numpy.uint64(stream))
+        for key in keys:
+            h = _mix(h ^ numpy.asarray(key).astype(numpy.uint64))
+    return ((h >> numpy.uint64(11)).astype(numpy.float64) + 0.5) / 2.0**53
+
+def _normal(seed, stream, *keys):
+    """Standard normal values hashed from the seed, stream, and keys"""
+
+    u1 = _uniform(seed, stream, *keys)
+    u2 = _uniform(seed, stream + 64, *keys)
+    return numpy.sqrt(-2.0*numpy.log(u1)) * numpy.cos(2.0*numpy.pi*u2)
+
+def _anomaly(seed, stream, days, site):
+    """
+    Smooth anomaly with unit variance and synoptic time scales
+
+    Sum of sinusoids with site dependent phases, so that it is a function
+    of time and site only. Expanded as sin(wt)cos(p) + cos(wt)sin(p), so
+    that the sines are only computed per time and per site.
+
+    """
+
+    phase = 2.0*numpy.pi*_uniform(seed, stream, numpy.arange(_PERIODS.size)[:, None], site)
+    omega = 2.0*numpy.pi*days[:, None]/_PERIODS
+    out   = numpy.sin(omega) @ numpy.cos(phase) + numpy.cos(omega) @ numpy.sin(phase)
+    return out * numpy.sqrt(2.0/_PERIODS.size)
+
+def sites(site, seed=0):
+    """
+    Location and climate of sites by index
+
+    Latitudes are uniform over the area of the globe between 60S and 70N.
+
+    Arguments:
+        site (ndarray) : Integer index of each site
+
+    Keyword arguments:
+        seed (int) : Seed of the generator
+
+    Returns:
+        dict : Latitude and longitude (decimal), elevation (m), and aridity
+            (0 to 1) of each site
+
+    """
+
+    site = numpy.asarray(site)
+    u    = [_uniform(seed, _SITE, site, i) for i in range(4)]
+    smin, smax = numpy.sin(numpy.radians([-60.0, 70.0]))
+    return {
+        'lat'     : numpy.degrees(numpy.arcsin(smin + (smax - smin)*u[0])),
+        'lon'     : 360.0*u[1] - 180.0,
+        'elev'    : 2500.0 * u[2]**3,
+        'aridity' : u[3],
+    }
+
+def fields(datetime, lat, lon, elev=None, aridity=None, site=None, seed=0, missing=1.0e-3):
+    """
+    Synthetic inputs for all combinations of times and sites
+
+    Arguments:
+        datetime (pandas.DatetimeIndex) : Times (UTC)
+        lat (ndarray) : Latitude of each of npoint sites (decimal)
+        lon (ndarray) : Longitude of each site (decimal)
+
+    Keyword arguments:
+        elev (ndarray) : Elevation of each site (meters); default is sea level
+        aridity (ndarray) : Aridity of each site, from zero (0; humid) to
+            one (1; desert); default is 0.5
+        site (ndarray) : Integer index of each site, used with the time to
+            generate values; default is the position in lat
+        seed (int) : Seed of the generator
+        missing (float) : Fraction of values of each variable that are NaN
+
+    Returns:
+        dict : Arrays with shape (ntime, npoint) of solar irradiance,
+            pressure, air and dew point temperature, and wind speed as
+            Quantity, along with the cosine of the solar zenith angle
+            (cosz) and fraction of direct beam (f_db)
+
+    """
+
+    lat     = numpy.atleast_1d(numpy.asarray(lat, dtype=numpy.float64))
+    lon     = numpy.atleast_1d(numpy.asarray(lon, dtype=numpy.float64))
+    npoint  = lat.size
+    elev    = numpy.broadcast_to(0.0 if elev is None else elev, (npoint,)).astype(numpy.float64)
+    aridity = numpy.broadcast_to(0.5 if aridity is None else aridity, (npoint,))
+    site    = numpy.arange(npoint) if site is None else numpy.asarray(site)
+
+    times    = datetime.values.astype('datetime64[ns]').astype(numpy.int64)
+    minute   = (times // 60_000_000_000)[:, None]
+    unixtime = times / 1.0e9
+    days     = unixtime / 86400.0
+
+    # True solar geometry and clear sky irradiance
+    geo  = sun_geocentric(unixtime, 0.0)
+    cosz = sun_geometry_grid(
+        geo, lat, lon, elev,
+        numpy.full(npoint, PRESSURE), numpy.full(npoint, TEMP), 0.0,
+    ).astype(numpy.float64)
+    R    = geo[0][:, None]
+    sun  = numpy.maximum(cosz, 0.0)
+    airmass = 1.0 / numpy.maximum(sun, 0.02)
+    clear   = 1.1 * LILJEGREN_SOLAR_CONST / R**2 * sun * 0.7**(airmass**0.678)
+
+    # Cloud cover from 0 to 1; more frequent at wet sites
+    cloud = 1.0 / (1.0 + numpy.exp(-(
+        1.5*_anomaly(seed, _CLOUD, days, site) + 1.5*(0.5 - aridity)
+    )))
+    broken = _uniform(seed, _NOISE, minute, site)
+    solar  = clear * (1.0 - 0.75*cloud**3.4) * (1.0 - 0.35*cloud*broken)
+
+    # Temperature: climate of latitude and elevation, season, day, weather
+    hour    = (days[:, None] % 1.0) * 24.0 + lon/15.0
+    diurnal = numpy.cos(2.0*numpy.pi*(hour - 15.0)/24.0)
+    season  = numpy.cos(2.0*numpy.pi*(days[:, None] % 365.25 - 196.0)/365.25) * numpy.sign(lat)
+    mean    = 27.0 - 0.45*numpy.maximum(numpy.abs(lat) - 15.0, 0.0) - 6.5e-3*elev
+    drange  = (5.0 + 10.0*aridity) * (1.0 - 0.6*cloud)
+    temp_air = (
+        mean
+        + 0.2*numpy.abs(lat)*season
+        + 0.5*drange*diurnal
+        + 3.0*_anomaly(seed, _TEMP, days, site)
+    )
+
+    # Dew point depression; largest in the afternoon at dry sites
+    depress  = (
+        (2.0 + 14.0*aridity) * (1.0 - 0.5*cloud)
+        + 0.4*drange*(diurnal + 1.0)
+        + 2.0*_anomaly(seed, _DEW, days, site)
+    )
+    temp_dew = temp_air - numpy.maximum(depress, 0.0)
+
+    # Wind: lower and often calm in the stable night, Weibull gusts
+    mixing = numpy.where(sun > 0.0, 1.0 + 0.6*numpy.sqrt(sun), 0.45)
+    speed  = (
+        (2.0 + 2.0*_uniform(seed, _SITE, site, 4))
+        * numpy.exp(0.3*_anomaly(seed, _WIND, days, site))
+        * mixing
+        * numpy.sqrt(-numpy.log(_uniform(seed, _GUST, minute, site))) / 0.886
+    )
+    speed  = numpy.where(speed < 0.3, 0.0, numpy.minimum(speed, 30.0))
+
+    pres = (
+        PRESSURE*numpy.exp(-elev/8434.0)
+        + 7.0*_anomaly(seed, _PRES, days, site)
+        + 0.3*_normal(seed, _PRES, minute, site)
+    )
+
+    out = {
+        'solar'    : solar,
+        'pres'     : pres,
+        'temp_air' : temp_air,
+        'temp_dew' : temp_dew,
+        'speed'    : speed,
+    }
+    if missing > 0:
+        for i, key in enumerate(UNITS):
+            out[key] = numpy.where(
+                _uniform(seed, _MISSING + 16*i, minute, site) < missing, numpy.nan, out[key],
+            )
+
+    solar_adj, f_db = adjust_solar(
+        numpy.nan_to_num(out['solar']).ravel(),
+        cosz.ravel(),
+        numpy.broadcast_to(R, cosz.shape).ravel(),
+    )
+    out = {key : units.Quantity(val, UNITS[key]) for key, val in out.items()}
+    out['cosz'] = cosz
+    out['f_db'] = f_db.reshape(cosz.shape).astype(numpy.float64)
+    return out
+
+def _flat(start, stop, nstation, begin, freq, seed, missing, dtype):
+    """Elements start to stop of a time-major record of nstation sites"""
+
+    t0, t1 = start // nstation, -(-stop // nstation)
+    # From the first time of the chunk, so that chunks far into the
+    # record do not generate all earlier times
+    offset = to_offset(freq)
+    dates  = date_range(
+        offset.rollforward(Timestamp(begin)) + t0*offset, periods=t1-t0, freq=offset,
+    )
+    site   = numpy.arange(nstation)
+    info   = sites(site, seed)
+    met    = fields(
+        dates, info['lat'], info['lon'], info['elev'], info['aridity'],
+        site=site, seed=seed, missing=missing,
+    )
+
+    i0, i1 = start - t0*nstation, stop - t0*nstation
+    def flat(val):
+        return numpy.ravel(val)[i0:i1]
+
+    out = {
+        'datetime' : dates.repeat(nstation)[i0:i1],
+        'lat'      : flat(numpy.broadcast_to(info['lat'],  (dates.size, nstation))),
+        'lon'      : flat(numpy.broadcast_to(info['lon'],  (dates.size, nstation))),
+        'elev'     : flat(numpy.broadcast_to(info['elev'], (dates.size, nstation))),
+    }
+    for key, val in met.items():
+        if key in UNITS:
+            out[key] = units.Quantity(flat(val.magnitude).astype(dtype), val.units)
+        else:
+            out[key] = flat(val).astype(dtype)
+    return out
+
+def stations(size, nstation=16, start=START, freq=FREQ, seed=0, missing=1.0e-3, dtype='float64'):
+    """
+    Station series flattened to size elements
+
+    Elements are in time-major order: all stations at the first time, then
+    all stations at the second time, and so on.
+
+    Arguments:
+        size (int) : Number of elements
+
+    Keyword arguments:
+        nstation (int) : Number of stations; locations and climates are
+            from sites()
+        start (str) : First time (UTC)
+        freq (str) : Time step, as a pandas frequency
+        seed (int) : Seed of the generator
+        missing (float) : Fraction of values of each variable that are NaN
+        dtype (str) : Floating point type of the values
+
+    Returns:
+        dict : Arguments of pywbgt.wbgt() keyed as in ARGS, along with
+            elev, cosz, and f_db; see args()
+
+    """
+
+    return _flat(0, size, nstation, start, freq, seed, missing, dtype)
+
+def stream(size, chunk_size=2**20, nstation=16, start=START, freq=FREQ, seed=0, missing=1.0e-3, dtype='float64'):
+    """
+    Station series in chunks
+
+    The chunks, concatenated, are the same as stations() with the same
+    arguments, for any chunk_size.
+
+    Arguments:
+        size (int) : Total number of elements
+
+    Keyword arguments:
+        chunk_size (int) : Number of elements per chunk
+        **kwargs : See stations()
+
+    Returns:
+        generator : Yields dicts as returned by stations()
+
+    """
+
+    for first in range(0, size, chunk_size):
+        yield _flat(
+            first, min(first + chunk_size, size), nstation, start, freq, seed, missing, dtype,
+        )
+
+def grid(ntime, lat, lon, start=START, freq=FREQ, elev=None, aridity=None, seed=0, missing=1.0e-3):
+    """
+    Gridded cube of inputs
+
+    Arguments:
+        ntime (int) : Number of times
+        lat (ndarray) : Latitudes of the grid (decimal)
+        lon (ndarray) : Longitudes of the grid (decimal)
+
+    Keyword arguments:
+        start (str) : First time (UTC)
+        freq (str) : Time step, as a pandas frequency
+        elev (ndarray) : Elevation (meters) with shape (nlat, nlon)
+        aridity (ndarray) : Aridity (0 to 1) with shape (nlat, nlon)
+        seed (int) : Seed of the generator
+        missing (float) : Fraction of values of each variable that are NaN
+
+    Returns:
+        dict : Times, latitude and longitude with shape (nlat, nlon), and
+            fields() with shape (ntime, nlat, nlon)
+
+    """
+
+    dates    = date_range(start, periods=ntime, freq=freq)
+    lon2d, lat2d = numpy.meshgrid(lon, lat)
+    shape    = lat2d.shape
+    def point(val):
+        return None if val is None else numpy.broadcast_to(val, shape).ravel()
+
+    met = fields(
+        dates, lat2d.ravel(), lon2d.ravel(), point(elev), point(aridity),
+        seed=seed, missing=missing,
+    )
+    out = {key : val.reshape((ntime,) + shape) for key, val in met.items()}
+    out.update(datetime=dates, lat=lat2d, lon=lon2d)
+    return out
+
+def args(met):
+    """
+    Positional arguments of pywbgt.wbgt() from stations() or stream()
+
+    Arguments:
+        met (dict) : Output of stations() or stream()
+
+    Returns:
+        tuple : Values of ARGS, in order
+
+    """
+
+    return tuple(met[key] for key in ARGS)
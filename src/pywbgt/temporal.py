@@ -0,0 +1,131 @@
+"""
+Sub-hourly WBGT from hourly inputs
+
+Interpolating hourly model fields to, e.g., 10-minute steps before
+computing WBGT multiplies the memory used by the inputs by the number of
+steps per hour. Here the inputs are kept at their source times and are
+interpolated inside the Liljegren kernel, at the point they are used.
+Solar geometry is computed at the target times, once per time and
+location.
+
+"""
+
+import numpy
+
+from .liljegren import wetbulb_globe_interp
+from .solar import ELEV, PRESSURE, TEMP, sun_geocentric, sun_geometry_grid
+from .utils import datetime_adjust, datetime_check
+
+def interp_weights(src_datetime, datetime):
+    """
+    Linear interpolation indices and weights between two time axes
+
+    Arguments:
+        src_datetime (pandas.DatetimeIndex) : Increasing source times
+        datetime (pandas.DatetimeIndex) : Target times
+
+    Returns:
+        tuple : Index of the source time at or before each target time
+            (-1 if outside the source times) and weight of the following
+            source time
+
+    """
+
+    src = datetime_check(src_datetime).values.astype('datetime64[ns]').astype(numpy.int64)
+    tgt = datetime_check(datetime).values.astype('datetime64[ns]').astype(numpy.int64)
+    if numpy.any(numpy.diff(src) <= 0):
+        raise Exception('Source times must be strictly increasing!')
+
+    index  = numpy.searchsorted(src, tgt, side='right') - 1
+    inside = (index >= 0) & (tgt <= src[-1])
+    index  = numpy.where(inside, numpy.minimum(index, src.size-2), -1)
+
+    weight = numpy.zeros(tgt.size, dtype=numpy.float64)
+    if src.size > 1:
+        i0 = numpy.maximum(index, 0)
+        weight = numpy.where(
+            inside,
+            (tgt - src[i0]) / (src[i0+1] - src[i0]),
+            0.0,
+        )
+    else:
+        index = numpy.where(tgt == src[0], 0, -1)
+    return index, weight
+
+def wbgt_interp(
+        src_datetime, datetime, lat, lon,
+        solar, pres, temp_air, temp_dew, speed,
+        gmt      = None,
+        avg      = None,
+        elev     = None,
+        pressure = None,
+        temp     = None,
+        **kwargs,
+    ):
+    """
+    Liljegren WBGT at target times from inputs at coarser source times
+
+    Inputs are linearly interpolated in time inside the kernel; target
+    times outside the source times are NaN.
+
+    Arguments:
+        src_datetime (pandas.DatetimeIndex) : Times of the inputs (e.g.,
+            hourly); must be increasing
+        datetime (pandas.DatetimeIndex) : Target times (e.g., every 10
+            minutes)
+        lat (ndarray) : Latitude of each of npoint locations (decimal)
+        lon (ndarray) : Longitude of each location (decimal)
+        solar (Quantity) : solar irradiance; (nsource, npoint)
+        pres (Quantity) : barometric pressure; (nsource, npoint)
+        temp_air (Quantity) : air (dry bulb) temperature; (nsource, npoint)
+        temp_dew (Quantity) : Dew point temperature; (nsource, npoint)
+        speed (Quantity) : wind speed; (nsource, npoint)
+
+    Keyword arguments:
+        gmt (float) : LST-GMT difference  (hours; negative in USA)
+        avg (float) : averaging time of the target values (minutes); used
+            for the solar geometry of the target times
+        elev (ndarray) : Elevation of each location (meters)
+        pressure (ndarray) : Average yearly pressure at each location (hPa)
+        temp (ndarray) : Average yearly temperature at each location (degC)
+        **kwargs : All other keywords (urban, zspeed, dT, min_speed,
+            d_globe) are passed to liljegren.wetbulb_globe_interp()
+
+    Returns:
+        dict : Same as pywbgt.wbgt(), with values of shape
+            (ntarget, npoint)
+
+    """
+
+    datetime = datetime_check(datetime)
+    index, weight = interp_weights(src_datetime, datetime)
+
+    npoint = temp_air.shape[-1]
+    def point_values(val, default):
+        if val is None:
+            return numpy.full(npoint, default)
+        return numpy.broadcast_to(numpy.asarray(val, dtype=numpy.float64), (npoint,)).copy()
+
+    lat = point_values(lat, numpy.nan)
+    lon = point_values(lon, numpy.nan)
+
+    unixtime = (
+        datetime_adjust(datetime, gmt, avg)
+        .values
+        .astype('datetime64[ns]')
+        .astype(numpy.int64)
+    ) / 1.0e9
+    geo = sun_geocentric(unixtime, 0.0)
+    cza = sun_geometry_grid(
+        geo, lat, lon,
+        point_values(elev,     ELEV),
+        point_values(pressure, PRESSURE),
+        point_values(temp,     TEMP),
+        0.0,
+    )
+
+    return wetbulb_globe_interp(
+        index, weight, cza, geo[0],
+        solar, pres, temp_air, temp_dew, speed,
+        **kwargs,
+    )
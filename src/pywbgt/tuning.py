@@ -0,0 +1,330 @@
+"""
+Auto-tuning of threads, schedules, chunk sizes, and ISA level
+
+The best settings differ between laptops, virtual machines, and HPC
+nodes. autotune() times short micro-benchmarks of each method on
+synthetic inputs (pywbgt.synthetic) and stores the best settings in a
+cache file for the host:
+
+    import pywbgt
+    pywbgt.autotune()
+
+When pywbgt is imported, the cache file of the host is loaded and the
+settings are used by default:
+
+    - threads : Number of threads for each method; used by wbgt() (and
+      so by all engines that call it) unless the number of threads has
+      been limited, e.g., by set_num_threads()
+    - schedule : OpenMP schedule of the Liljegren and Bernard solver loops
+    - chunk_size : Elements per chunk of wbgt_chunked() and per task of
+      scheduler.wbgt_tasks(), unless given
+    - isa : ISA level of the compiled kernels, timed with the Liljegren
+      method; see pywbgt.isa
+
+Environment variables override the cache for all methods:
+
+    PYWBGT_THREADS=4
+    PYWBGT_SCHEDULE=dynamic,1024
+    PYWBGT_CHUNK_SIZE=65536
+    PYWBGT_ISA=avx2
+    PYWBGT_TUNING_FILE=/path/to/tuning.json    # empty to disable the cache
+
+The cache is ignored if it was written on a machine with a different
+number of threads or supported ISA levels. Note that schedules other
+than static do not keep the first-touch placement of the Liljegren
+buffers on multi-socket nodes.
+
+"""
+
+import json
+import os
+import socket
+import time
+import warnings
+
+from .constants import METHODS
+
+ENVIRONMENT = {
+    'threads'    : 'PYWBGT_THREADS',
+    'schedule'   : 'PYWBGT_SCHEDULE',
+    'chunk_size' : 'PYWBGT_CHUNK_SIZE',
+    'isa'        : 'PYWBGT_ISA',
+}
+CACHE_ENV = 'PYWBGT_TUNING_FILE'
+
+# Candidates for the micro-benchmarks
+SCHEDULES   = (('static', 0), ('dynamic', 256), ('dynamic', 4096), ('guided', 0))
+CHUNK_SIZES = tuple(2**i for i in range(12, 23))
+
+# Chunk sizes within this fraction of the best time per element are
+# considered as fast; the smallest is used
+CHUNK_TOLERANCE = 0.05
+
+_settings = {}
+
+def cache_path():
+    """
+    Path of the cache file of this host
+
+    Returns:
+        str : PYWBGT_TUNING_FILE if set, else a file named for the host in
+            the user cache directory; None if PYWBGT_TUNING_FILE is empty
+
+    """
+
+    path = os.environ.get(CACHE_ENV)
+    if path is not None:
+        return path or None
+    root = os.environ.get('XDG_CACHE_HOME') or os.path.join(os.path.expanduser('~'), '.cache')
+    return os.path.join(root, 'pywbgt', f'tuning-{socket.gethostname()}.json')
+
+def _machine():
+
+    from . import isa, parallel
+
+    return {
+        'host'        : socket.gethostname(),
+        'max_threads' : parallel.max_threads(),
+        'isa'         : isa.isa_supported(),
+    }
+
+def _kernel(method):
+    """Module with the OpenMP solver loop of method; None if it has none"""
+
+    if method == 'liljegren':
+        from . import liljegren
+        return liljegren
+    if method == 'bernard':
+        from . import bernard
+        return bernard
+    return None
+
+def _environment():
+    """Settings from the environment; invalid values are skipped with a warning"""
+
+    out = {}
+    for key, var in ENVIRONMENT.items():
+        val = os.environ.get(var)
+        if not val:
+            continue
+        try:
+            if key in ('threads', 'chunk_size'):
+                out[key] = int(val)
+            elif key == 'schedule':
+                kind, _, chunk = val.partition(',')
+                out[key] = [kind.strip().lower(), int(chunk or 0)]
+            else:
+                out[key] = val.lower()
+        except ValueError:
+            warnings.warn(f'Ignoring {var} : {val}')
+    return out
+
+def load(path=None):
+    """
+    Load tuned settings and apply the process-wide ones
+
+    Called when pywbgt is imported. The schedules of the solver loops
+    and the ISA level are set here; threads and chunk sizes are read by
+    the engines when called.
+
+    Keyword arguments:
+        path (str) : Cache file; default is cache_path()
+
+    Returns:
+        dict : Settings of each method, after environment overrides
+
+    """
+
+    global _settings
+
+    path   = path or cache_path()
+    cached = {}
+    if path is not None and os.path.isfile(path):
+        try:
+            with open(path) as fid:
+                data = json.load(fid)
+        except (OSError, ValueError):
+            data = {}
+        if data.get('machine') == _machine():
+            cached = data.get('methods', {})
+
+    env = _environment()
+    _settings = {
+        method : {**cached.get(method, {}), **env}
+        for method in METHODS
+    }
+    _apply()
+    return _settings
+
+def _apply():
+    """Set the process-wide settings; invalid settings are skipped with a warning"""
+
+    from . import isa
+
+    for method, tuned in _settings.items():
+        kernel = _kernel(method)
+        if kernel is not None and 'schedule' in tuned:
+            try:
+                kernel.set_openmp_schedule(*tuned['schedule'])
+            except Exception as err:
+                warnings.warn(f'Ignoring tuned schedule of {method} : {err}')
+
+    # The environment has already been applied by isa on import
+    level = _settings.get('liljegren', {}).get('isa')
+    if level is not None and ENVIRONMENT['isa'] not in os.environ:
+        try:
+            isa.set_isa(level)
+        except Exception as err:
+            warnings.warn(f'Ignoring tuned ISA level : {err}')
+
+def settings(method):
+    """
+    Tuned settings of a method
+
+    Arguments:
+        method (str) : Name of the method
+
+    Returns:
+        dict : Any of threads, schedule, chunk_size, and isa; empty if
+            there are no tuned settings
+
+    """
+
+    return _settings.get(method.lower(), {})
+
+def threads(method):
+    """Tuned number of threads of method; None if not tuned"""
+
+    return settings(method).get('threads')
+
+def chunk_size(method, default):
+    """Tuned chunk size of method; default if not tuned"""
+
+    return settings(method).get('chunk_size', default)
+
+def _time(func, min_time):
+    """Best time of one call, repeating calls for at least min_time"""
+
+    func()
+    best  = float('inf')
+    total = 0.0
+    while total < min_time:
+        t0 = time.perf_counter()
+        func()
+        elapsed = time.perf_counter() - t0
+        best    = min(best, elapsed)
+        total  += elapsed
+    return best
+
+def autotune(methods=None, size=2**18, min_time=0.1, save=True, path=None):
+    """
+    Find and store the fastest settings of each method on this machine
+
+    Settings are tuned one at a time, each with the best of those before
+    it: the ISA level (Liljegren only), the number of threads, the OpenMP
+    schedule (Liljegren and Bernard only), and the chunk size, which is
+    the smallest chunk whose time per element is within CHUNK_TOLERANCE
+    of the fastest. Each candidate is timed on synthetic inputs of up to
+    size elements, repeated for at least min_time seconds.
+
+    Keyword arguments:
+        methods (list) : Methods to tune; default is all
+        size (int) : Number of elements of the micro-benchmarks
+        min_time (float) : Seconds to time each candidate for
+        save (bool) : If set, write the settings to the cache file and use
+            them in this process
+        path (str) : Cache file; default is cache_path()
+
+    Returns:
+        dict : Settings of each method, with the time per element (seconds)
+            of the tuned settings under 'seconds'
+
+    """
+
+    from . import _wbgt, isa, parallel, synthetic
+
+    methods = [method.lower() for method in (methods or METHODS)]
+    met     = synthetic.args(synthetic.stations(size, missing=0.0))
+
+    # Not through wbgt(), which would run at the threads already tuned
+    # rather than at the candidate being timed
+    def run(method, nelem=size):
+        args = tuple(arg[:nelem] for arg in met)
+        return lambda: _wbgt(method, *args)
+
+    results = {}
+    for method in methods:
+        if method not in METHODS:
+            raise Exception( f'Unsupported WBGT method : {method}! Must be one of {METHODS}' )
+        kernel = _kernel(method)
+        tuned  = {}
+        with parallel.num_threads(parallel.max_threads()):
+            if method == 'liljegren':
+                previous = isa.get_isa()
+                times    = {}
+                for level in isa.isa_supported():
+                    isa.set_isa(level)
+                    times[level] = _time(run(method), min_time)
+                tuned['isa'] = min(times, key=times.get)
+                isa.set_isa(tuned['isa'] if save else previous)
+
+            times = {}
+            for nthreads in parallel.thread_counts():
+                with parallel.num_threads(nthreads):
+                    times[nthreads] = _time(run(method), min_time)
+            tuned['threads'] = min(times, key=times.get)
+
+        with parallel.num_threads(tuned['threads']):
+            if kernel is not None:
+                previous = kernel.get_openmp_schedule()
+                times    = {}
+                for schedule in SCHEDULES:
+                    kernel.set_openmp_schedule(*schedule)
+                    times[schedule] = _time(run(method), min_time)
+                best = min(times, key=times.get)
+                tuned['schedule'] = list(best)
+                kernel.set_openmp_schedule(*(best if save else previous))
+
+            per_elem = {
+                nelem : _time(run(method, nelem), min_time) / nelem
+                for nelem in CHUNK_SIZES if nelem <= size
+            }
+            fastest = min(per_elem.values())
+            tuned['chunk_size'] = min(
+                nelem for nelem, val in per_elem.items()
+                if val <= fastest * (1.0 + CHUNK_TOLERANCE)
+            )
+            tuned['seconds'] = fastest
+
+        results[method] = tuned
+
+    if save:
+        _save(results, path)
+        env = _environment()
+        for method, tuned in results.items():
+            _settings[method] = {**tuned, **env}
+        _apply()
+    return results
+
+def _save(results, path=None):
+    """Merge results into the cache file, written atomically"""
+
+    path = path or cache_path()
+    if path is None:
+        return
+    data = {'machine' : _machine(), 'methods' : {}}
+    if os.path.isfile(path):
+        try:
+            with open(path) as fid:
+                old = json.load(fid)
+            if old.get('machine') == data['machine']:
+                data['methods'] = old.get('methods', {})
+        except (OSError, ValueError):
+            pass
+    data['methods'].update(results)
+
+    os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
+    tmp = f'{path}.{os.getpid()}.tmp'
+    with open(tmp, 'w') as fid:
+        json.dump(data, fid, indent=2)
+    os.replace(tmp, path)
@@ -5,6 +5,9 @@ Common utilities used across the pywbgt packge are found here
 
 """
 
+import os
+
+import numpy
 from pandas import to_datetime, to_timedelta, DatetimeIndex
 
 def datetime_adjust(datetime, gmt, avg):
@@ -48,4 +51,29 @@ def datetime_check(datetime):
 
     return to_datetime(datetime)
 
+def atomic_savez(path, **arrays):
+    """
+    Write arrays to an npz file atomically
+
+    The arrays are written to a temporary file in the same directory
+    that is then renamed over the target path. Readers will therefore
+    only ever see a complete file, and writing the same data to the
+    same path more than once is idempotent.
+
+    Arguments:
+        path (str) : Full path of the npz file to write
+        **arrays : Arrays to write to the file; passed to numpy.savez
+
+    Returns:
+        str : The path written to
+
+    """
+
+    tmp = f"{path}.tmp{os.getpid()}"
+    with open(tmp, 'wb') as fid:
+        numpy.savez(fid, **arrays)
+        fid.flush()
+        os.fsync(fid.fileno())
+    os.replace(tmp, path)
 
+    return path
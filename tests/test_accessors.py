@@ -0,0 +1,162 @@
+import unittest
+
+import pandas
+import numpy
+from metpy.units import units
+
+from pywbgt import wbgt, accessors
+
+try:
+    import dask
+except ImportError:
+    dask = None
+
+class TestAccessors(unittest.TestCase):
+
+    def setUp(self):
+
+        self.times = pandas.date_range('20000601T12', periods=3, freq='h')
+        self.lats  = numpy.array([30.0, 35.0])
+        self.lons  = numpy.array([-90.0, -85.0, -80.0, -75.0])
+        shape      = (self.times.size, self.lats.size, self.lons.size)
+        rng        = numpy.random.default_rng(1)
+        self.data  = {
+            'ssrd' : (rng.uniform(100, 900, shape), 'watt/meter**2'),
+            'sp'   : (rng.uniform(98000, 102000, shape), 'Pa'),
+            't2m'  : (rng.uniform(290, 310, shape), 'K'),
+            'd2m'  : (rng.uniform(280, 289, shape), 'K'),
+            'u10'  : (rng.uniform(-5, 5, shape), 'm/s'),
+            'v10'  : (rng.uniform(-5, 5, shape), 'm/s'),
+        }
+
+    def reference(self, method, **kwargs):
+
+        time, lat, lon = numpy.meshgrid(
+            self.times.values, self.lats, self.lons, indexing='ij',
+        )
+        met = {
+            key : units.Quantity(val.ravel(), unit)
+            for key, (val, unit) in self.data.items()
+        }
+        return wbgt(
+            method,
+            pandas.DatetimeIndex(time.ravel()), lat.ravel(), lon.ravel(),
+            met['ssrd'], met['sp'], met['t2m'], met['d2m'],
+            numpy.hypot(met['u10'], met['v10']),
+            **kwargs,
+        )
+
+    def dataset(self):
+
+        return accessors.xarray.Dataset(
+            {
+                key : (('time', 'latitude', 'longitude'), val, {'units' : unit})
+                for key, (val, unit) in self.data.items()
+            },
+            coords = {
+                'time'      : self.times,
+                'latitude'  : self.lats,
+                'longitude' : self.lons,
+            },
+        )
+
+    @unittest.skipIf(accessors.xarray is None, 'xarray not installed')
+    def test_dataset(self):
+
+        dataset = self.dataset()
+        ref     = self.reference('liljegren')
+        res = dataset.wbgt.compute(method='liljegren')
+        self.assertEqual(res['Twbg'].dims, ('time', 'latitude', 'longitude'))
+        numpy.testing.assert_allclose(
+            res['Twbg'].values.ravel(), ref['Twbg'].magnitude, rtol=1e-6,
+        )
+
+        # Inputs are left as they were
+        numpy.testing.assert_array_equal(dataset['ssrd'].values, self.data['ssrd'][0])
+
+        # Lazy results declare the dtype of the computed blocks
+        if dask is not None:
+            lazy = dataset.chunk({'time' : 1}).wbgt.compute(method='liljegren')
+            self.assertEqual(lazy['Twbg'].dtype, lazy['Twbg'].compute().dtype)
+            numpy.testing.assert_array_equal(lazy['Twbg'].values, res['Twbg'].values)
+
+    @unittest.skipIf(accessors.xarray is None, 'xarray not installed')
+    def test_array_kwargs(self):
+
+        xarray  = accessors.xarray
+        dataset = self.dataset()
+        shape   = (self.lats.size, self.lons.size)
+        urban   = xarray.DataArray(
+            numpy.arange(self.lats.size * self.lons.size).reshape(shape) % 2,
+            dims = ('latitude', 'longitude'),
+        )
+        zspeed  = xarray.DataArray(
+            numpy.linspace(2.0, 10.0, self.lons.size),
+            dims  = ('longitude',),
+            attrs = {'units' : 'meter'},
+        )
+        full = lambda arr: numpy.broadcast_to(
+            arr.values, (self.times.size,) + shape,
+        ).ravel()
+
+        ref = self.reference(
+            'liljegren',
+            urban  = full(urban).astype(numpy.int32),
+            zspeed = units.Quantity(full(zspeed).astype(numpy.float32), 'meter'),
+            gmt    = -5,
+        )
+        for data in (dataset, dataset.chunk({'latitude' : 1}) if dask else dataset):
+            res = data.wbgt.compute(
+                method='liljegren', urban=urban, zspeed=zspeed, gmt=-5,
+            )
+            numpy.testing.assert_allclose(
+                res['Twbg'].values.ravel(), ref['Twbg'].magnitude, rtol=1e-6,
+            )
+            numpy.testing.assert_allclose(
+                res['speed'].values.ravel(), ref['speed'].magnitude, rtol=1e-6,
+            )
+
+        # Outputs keep the precision of the method
+        res = dataset.wbgt.compute(method='bernard')
+        self.assertEqual(res['Twbg'].dtype, numpy.float64)
+        numpy.testing.assert_allclose(
+            res['Twbg'].values.ravel(), self.reference('bernard')['Twbg'].magnitude,
+            rtol=1e-6,
+        )
+
+    def test_dataframe(self):
+
+        frame = pandas.DataFrame(
+            {
+                'temp'  : [25.0, 30.0],
+                'dewpt' : [15.0, 20.0],
+                'wspd'  : [2.0, 4.0],
+                'sp'    : [1000.0, 1010.0],
+                'ssrd'  : [400.0, 800.0],
+            },
+            index = self.times[:2],
+        )
+        frame.attrs['units'] = {
+            'temp'  : 'degC', 'dewpt' : 'degC', 'wspd' : 'm/s',
+            'sp'    : 'hPa',  'ssrd'  : 'watt/meter**2',
+        }
+
+        res = frame.wbgt.compute(
+            method  = 'dimiceli',
+            mapping = {'temp_air' : 'temp', 'temp_dew' : 'dewpt'},
+            lat     = 35.0,
+            lon     = -80.0,
+        )
+        ref = wbgt(
+            'dimiceli',
+            self.times[:2], numpy.full(2, 35.0), numpy.full(2, -80.0),
+            units.Quantity(frame['ssrd'].to_numpy(), 'watt/meter**2'),
+            units.Quantity(frame['sp'].to_numpy(), 'hPa'),
+            units.Quantity(frame['temp'].to_numpy(), 'degC'),
+            units.Quantity(frame['dewpt'].to_numpy(), 'degC'),
+            units.Quantity(frame['wspd'].to_numpy(), 'm/s'),
+        )
+
+        self.assertTrue(res.index.equals(frame.index))
+        numpy.testing.assert_array_equal(frame['ssrd'].to_numpy(), [400.0, 800.0])
+        numpy.testing.assert_allclose(res['Twbg'], ref['Twbg'].magnitude)
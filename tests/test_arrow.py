@@ -0,0 +1,88 @@
+import unittest
+
+import pandas
+import numpy
+from metpy.units import units
+
+from pywbgt import wbgt
+from pywbgt import arrow
+
+@unittest.skipIf(arrow.pyarrow is None, 'pyarrow not installed')
+class TestArrow(unittest.TestCase):
+
+    def setUp(self):
+
+        self.dates = pandas.date_range('20000601T12', periods=4, freq='h')
+        self.lats  = numpy.full(4, 35.0)
+        self.lons  = numpy.full(4, -80.0)
+        self.solar = numpy.array([500.0, 600.0, 700.0, 800.0])
+        self.pres  = numpy.array([1000.0, 1005.0, 1010.0, 1015.0])
+        self.Tair  = numpy.array([25.0, 27.0, 29.0, 31.0])
+        self.Tdew  = numpy.array([15.0, 16.0, 17.0, 18.0])
+        self.speed = numpy.array([1.0, 2.0, 3.0, 4.0])
+
+    def test_zero_copy(self):
+
+        pa     = arrow.pyarrow
+        col    = pa.array(self.Tair)
+        values, valid = arrow.from_arrow(col)
+        self.assertIsNone(valid)
+        self.assertEqual(
+            values.__array_interface__['data'][0], col.buffers()[1].address,
+        )
+
+        out = arrow.to_arrow(values)
+        self.assertEqual(out.buffers()[1].address, col.buffers()[1].address)
+
+    def test_wbgt_arrow(self):
+
+        pa  = arrow.pyarrow
+        ref = wbgt(
+            'liljegren', self.dates, self.lats, self.lons,
+            units.Quantity(self.solar, 'watt/meter**2'),
+            units.Quantity(self.pres, 'hPa'),
+            units.Quantity(self.Tair, 'degC'),
+            units.Quantity(self.Tdew, 'degC'),
+            units.Quantity(self.speed, 'm/s'),
+        )
+
+        temp_air = pa.array([25.0, None, 29.0, 31.0])
+        res = arrow.wbgt_arrow(
+            'liljegren',
+            pa.array(self.dates.values),
+            self.lats,
+            self.lons,
+            pa.array(self.solar),
+            pa.array(self.pres),
+            temp_air,
+            pa.chunked_array([self.Tdew[:2], self.Tdew[2:]]),
+            pa.array(self.speed),
+        )
+
+        self.assertEqual(res['Twbg'].null_count, 1)
+        self.assertFalse(res['Twbg'][1].is_valid)
+        numpy.testing.assert_equal(
+            res['Twbg'].to_numpy(zero_copy_only=False)[[0, 2, 3]],
+            ref['Twbg'].magnitude[[0, 2, 3]],
+        )
+
+    def test_read_only(self):
+
+        # Arrow buffers are immutable; inputs must be left as they were
+        pa    = arrow.pyarrow
+        solar = pa.array(self.solar)
+        res   = arrow.wbgt_arrow(
+            'liljegren',
+            pa.array(self.dates.values),
+            self.lats,
+            self.lons,
+            solar,
+            pa.array(self.pres),
+            pa.array(self.Tair),
+            pa.array(self.Tdew),
+            pa.array(self.speed),
+        )
+        values, _ = arrow.from_arrow(solar)
+        self.assertFalse(values.flags.writeable)
+        numpy.testing.assert_array_equal(values, self.solar)
+        self.assertEqual(res['Twbg'].null_count, 0)
@@ -0,0 +1,128 @@
+import os
+import unittest
+import tempfile
+
+import pandas
+import numpy
+from metpy.units import units
+
+from pywbgt import wbgt, wbgt_chunked
+from pywbgt.batch import load_chunks
+from pywbgt.checkpoint import Checkpoint
+from pywbgt.reductions import DailyMax, Histogram
+
+class TestChunked(unittest.TestCase):
+
+    def setUp(self):
+
+        size = 96
+        self.dates = pandas.date_range('20000601', periods=size, freq='h')
+        self.lats  = numpy.full(size, 35.0)
+        self.lons  = numpy.full(size, -80.0)
+        hour       = numpy.arange(size) % 24
+        self.solar = units.Quantity(
+            numpy.clip(900.0*numpy.sin(numpy.pi*(hour-6)/12.0), 0, None),
+            'watt/meter**2',
+        )
+        self.pres  = units.Quantity(numpy.full(size, 1000.0), 'hPa')
+        self.Tair  = units.Quantity(25.0 + 5.0*numpy.sin(numpy.pi*hour/12.0), 'degC')
+        self.Tdew  = units.Quantity(self.Tair.magnitude - 8.0, 'degC')
+        self.speed = units.Quantity(numpy.full(size, 3.0), 'm/s')
+
+        self.args  = (
+            self.dates, self.lats, self.lons,
+            self.solar, self.pres, self.Tair, self.Tdew, self.speed,
+        )
+
+    def test_matches_wbgt(self):
+
+        ref = wbgt('dimiceli', *self.args)
+        res = wbgt_chunked('dimiceli', *self.args, chunk_size=25)
+
+        self.assertTrue(res['complete'])
+        numpy.testing.assert_equal(
+            res['Twbg'].magnitude, ref['Twbg'].magnitude,
+        )
+
+    def test_resume(self):
+
+        ref = wbgt_chunked(
+            'dimiceli', *self.args,
+            chunk_size = 10,
+            reductions = {'dmax' : DailyMax(), 'hist' : Histogram()},
+        )
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            ckpt   = os.path.join(tmpdir, 'job.ckpt.npz')
+            outdir = os.path.join(tmpdir, 'out')
+
+            # Simulate job being pre-empted after three (3) chunks
+            kwargs = dict(chunk_size=10, outdir=outdir, checkpoint=ckpt)
+            res = wbgt_chunked(
+                'dimiceli', *self.args,
+                reductions = {'dmax' : DailyMax(), 'hist' : Histogram()},
+                max_chunks = 3,
+                **kwargs,
+            )
+            self.assertFalse(res['complete'])
+            self.assertEqual(len(res['files']), 3)
+
+            res = wbgt_chunked(
+                'dimiceli', *self.args,
+                reductions = {'dmax' : DailyMax(), 'hist' : Histogram()},
+                **kwargs,
+            )
+            self.assertTrue(res['complete'])
+
+            numpy.testing.assert_equal(
+                res['reductions']['dmax']['Twbg'],
+                ref['reductions']['dmax']['Twbg'],
+            )
+            numpy.testing.assert_equal(
+                res['reductions']['hist']['counts'],
+                ref['reductions']['hist']['counts'],
+            )
+            numpy.testing.assert_equal(
+                load_chunks(outdir)['Twbg'].magnitude,
+                ref['Twbg'].magnitude,
+            )
+
+            # Completed days are written once, not with every chunk
+            saved = Checkpoint(ckpt)
+            self.assertEqual(saved.segments['dmax'], 3)
+            self.assertEqual(numpy.unique(saved.states['dmax']['day']).size, 1)
+
+            # Checkpoint must not be reused for a different job
+            with self.assertRaises(Exception):
+                wbgt_chunked('dimiceli', *self.args, chunk_size=20, checkpoint=ckpt)
+
+    def test_flush(self):
+
+        ref = wbgt('dimiceli', *self.args)
+        chunks = [slice(start, start+10) for start in range(0, self.dates.size, 10)]
+
+        def update(red, index):
+            red.update(
+                self.dates[index], self.lats[index], self.lons[index],
+                {'Twbg' : ref['Twbg'][index]},
+            )
+
+        expected = DailyMax()
+        update(expected, slice(None))
+
+        # Chunks in time order, then one out of order that opens a
+        # flushed day again
+        red     = DailyMax()
+        flushed = []
+        for index in chunks + chunks[:1]:
+            update(red, index)
+            flushed.append(red.flush())
+            restored = DailyMax()
+            restored.load(red.state(flushed=False), flushed)
+            for key, val in red.result().items():
+                numpy.testing.assert_equal(restored.result()[key], val)
+
+        self.assertEqual(sum(part['day'].size > 0 for part in flushed), 3)
+        self.assertEqual(flushed[-1]['day'].size, 0)
+        for key, val in expected.result().items():
+            numpy.testing.assert_equal(red.result()[key], val)
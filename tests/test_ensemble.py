@@ -0,0 +1,83 @@
+import unittest
+
+import numpy
+from metpy.units import units
+
+from pywbgt import synthetic, wbgt
+from pywbgt.ensemble import wbgt_ensemble
+
+class TestEnsemble(unittest.TestCase):
+
+    def setUp(self):
+
+        # Members are consecutive blocks of the same stations
+        npoint       = 192
+        self.nmember = 5
+        met          = synthetic.stations(self.nmember * npoint, seed=6, missing=0.0)
+        self.dates   = met['datetime'][:npoint]
+        self.lat     = met['lat'][:npoint]
+        self.lon     = met['lon'][:npoint]
+        self.met     = {
+            key : met[key][:npoint] if key == 'solar' else met[key].reshape(self.nmember, npoint)
+            for key in synthetic.UNITS
+        }
+
+    def reference(self, method, member, **kwargs):
+
+        met = {
+            key : val if val.ndim == 1 else val[member]
+            for key, val in self.met.items()
+        }
+        return wbgt(method, self.dates, self.lat, self.lon, *met.values(), **kwargs)
+
+    def test_members(self):
+
+        for method in ('liljegren', 'dimiceli'):
+            res = wbgt_ensemble(
+                method, self.dates, self.lat, self.lon, *self.met.values(), gmt=-5.0,
+            )
+            self.assertEqual(res['Twbg'].shape, (self.nmember, self.dates.size))
+            for member in range(self.nmember):
+                ref = self.reference(method, member, gmt=-5.0)
+                for var in ('Tg', 'Tnwb', 'Twbg'):
+                    numpy.testing.assert_allclose(
+                        res[var][member].magnitude,
+                        ref[var].to(res[var].units).magnitude,
+                        rtol    = 1.0e-5,
+                        err_msg = f'{method} {var} {member}',
+                    )
+
+    def test_invariant(self):
+
+        # Inputs shared by all members are broadcast as read-only views
+        met = {key : val if val.ndim == 1 else val[0] for key, val in self.met.items()}
+        ref = wbgt('bernard', self.dates, self.lat, self.lon, *met.values())
+        res = wbgt_ensemble('bernard', self.dates, self.lat, self.lon, *met.values())
+        self.assertEqual(res['Twbg'].shape, (1, self.dates.size))
+        numpy.testing.assert_allclose(
+            res['Twbg'][0].magnitude, ref['Twbg'].to(res['Twbg'].units).magnitude, rtol=1.0e-5,
+        )
+
+    def test_statistics(self):
+
+        thres = units.Quantity([25.0, 30.0], 'degC')
+        full  = wbgt_ensemble('liljegren', self.dates, self.lat, self.lon, *self.met.values())
+        res   = wbgt_ensemble(
+            'liljegren', self.dates, self.lat, self.lon, *self.met.values(),
+            members    = False,
+            statistics = ['mean', 'spread'],
+            thresholds = {'Twbg' : thres},
+        )
+        self.assertNotIn('Twbg', res)
+
+        twbg = full['Twbg'].magnitude
+        numpy.testing.assert_allclose(res['mean']['Twbg'].magnitude,   numpy.nanmean(twbg, axis=0))
+        numpy.testing.assert_allclose(res['spread']['Twbg'].magnitude, numpy.nanstd(twbg, axis=0))
+        self.assertEqual(res['exceedance']['Twbg'].shape, (2, self.dates.size))
+        numpy.testing.assert_allclose(
+            res['exceedance']['Twbg'][1],
+            numpy.mean(twbg > 30.0, axis=0),
+        )
+
+if __name__ == "__main__":
+    unittest.main()
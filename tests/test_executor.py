@@ -0,0 +1,65 @@
+import unittest
+
+import numpy
+
+from pywbgt import synthetic, wbgt
+from pywbgt.executor import SharedArrays, SharedMemoryExecutor
+
+class TestSharedArrays(unittest.TestCase):
+
+    def test_attach(self):
+
+        arrays = {
+            'a' : numpy.arange(10, dtype=numpy.float64),
+            'b' : numpy.arange(3, dtype=numpy.int64),
+        }
+        owner = SharedArrays(arrays)
+        try:
+            other = SharedArrays(name=owner.name, spec=owner.spec)
+            view  = other['b']
+            view[1] = 7
+            numpy.testing.assert_array_equal(owner['a'], arrays['a'])
+            self.assertEqual(owner['b'][1], 7)
+            del view
+            other.close()
+        finally:
+            owner.close(unlink=True)
+
+class TestExecutor(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+
+        cls.executor = SharedMemoryExecutor(max_workers=2)
+
+    @classmethod
+    def tearDownClass(cls):
+
+        cls.executor.shutdown()
+
+    def setUp(self):
+
+        self.args = synthetic.args(synthetic.stations(500, seed=4, missing=0.0))
+
+    def check(self, method, **kwargs):
+
+        ref = wbgt(method, *self.args, **kwargs)
+        res = self.executor.wbgt(method, *self.args, ntasks=3, **kwargs)
+        for var in ('Tg', 'Tpsy', 'Tnwb', 'Twbg', 'solar', 'speed'):
+            numpy.testing.assert_allclose(
+                res[var].magnitude,
+                ref[var].to(res[var].units).magnitude,
+                rtol = 1.0e-10,
+                err_msg = f'{method} {var}',
+            )
+
+    def test_dimiceli(self):
+
+        self.check('dimiceli', gmt=-5.0)
+
+    def test_bernard(self):
+
+        self.check('bernard')
+
+if __name__ == "__main__":
+    unittest.main()
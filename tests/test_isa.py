@@ -0,0 +1,56 @@
+import unittest
+
+import numpy
+
+from pywbgt import bernard, isa, liljegren, psychrometric_wetbulb, synthetic, wbgt
+
+class TestISA(unittest.TestCase):
+
+    def setUp(self):
+
+        self.previous = isa.get_isa()
+
+    def tearDown(self):
+
+        isa.set_isa(self.previous)
+
+    def test_select(self):
+
+        supported = isa.isa_supported()
+        self.assertEqual(supported[0], 'baseline')
+        self.assertEqual(isa.get_isa(), supported[-1])
+
+        self.assertEqual(isa.set_isa('baseline'), supported[-1])
+        self.assertEqual(isa.get_isa(), 'baseline')
+        with self.assertRaises(Exception):
+            isa.set_isa('sse9')
+        for name in isa.ISA_LEVELS:
+            if name not in supported:
+                with self.assertRaises(Exception):
+                    isa.set_isa(name)
+
+    def test_all_kernels(self):
+
+        for name in isa.isa_supported():
+            isa.set_isa(name)
+            level = isa.ISA_LEVELS.index(name)
+            for kernel in (liljegren, bernard, psychrometric_wetbulb):
+                self.assertEqual(kernel._isa_level(), level)
+
+    def test_results(self):
+
+        args = synthetic.args(synthetic.stations(5000, seed=2, missing=0.0))
+        isa.set_isa('baseline')
+        ref = {method : wbgt(method, *args) for method in ('liljegren', 'bernard')}
+        for name in isa.isa_supported():
+            isa.set_isa(name)
+            for method, out in ref.items():
+                res = wbgt(method, *args)
+                # FMA contraction may change results within solver convergence
+                for key in ('Tg', 'Tnwb', 'Twbg'):
+                    numpy.testing.assert_allclose(
+                        res[key].magnitude, out[key].magnitude, atol=0.02, equal_nan=True,
+                    )
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,63 @@
+import unittest
+
+import pandas
+import numpy
+from metpy.units import units
+
+from pywbgt import wbgt, lazy, synthetic
+
+@unittest.skipIf(lazy.da is None, 'dask not installed')
+class TestLazy(unittest.TestCase):
+
+    def setUp(self):
+
+        self.times = pandas.date_range('20000601', periods=12, freq='2h')
+        self.lats  = numpy.array([25.0, 30.0, 35.0, 40.0])
+        self.lons  = numpy.array([-100.0, -90.0, -80.0])
+        met        = synthetic.grid(
+            self.times.size, self.lats, self.lons,
+            start=self.times[0], freq=self.times.freq, seed=3, missing=0.0,
+        )
+        self.met   = {key : met[key] for key in synthetic.UNITS}
+
+    def reference(self, method):
+
+        time, lat, lon = numpy.meshgrid(
+            self.times.values, self.lats, self.lons, indexing='ij',
+        )
+        return wbgt(
+            method,
+            pandas.DatetimeIndex(time.ravel()), lat.ravel(), lon.ravel(),
+            *(val.ravel() for val in self.met.values()),
+        )
+
+    def test_matches_wbgt(self):
+
+        da  = lazy.da
+        met = {
+            var : units.Quantity(da.from_array(val.magnitude, chunks=(6, 2, 3)), val.units)
+            for var, val in self.met.items()
+        }
+        for method in ('liljegren', 'bernard', 'dimiceli'):
+            with self.subTest(method=method):
+                lazy.GEOCENTRIC_CACHE.clear()
+                res = lazy.wbgt_dask(
+                    method, self.times, self.lats[:, None], self.lons[None, :],
+                    *met.values(),
+                    threads = 1,
+                )
+                self.assertIsInstance(res['Twbg'].magnitude, da.Array)
+
+                ref = self.reference(method)
+                numpy.testing.assert_allclose(
+                    res['Twbg'].magnitude.compute(scheduler='threads').ravel(),
+                    ref['Twbg'].to('degC').magnitude,
+                    rtol = 1.0e-5,
+                    atol = 1.0e-4,
+                )
+
+                # One (1) geocentric solution per time chunk
+                self.assertEqual(len(lazy.GEOCENTRIC_CACHE), 2)
+
+if __name__ == "__main__":
+    unittest.main()
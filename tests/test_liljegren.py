@@ -5,7 +5,8 @@ import pandas
 import numpy
 from metpy.units import units
 
-from pywbgt.liljegren import wetbulb_globe
+from pywbgt import synthetic
+from pywbgt.liljegren import wetbulb_globe, wetbulb_globe_scalar
 from pywbgt.solar import solar_parameters
 
 def degMinSec2Frac( degree, minute, second ):
@@ -97,3 +98,79 @@ class TestWBGT( unittest.TestCase ):
     #Twbg = numpy.asarray([27.21748, 33.58417], dtype=numpy.float32) 
     Twbg = numpy.asarray([27.218622, 33.58471], dtype=numpy.float32) 
     numpy.testing.assert_almost_equal(Twbg, self.res['Twbg'].magnitude)
+
+class TestNightWind( unittest.TestCase ):
+  """Night points with wind measured above 2 m use the night stability classes"""
+
+  def setUp( self ):
+
+    n = 3
+    self.res = wetbulb_globe(
+      pandas.to_datetime( ['2000-06-01T08:00:00'] ).repeat( n ),
+      numpy.full( n, 33.7 ),
+      numpy.full( n, -84.4 ),
+      units.Quantity( [   0.0,    0.0,    0.0], 'watt/meter**2'),
+      units.Quantity( [1000.0, 1000.0, 1000.0], 'hPa'),
+      units.Quantity( [  20.0,   25.0,   15.0], 'degree_Celsius'),
+      units.Quantity( [  10.0,   18.0,    5.0], 'degree_Celsius'),
+      units.Quantity( [   1.0,    2.2,    4.0], 'meter/second'),
+      avg = 1.0,
+      zspeed = units.Quantity( 10.0, 'meters' ),
+      dT = units.Quantity( [-1.0, 0.5, -1.0], 'degree_Celsius'),
+      min_speed = units.Quantity(0.13, 'm/s'),
+    )
+
+  # Reference values from calc_wbgt() of the C code
+  def test_speed(self):
+
+    speed = numpy.asarray([0.569325, 0.907798, 3.142060], dtype=numpy.float32)
+    numpy.testing.assert_almost_equal(speed, self.res['speed'].magnitude, decimal=5)
+
+  def test_Tg(self):
+
+    Tg = numpy.asarray([18.007776, 23.838709, 13.772272], dtype=numpy.float32)
+    numpy.testing.assert_almost_equal(Tg, self.res['Tg'].magnitude, decimal=2)
+
+  def test_Tnwb(self):
+
+    Tnwb = numpy.asarray([13.913141, 20.139582, 9.584894], dtype=numpy.float32)
+    numpy.testing.assert_almost_equal(Tnwb, self.res['Tnwb'].magnitude, decimal=2)
+
+  def test_Twbg(self):
+
+    Twbg = numpy.asarray([15.340755, 21.365448, 10.963881], dtype=numpy.float32)
+    numpy.testing.assert_almost_equal(Twbg, self.res['Twbg'].magnitude, decimal=2)
+
+class TestScalar( unittest.TestCase ):
+  """wetbulb_globe_scalar() gives the results of wetbulb_globe()"""
+
+  def test_agree(self):
+
+    met = synthetic.stations( 500, seed=4, missing=0.0 )
+    solar, cosz, f_db = solar_parameters(
+      met['datetime'], met['lat'], met['lon'], met['solar'].to('watt/m**2').magnitude,
+    )
+    ref = wetbulb_globe(
+      met['datetime'], met['lat'], met['lon'],
+      units.Quantity( solar, 'watt/meter**2' ),
+      met['pres'], met['temp_air'], met['temp_dew'], met['speed'],
+      f_db = f_db,
+      cosz = cosz,
+    )
+
+    args = zip(
+      met['temp_air'].to('degC').magnitude,
+      met['temp_dew'].to('degC').magnitude,
+      met['pres'].to('hPa').magnitude,
+      met['speed'].to('m/s').magnitude,
+      solar, f_db, cosz,
+    )
+    res = numpy.asarray( [wetbulb_globe_scalar( *arg )[:4] for arg in args] ).T
+
+    # Relative humidity of the scalar kernel is from the Bolton (1980)
+    # formula, which differs from that of metpy 1.6 and later by up to
+    # 0.05 degC of wet bulb temperature
+    for i, var in enumerate( ('Tg', 'Tpsy', 'Tnwb', 'Twbg') ):
+      numpy.testing.assert_allclose(
+        res[i], ref[var].to('degC').magnitude, atol=0.05, err_msg=var,
+      )
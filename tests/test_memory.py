@@ -0,0 +1,82 @@
+import os
+import tempfile
+import unittest
+from unittest import mock
+
+import numpy
+
+from pywbgt import memory, wbgt, wbgt_chunked
+from pywbgt.batch import load_chunks
+
+class TestMemory(unittest.TestCase):
+
+    def setUp(self):
+
+        self.size = 20000
+        self.args = memory._sample_inputs(self.size)
+
+    def test_footprint(self):
+
+        nbytes = memory.footprint('liljegren')
+        # At least the float32 output, well below a thousand arrays
+        self.assertGreater(nbytes, 6*4)
+        self.assertLess(nbytes, 1000*8)
+        self.assertIs(memory.footprint('liljegren'), nbytes)
+
+        budget = 2**20
+        self.assertEqual(
+            memory.plan_chunk_size('liljegren', budget), int(budget // nbytes),
+        )
+        with self.assertRaises(Exception):
+            memory.plan_chunk_size('liljegren', 1)
+
+    def test_budget(self):
+
+        budget = 2**19
+        ref    = wbgt('liljegren', *self.args)
+        res    = memory.wbgt_budget('liljegren', *self.args, budget=budget)
+        for key, val in res.items():
+            numpy.testing.assert_allclose(
+                val.magnitude, ref[key].to(val.units).magnitude, equal_nan=True,
+            )
+
+        mark = memory.high_water()
+        self.assertGreater(mark.chunks, 1)
+        self.assertEqual(mark.chunk_size, memory.plan_chunk_size('liljegren', budget))
+        # Peak is one chunk plus the output accumulated so far
+        self.assertLess(mark.peak, 2*budget + 6*8*self.size)
+
+    def test_chunked(self):
+
+        ref = wbgt('liljegren', *self.args)
+        res = wbgt_chunked('liljegren', *self.args, memory_budget=2**19)
+        numpy.testing.assert_allclose(
+            res['Twbg'].magnitude, ref['Twbg'].magnitude, equal_nan=True,
+        )
+
+    def test_chunked_resume(self):
+
+        budget = 2**19
+        ref    = wbgt('liljegren', *self.args)
+        with tempfile.TemporaryDirectory() as tmpdir:
+            kwargs = dict(
+                memory_budget = budget,
+                outdir        = os.path.join(tmpdir, 'out'),
+                checkpoint    = os.path.join(tmpdir, 'job.ckpt.npz'),
+            )
+            res = wbgt_chunked('liljegren', *self.args, max_chunks=1, **kwargs)
+            self.assertFalse(res['complete'])
+
+            # A resumed job must not re-plan, e.g., after the footprint changes
+            planned = memory.plan_chunk_size('liljegren', budget)
+            with mock.patch.object(memory, 'plan_chunk_size', return_value=planned//2):
+                res = wbgt_chunked('liljegren', *self.args, **kwargs)
+            self.assertTrue(res['complete'])
+            self.assertEqual(len(res['files']), -(-self.size // planned))
+            numpy.testing.assert_allclose(
+                load_chunks(kwargs['outdir'])['Twbg'].magnitude,
+                ref['Twbg'].magnitude, equal_nan=True,
+            )
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,87 @@
+import unittest
+
+import numpy
+
+from pywbgt import metrics, synthetic, wbgt
+from pywbgt.ensemble import wbgt_ensemble
+from pywbgt.scheduler import wbgt_tasks
+
+class TestMetrics(unittest.TestCase):
+
+    def setUp(self):
+
+        self.previous = metrics.enable()
+        metrics.reset()
+
+        met = synthetic.stations(4000, seed=7, missing=0.0)
+        met['solar']    = met['solar'] * 3.0
+        met['temp_air'] = met['temp_air'].copy()
+        met['temp_air'][:25] = numpy.nan
+        self.args = synthetic.args(met)
+
+    def tearDown(self):
+
+        if not self.previous:
+            metrics.disable()
+        metrics.reset()
+
+    def test_counts(self):
+
+        res = wbgt('liljegren', *self.args)
+        wbgt('bernard', *self.args)
+        wbgt('dimiceli', *self.args)
+        counts = metrics.snapshot()
+
+        lil = counts['liljegren']
+        self.assertEqual(lil['points'], 4000)
+        self.assertEqual(lil['missing'], 25)
+        self.assertEqual(
+            lil['missing'] + lil['tglobe_failed'] + lil['twb_failed'],
+            numpy.isnan(res['Twbg'].magnitude).sum(),
+        )
+        self.assertGreater(lil['speed_clipped'], 0)
+        self.assertGreater(lil['normsolar_clipped'], 0)
+
+        self.assertEqual(counts['bernard']['points'], 4000)
+        self.assertEqual(counts['bernard']['missing'], 25)
+        for method in ('bernard', 'dimiceli'):
+            self.assertEqual(counts[method]['normsolar_clipped'], lil['normsolar_clipped'])
+
+        # Totals accumulate over calls
+        wbgt('liljegren', *self.args)
+        self.assertEqual(metrics.snapshot(clear=True)['liljegren']['points'], 8000)
+        self.assertEqual(metrics.snapshot(), {})
+
+    def test_engines(self):
+
+        wbgt('liljegren', *self.args)
+        clipped = metrics.snapshot(clear=True)['liljegren']['normsolar_clipped']
+        self.assertGreater(clipped, 0)
+
+        # Engines adjust solar before calling the methods, so they count it
+        wbgt_tasks(['liljegren', 'bernard'], *self.args, chunk_size=1000, nworkers=2)
+        counts = metrics.snapshot(clear=True)
+        for method in ('liljegren', 'bernard'):
+            self.assertEqual(counts[method]['normsolar_clipped'], clipped, method)
+
+        wbgt_ensemble('bernard', *self.args)
+        counts = metrics.snapshot(clear=True)
+        self.assertEqual(counts['bernard']['normsolar_clipped'], clipped)
+        self.assertNotIn('liljegren', counts)
+
+    def test_disabled(self):
+
+        metrics.disable()
+        wbgt('liljegren', *self.args)
+        self.assertEqual(metrics.snapshot(), {})
+
+    def test_prometheus(self):
+
+        wbgt('bernard', *self.args)
+        text = metrics.to_prometheus()
+        self.assertIn('# TYPE pywbgt_points_total counter', text)
+        self.assertIn('pywbgt_missing_total{method="bernard"} 25\n', text)
+        self.assertEqual(text.count('pywbgt_'), 3*len(metrics.COUNTERS))
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,95 @@
+import os
+import unittest
+import tempfile
+
+import pandas
+import numpy
+
+from pywbgt import accessors
+from pywbgt.mpi import SerialComm, split_bounds, wbgt_mpi, load_ranks
+from pywbgt.reductions import DailyMax, ZoneStats
+
+def as_float(arr):
+
+    if arr.dtype.kind == 'M':
+        arr = arr.astype(numpy.int64)
+    return arr.astype(numpy.float64)
+
+class FakeComm(SerialComm):
+    """One rank of a multi-rank job, run sequentially"""
+
+    def __init__(self, rank, size):
+        self.rank = rank
+        self.size = size
+
+@unittest.skipIf(accessors.xarray is None, 'xarray not installed')
+class TestMPI(unittest.TestCase):
+
+    def setUp(self):
+
+        times = pandas.date_range('20000601', periods=30, freq='h')
+        lats  = numpy.array([30.0, 35.0, 40.0])
+        lons  = numpy.array([-90.0, -85.0])
+        shape = (times.size, lats.size, lons.size)
+        rng   = numpy.random.default_rng(2)
+        dims  = ('time', 'lat', 'lon')
+        self.dataset = accessors.xarray.Dataset(
+            {
+                'ssrd' : (dims, rng.uniform(0, 900, shape),       {'units' : 'watt/meter**2'}),
+                'sp'   : (dims, rng.uniform(980, 1020, shape),    {'units' : 'hPa'}),
+                't2m'  : (dims, rng.uniform(20, 35, shape),       {'units' : 'degC'}),
+                'd2m'  : (dims, rng.uniform(10, 19, shape),       {'units' : 'degC'}),
+                'si10' : (dims, rng.uniform(1, 6, shape),         {'units' : 'm/s'}),
+            },
+            coords = {'time' : times, 'lat' : lats, 'lon' : lons},
+        )
+        self.zones = numpy.array([[0, 1], [0, 1], [2, -1]])
+
+    def reductions(self):
+
+        return {
+            'dmax'  : DailyMax(),
+            'zones' : ZoneStats(
+                self.dataset.lat.values, self.dataset.lon.values, self.zones,
+            ),
+        }
+
+    def test_split_bounds(self):
+
+        bounds = [split_bounds(10, 4, part) for part in range(4)]
+        self.assertEqual(bounds, [(0, 3), (3, 6), (6, 8), (8, 10)])
+
+    def test_decomposed(self):
+
+        ref = wbgt_mpi('dimiceli', self.dataset, reductions=self.reductions())
+
+        for axis in ('time', 'lat'):
+            with self.subTest(axis=axis), tempfile.TemporaryDirectory() as tmpdir:
+                reds = []
+                for rank in range(4):
+                    reds.append(self.reductions())
+                    wbgt_mpi(
+                        'dimiceli', self.dataset,
+                        comm       = FakeComm(rank, 4),
+                        axis       = axis,
+                        outdir     = tmpdir,
+                        reductions = reds[-1],
+                    )
+
+                res = load_ranks(tmpdir)
+                numpy.testing.assert_allclose(
+                    res['Twbg'].magnitude, ref['Twbg'].magnitude,
+                )
+
+                # Merge as rank zero (0) would after gather
+                for other in reds[1:]:
+                    for name, red in reds[0].items():
+                        red.merge(other[name])
+                for name, red in reds[0].items():
+                    for key, val in red.result().items():
+                        numpy.testing.assert_allclose(
+                            as_float(val), as_float(ref['reductions'][name][key]),
+                        )
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,49 @@
+import unittest
+
+import pandas
+import numpy
+from metpy.units import units
+
+from pywbgt.multires import coarsen, upsample, wbgt_multires
+
+class TestMultires(unittest.TestCase):
+
+    def setUp(self):
+
+        self.dates = pandas.date_range('20000601 12:00', periods=3, freq='3h')
+        self.lat   = numpy.linspace(30, 32, 24)
+        self.lon   = numpy.linspace(-85, -82, 30)
+        t, y, x    = numpy.meshgrid(
+            numpy.arange(3), numpy.arange(24), numpy.arange(30), indexing='ij',
+        )
+        wave = numpy.sin(y/7.0) * numpy.cos(x/9.0)
+        self.met = [
+            units.Quantity(600.0 + 200.0*wave - 50.0*t, 'watt/m**2'),
+            units.Quantity(1000.0 + 5.0*wave,           'hPa'),
+            units.Quantity(30.0 + 3.0*wave,             'degC'),
+            units.Quantity(18.0 + 2.0*wave,             'degC'),
+            units.Quantity(3.0 + wave,                  'm/s'),
+        ]
+
+    def test_upsample_linear(self):
+
+        y, x   = numpy.meshgrid(numpy.arange(16.0), numpy.arange(12.0), indexing='ij')
+        fine   = 2.0*y + 0.5*x
+        interp = upsample(coarsen(fine, 4), fine.shape, 4)
+        # Bilinear interpolation is exact for a plane, away from edges
+        numpy.testing.assert_allclose(interp[2:-2, 2:-2], fine[2:-2, 2:-2])
+
+    def test_warm_start(self):
+
+        cold = wbgt_multires(self.dates, self.lat, self.lon, *self.met, factor=1, iterations=True)
+        warm = wbgt_multires(self.dates, self.lat, self.lon, *self.met, factor=4, iterations=True)
+
+        self.assertEqual(warm['Twbg'].shape, self.met[0].shape)
+        self.assertLess(warm['iterations'].mean(), cold['iterations'].mean())
+        for var in ('Tg', 'Tnwb', 'Twbg'):
+            numpy.testing.assert_allclose(
+                warm[var].magnitude, cold[var].magnitude, atol=0.1, err_msg=var,
+            )
+
+if __name__ == "__main__":
+    unittest.main()
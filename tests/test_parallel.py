@@ -0,0 +1,65 @@
+import os
+import unittest
+
+import numba
+import numpy
+
+from pywbgt import parallel, set_num_threads, get_num_threads
+
+class TestParallel(unittest.TestCase):
+
+    def test_threading_layer(self):
+
+        if 'NUMBA_THREADING_LAYER' not in os.environ and parallel._omp_layer_available():
+            self.assertEqual(numba.config.THREADING_LAYER, 'omp')
+
+    def test_set_num_threads(self):
+
+        nthreads = parallel.max_threads()
+        previous = set_num_threads(1)
+        try:
+            self.assertEqual(get_num_threads(), 1)
+            self.assertEqual(numba.get_num_threads(), 1)
+            self.assertEqual(parallel.get_openmp_threads(), 1)
+            with parallel.num_threads(nthreads):
+                self.assertEqual(get_num_threads(), nthreads)
+            self.assertEqual(get_num_threads(), 1)
+            # Clipped to the size of the pool
+            set_num_threads(nthreads + 8)
+            self.assertEqual(get_num_threads(), nthreads)
+        finally:
+            set_num_threads(previous)
+
+    def test_first_touch_copy(self):
+
+        from pywbgt.liljegren import first_touch_copy
+
+        values = numpy.linspace(-5, 5, 1001)
+        for arr in (values, values.astype(numpy.float32), values[::2]):
+            out = first_touch_copy(arr)
+            self.assertEqual(out.dtype, numpy.float32)
+            numpy.testing.assert_array_equal(out, arr.astype(numpy.float32))
+
+    def test_thread_binding(self):
+
+        info = parallel.thread_binding()
+        self.assertGreaterEqual(info['numa_nodes'], 1)
+        if info['numa_nodes'] == 1:
+            self.assertEqual(info['recommended'], {})
+
+    @unittest.skipIf(parallel.threadpoolctl is None, 'threadpoolctl not installed')
+    def test_threadpoolctl(self):
+
+        from pywbgt.solar import sun_geocentric
+
+        # Start the numba threading layer so its library is loaded
+        sun_geocentric(numpy.zeros(4), 0.0)
+
+        tpc  = parallel.threadpoolctl
+        apis = {info['user_api'] for info in tpc.threadpool_info()}
+        self.assertIn('numba', apis)
+        with tpc.threadpool_limits(1):
+            self.assertEqual(get_num_threads(), 1)
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,83 @@
+import json
+import os
+import tempfile
+import unittest
+
+from pywbgt import profile, synthetic, wbgt
+from pywbgt import profiling
+
+class TestProfiling(unittest.TestCase):
+
+    def setUp(self):
+
+        self.args = synthetic.args(synthetic.stations(500, missing=0.0))
+
+    def test_disabled(self):
+
+        self.assertIs(profiling.stage('solar'), profiling._NULL_STAGE)
+
+    def test_stages(self):
+
+        with profile(memory=True) as prof:
+            for method in ('liljegren', 'bernard'):
+                wbgt(method, *self.args)
+        self.assertIsNone(profiling._active)
+
+        stages = prof.to_dict()
+        self.assertEqual(
+            set(stages['liljegren']),
+            {'wetbulb_globe', 'solar', 'datetime_adjust', 'solar_geometry',
+             'units', 'relhum', 'copy', 'solver'},
+        )
+        self.assertIn('Tg', stages['bernard'])
+        total = stages['liljegren']['wetbulb_globe']
+        self.assertEqual(total['calls'], 1)
+        self.assertEqual(total['elements'], 500)
+        self.assertGreater(total['bytes'], 0)
+        # Nested stages fit inside their method
+        inner = sum(
+            val['seconds'] for key, val in stages['liljegren'].items()
+            if key in ('solar', 'units', 'relhum', 'copy', 'solver')
+        )
+        self.assertLessEqual(inner, total['seconds'])
+
+    def test_chrome_trace(self):
+
+        with profile() as prof:
+            wbgt('dimiceli', *self.args)
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, 'trace.json')
+            prof.to_chrome_trace(path)
+            with open(path) as fid:
+                trace = json.load(fid)
+
+        events = trace['traceEvents']
+        self.assertEqual(len(events), len(prof.events))
+        self.assertTrue(all(event['ph'] == 'X' for event in events))
+        self.assertEqual({event['cat'] for event in events}, {'dimiceli'})
+        self.assertIsNone(events[0]['args']['bytes'])
+
+    def test_imbalance(self):
+
+        with profile(threads=True) as prof:
+            for method in ('liljegren', 'bernard'):
+                wbgt(method, *self.args)
+        self.assertFalse(profiling.threads_enabled())
+
+        regions = prof.imbalance()
+        for method, region in (('liljegren', 'solver'), ('bernard', 'Tg')):
+            total = regions[method][region]
+            self.assertEqual(total['calls'], 1)
+            self.assertEqual(sum(total['elements']), 500)
+            self.assertEqual(len(total['elements']), total['threads'])
+            self.assertGreater(sum(total['iterations']), 0)
+            self.assertGreaterEqual(total['imbalance']['elements'], 1.0)
+
+        # Counters are off unless asked for
+        with profile() as prof:
+            wbgt('liljegren', *self.args)
+        self.assertEqual(prof.imbalance(), {})
+
+if __name__ == "__main__":
+    unittest.main()
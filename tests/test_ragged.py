@@ -0,0 +1,78 @@
+import unittest
+
+import pandas
+import numpy
+from metpy.units import units
+
+from pywbgt import wbgt
+from pywbgt.ragged import ragged_offsets, wbgt_ragged
+
+class TestRagged(unittest.TestCase):
+
+    def setUp(self):
+
+        # Three (3) stations with very different record lengths
+        self.counts = [48, 5, 20]
+        size        = sum(self.counts)
+        self.ids    = numpy.repeat(['A', 'B', 'C'], self.counts)
+        self.dates  = pandas.DatetimeIndex(numpy.concatenate([
+            pandas.date_range('20000601', periods=count, freq='h').values
+            for count in self.counts
+        ]))
+        self.stations = {
+            'lat'    : numpy.array([35.0, 40.0, 25.0]),
+            'lon'    : numpy.array([-80.0, -105.0, -81.0]),
+            'urban'  : numpy.array([0, 1, 0]),
+            'zspeed' : units.Quantity([10.0, 2.0, 10.0], 'meter'),
+        }
+
+        hour       = self.dates.hour.values
+        self.solar = units.Quantity(
+            numpy.clip(900.0*numpy.sin(numpy.pi*(hour-6)/12.0), 0, None),
+            'watt/meter**2',
+        )
+        self.pres  = units.Quantity(numpy.full(size, 1000.0), 'hPa')
+        self.Tair  = units.Quantity(25.0 + 5.0*numpy.sin(numpy.pi*hour/12.0), 'degC')
+        self.Tdew  = units.Quantity(self.Tair.magnitude - 8.0, 'degC')
+        self.speed = units.Quantity(numpy.full(size, 3.0), 'm/s')
+
+    def test_offsets(self):
+
+        ids, offsets = ragged_offsets(self.ids)
+        self.assertEqual(ids.tolist(), ['A', 'B', 'C'])
+        self.assertEqual(offsets.tolist(), [0, 48, 53, 73])
+
+        with self.assertRaises(Exception):
+            ragged_offsets(['A', 'B', 'A'])
+
+    def test_matches_broadcast(self):
+
+        _, offsets = ragged_offsets(self.ids)
+        met = (self.solar, self.pres, self.Tair, self.Tdew, self.speed)
+
+        for method in ('liljegren', 'dimiceli'):
+            with self.subTest(method=method):
+                res = wbgt_ragged(
+                    method, self.dates, offsets, self.stations, *met,
+                )
+                for j, (start, stop) in enumerate(zip(offsets[:-1], offsets[1:])):
+                    zspeed = self.stations['zspeed']
+                    kwargs = {'zspeed' : units.Quantity(float(zspeed.magnitude[j]), zspeed.units)}
+                    if method == 'liljegren':
+                        kwargs['urban'] = self.stations['urban'][j:j+1]
+                    ref = wbgt(
+                        method,
+                        self.dates[start:stop],
+                        self.stations['lat'][j:j+1],
+                        self.stations['lon'][j:j+1],
+                        *(arg[start:stop] for arg in met),
+                        **kwargs,
+                    )
+                    numpy.testing.assert_allclose(
+                        res['Twbg'][start:stop].magnitude,
+                        ref['Twbg'].magnitude,
+                        rtol = 1.0e-6,
+                    )
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,62 @@
+import threading
+import unittest
+
+import numpy
+
+from pywbgt import synthetic, wbgt
+from pywbgt.scheduler import WorkStealingPool, wbgt_tasks
+
+class TestPool(unittest.TestCase):
+
+    def test_spawn(self):
+
+        seen = []
+        lock = threading.Lock()
+
+        def leaf(value):
+            with lock:
+                seen.append(value)
+
+        def parent(pool, value):
+            for i in range(4):
+                pool.spawn(leaf, value*10 + i)
+
+        with WorkStealingPool(3) as pool:
+            for value in range(20):
+                pool.submit(parent, pool, value)
+            pool.wait()
+            stats = pool.stats()
+
+        self.assertEqual(sorted(seen), sorted(v*10 + i for v in range(20) for i in range(4)))
+        self.assertEqual(sum(stats['executed']), 100)
+
+    def test_error(self):
+
+        def fail():
+            raise ValueError('task failed')
+
+        with WorkStealingPool(2) as pool:
+            pool.submit(fail)
+            with self.assertRaises(ValueError):
+                pool.wait()
+
+class TestTasks(unittest.TestCase):
+
+    def test_matches_wbgt(self):
+
+        args    = synthetic.args(synthetic.stations(1000, seed=5, missing=0.0))
+        methods = ['liljegren', 'bernard', 'dimiceli']
+        res = wbgt_tasks(methods, *args, chunk_size=128, nworkers=3, gmt=-5.0)
+
+        for method in methods:
+            ref = wbgt(method, *args, gmt=-5.0)
+            for var in ('Tg', 'Tnwb', 'Twbg'):
+                numpy.testing.assert_allclose(
+                    res[method][var].magnitude,
+                    ref[var].to(res[method][var].units).magnitude,
+                    rtol    = 1.0e-5,
+                    err_msg = f'{method} {var}',
+                )
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,172 @@
+import os
+import socket
+import unittest
+import tempfile
+from concurrent.futures import ThreadPoolExecutor
+from unittest import mock
+
+import pandas
+import numpy
+from metpy.units import units
+
+import pywbgt
+from pywbgt import wbgt
+from pywbgt.service import Metrics, WBGTService, request
+
+class TestService(unittest.TestCase):
+
+    def setUp(self):
+
+        dates = pandas.date_range('20000601', periods=24, freq='h')
+        hour  = dates.hour.values
+        self.requests = [
+            {
+                'method'   : 'liljegren',
+                'datetime' : [date.isoformat() for date in dates[i:i+4]],
+                'lat'      : 35.0,
+                'lon'      : -80.0,
+                'solar'    : numpy.clip(900.0*numpy.sin(numpy.pi*(hour[i:i+4]-6)/12.0), 0, None).tolist(),
+                'pres'     : 1000.0,
+                'temp_air' : (25.0 + hour[i:i+4]/4.0).tolist(),
+                'temp_dew' : 18.0,
+                'speed'    : 3.0,
+            }
+            for i in range(0, 24, 4)
+        ]
+
+    def reference(self, req):
+
+        size = len(req['datetime'])
+        res  = wbgt(
+            req['method'],
+            pandas.DatetimeIndex(req['datetime']),
+            numpy.full(size, req['lat']),
+            numpy.full(size, req['lon']),
+            units.Quantity(numpy.resize(req['solar'],    size), 'W/m**2'),
+            units.Quantity(numpy.resize(req['pres'],     size), 'hPa'),
+            units.Quantity(numpy.resize(req['temp_air'], size), 'degC'),
+            units.Quantity(numpy.resize(req['temp_dew'], size), 'degC'),
+            units.Quantity(numpy.resize(req['speed'],    size), 'm/s'),
+        )
+        return res['Twbg'].to('degC').magnitude
+
+    def check(self, **kwargs):
+
+        with ThreadPoolExecutor(len(self.requests)) as pool:
+            results = list(pool.map(lambda req: request(req, **kwargs), self.requests))
+
+        for req, res in zip(self.requests, results):
+            numpy.testing.assert_allclose(
+                numpy.array(res['Twbg'], dtype=float),
+                self.reference(req),
+                rtol = 1.0e-6,
+            )
+
+        metrics = request(**kwargs)
+        self.assertEqual(metrics['requests'], len(self.requests))
+        self.assertEqual(metrics['points'], 24)
+        self.assertLessEqual(metrics['batches'], len(self.requests))
+
+    def test_tcp(self):
+
+        service = WBGTService(port=0, max_wait=0.05).start()
+        try:
+            self.check(port=service.address[1])
+        finally:
+            service.shutdown()
+
+    def test_unix_socket(self):
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path    = os.path.join(tmpdir, 'wbgt.sock')
+            service = WBGTService(socket_path=path, max_wait=0.05).start()
+            try:
+                self.check(socket_path=path)
+                with self.assertRaises(Exception):
+                    request({'method' : 'unknown'}, socket_path=path)
+            finally:
+                service.shutdown()
+            self.assertFalse(os.path.exists(path))
+
+    def test_stale_socket(self):
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, 'wbgt.sock')
+
+            # Other files are not replaced
+            with open(path, 'w') as fid:
+                fid.write('data')
+            with self.assertRaises(Exception):
+                WBGTService(socket_path=path, warmup=False)
+            self.assertTrue(os.path.isfile(path))
+            os.remove(path)
+
+            # Nor is a socket something is listening on
+            live = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            live.bind(path)
+            live.listen()
+            try:
+                with self.assertRaises(Exception):
+                    WBGTService(socket_path=path, warmup=False)
+            finally:
+                live.close()
+
+            # The socket is left behind once closed, and then replaced
+            self.assertTrue(os.path.exists(path))
+            service = WBGTService(socket_path=path, max_wait=0.05, warmup=False).start()
+            try:
+                self.check(socket_path=path)
+            finally:
+                service.shutdown()
+
+    def test_error_latency(self):
+
+        metrics = Metrics()
+        metrics.batch(2, 8, 0.1)
+        metrics.latency(0.2)
+        metrics.latency(0.4)
+        metrics.latency(5.0, error=True)
+        metrics.latency(0.0, error=True)
+        out = metrics.snapshot()
+        self.assertEqual(out['errors'], 2)
+        self.assertAlmostEqual(out['latency_mean'], 0.3)
+        self.assertAlmostEqual(out['latency_max'], 0.4)
+
+    def test_bad_request(self):
+
+        def checked(method, datetime, lat, *args, **kwargs):
+            if numpy.any(numpy.abs(lat) > 90.0):
+                raise Exception('Latitude out of range!')
+            return wbgt(method, datetime, lat, *args, **kwargs)
+
+        service = WBGTService(port=0, max_wait=0.2).start()
+        port    = service.address[1]
+        try:
+            # Requests batched with a failing one still get their results
+            bad = {**self.requests[0], 'lat' : 95.0}
+            with mock.patch.object(pywbgt, 'wbgt', checked):
+                with ThreadPoolExecutor(len(self.requests)+1) as pool:
+                    futures = [
+                        pool.submit(request, req, port=port)
+                        for req in (bad, *self.requests)
+                    ]
+            with self.assertRaises(Exception):
+                futures[0].result()
+            for req, future in zip(self.requests, futures[1:]):
+                numpy.testing.assert_allclose(
+                    numpy.array(future.result()['Twbg'], dtype=float),
+                    self.reference(req),
+                    rtol = 1.0e-6,
+                )
+
+            # Invalid units are rejected before batching
+            with self.assertRaises(Exception):
+                request(
+                    {**self.requests[0], 'input_units' : {'speed' : 'degC'}},
+                    port = port,
+                )
+        finally:
+            service.shutdown()
+
+if __name__ == "__main__":
+    unittest.main()
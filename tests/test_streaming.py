@@ -0,0 +1,109 @@
+import unittest
+
+import pandas
+import numpy
+from metpy.units import units
+
+from pywbgt import wbgt
+from pywbgt.streaming import RollingMean, StreamingWBGT
+
+class TestRollingMean(unittest.TestCase):
+
+    def test_mean(self):
+
+        values  = numpy.random.default_rng(0).uniform(0, 100, 500)
+        values[5::37] = numpy.nan
+        rolling = RollingMean(15)
+        for i, value in enumerate(values):
+            rolling.push(value)
+            ref = numpy.nanmean(values[max(i-14, 0):i+1])
+            self.assertAlmostEqual(rolling.mean(), ref, places=9)
+
+class TestStreaming(unittest.TestCase):
+
+    def setUp(self):
+
+        size        = 180
+        self.window = 15
+        self.dates  = pandas.date_range('20000601 12:00', periods=size, freq='min')
+        minute      = numpy.arange(size)
+        self.data   = pandas.DataFrame(
+            {
+                'solar'    : 600.0 + 200.0*numpy.sin(minute/20.0),
+                'pres'     : numpy.full(size, 1000.0),
+                'temp_air' : 28.0 + 2.0*numpy.sin(minute/30.0),
+                'temp_dew' : numpy.full(size, 18.0),
+                'speed'    : 3.0 + numpy.cos(minute/10.0),
+            },
+            index = self.dates,
+        )
+
+    def test_matches_wbgt(self):
+
+        engine = StreamingWBGT(window=self.window)
+        engine.add_station('A', 35.0, -80.0)
+
+        out = []
+        for time, row in self.data.iterrows():
+            res = engine.update('A', time, *row.values)
+            if res is not None:
+                out.append(res)
+        self.assertEqual(len(out), self.data.shape[0] - self.window + 1)
+
+        means = self.data.rolling(self.window).mean().iloc[self.window-1:]
+        dates = means.index - pandas.Timedelta(minutes=(self.window-1)/2)
+        ref   = wbgt(
+            'liljegren',
+            dates,
+            numpy.array([35.0]),
+            numpy.array([-80.0]),
+            units.Quantity(means['solar'].values,    'watt/meter**2'),
+            units.Quantity(means['pres'].values,     'hPa'),
+            units.Quantity(means['temp_air'].values, 'degC'),
+            units.Quantity(means['temp_dew'].values, 'degC'),
+            units.Quantity(means['speed'].values,    'm/s'),
+        )
+
+        numpy.testing.assert_array_equal(
+            numpy.array([res['datetime'] for res in out]),
+            dates.values,
+        )
+        numpy.testing.assert_allclose(
+            [res['Twbg'] for res in out],
+            ref['Twbg'].magnitude,
+            atol = 0.01,
+        )
+
+    def test_unix_time(self):
+
+        engines = {}
+        for key in ('datetime', 'int64'):
+            engines[key] = StreamingWBGT(window=self.window)
+            engines[key].add_station('A', 35.0, -80.0)
+
+        # Numpy scalars of Unix time are not datetimes
+        unix = self.dates.values.astype('datetime64[s]').astype(numpy.int64)
+        for time, utime, row in zip(self.dates, unix, self.data.values):
+            ref = engines['datetime'].update('A', time, *row)
+            res = engines['int64'].update('A', utime, *row)
+            self.assertEqual(res is None, ref is None)
+            if ref is not None:
+                self.assertEqual(res['datetime'], ref['datetime'])
+                self.assertEqual(res['Twbg'], ref['Twbg'])
+
+    def test_step_and_gap(self):
+
+        engine = StreamingWBGT(window=self.window, step=self.window)
+        engine.add_station('A', 35.0, -80.0)
+
+        times = list(self.data.index)
+        del times[50:80]
+        nout = sum(
+            engine.update('A', time, *self.data.loc[time].values) is not None
+            for time in times
+        )
+        # 50 samples before gap, 100 after; buffers cleared at the gap
+        self.assertEqual(nout, 50//self.window + 100//self.window)
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,79 @@
+import unittest
+
+import numpy
+
+from pywbgt import synthetic, wbgt
+
+class TestSynthetic(unittest.TestCase):
+
+    def setUp(self):
+
+        self.size = 20000
+        self.met  = synthetic.stations(self.size, nstation=20, seed=3, missing=0.01)
+
+    def test_reproducible(self):
+
+        met = synthetic.stations(self.size, nstation=20, seed=3, missing=0.01)
+        for key in synthetic.UNITS:
+            numpy.testing.assert_array_equal(met[key].magnitude, self.met[key].magnitude)
+
+        other = synthetic.stations(self.size, nstation=20, seed=4, missing=0.01)
+        self.assertFalse(numpy.allclose(
+            other['temp_air'].magnitude, self.met['temp_air'].magnitude, equal_nan=True,
+        ))
+
+    def test_stream(self):
+
+        chunks = list(synthetic.stream(self.size, chunk_size=3001, nstation=20, seed=3, missing=0.01))
+        self.assertEqual(len(chunks), -(-self.size // 3001))
+        self.assertTrue(
+            (numpy.concatenate([c['datetime'].values for c in chunks]) == self.met['datetime'].values).all()
+        )
+        for key in ('lat', 'cosz'):
+            numpy.testing.assert_array_equal(
+                numpy.concatenate([c[key] for c in chunks]), self.met[key],
+            )
+        for key in synthetic.UNITS:
+            numpy.testing.assert_allclose(
+                numpy.concatenate([c[key].magnitude for c in chunks]),
+                self.met[key].magnitude,
+                rtol = 1.0e-12,
+            )
+
+    def test_statistics(self):
+
+        met  = self.met
+        tair = met['temp_air'].magnitude
+        tdew = met['temp_dew'].magnitude
+        good = numpy.isfinite(tair) & numpy.isfinite(tdew)
+        self.assertTrue(numpy.all(tdew[good] <= tair[good]))
+        self.assertGreater(numpy.corrcoef(tair[good], tdew[good])[0, 1], 0.5)
+
+        night = met['cosz'] <= 0.0
+        solar = met['solar'].magnitude
+        self.assertTrue(numpy.all(solar[night & numpy.isfinite(solar)] == 0.0))
+        speed = met['speed'].magnitude
+        self.assertLess(numpy.nanmean(speed[night]), numpy.nanmean(speed[~night]))
+
+        for key in synthetic.UNITS:
+            frac = numpy.isnan(met[key].magnitude).mean()
+            self.assertGreater(frac, 0.002)
+            self.assertLess(frac, 0.03)
+
+    def test_grid(self):
+
+        lat = numpy.linspace(30.0, 40.0, 5)
+        lon = numpy.linspace(-90.0, -80.0, 6)
+        cube = synthetic.grid(48, lat, lon, missing=0.0)
+        self.assertEqual(cube['temp_air'].shape, (48, 5, 6))
+        self.assertEqual(cube['lat'].shape, (5, 6))
+        self.assertFalse(numpy.isnan(cube['pres'].magnitude).any())
+
+    def test_wbgt(self):
+
+        met = synthetic.stations(2000, seed=1, missing=0.0)
+        res = wbgt('liljegren', *synthetic.args(met))
+        self.assertTrue(numpy.isfinite(res['Twbg'].magnitude).all())
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,113 @@
+import unittest
+
+import pandas
+import numpy
+from metpy.units import units
+
+from pywbgt import parallel
+from pywbgt.liljegren import wetbulb_globe
+from pywbgt.temporal import interp_weights, wbgt_interp
+
+class TestTemporal(unittest.TestCase):
+
+    def setUp(self):
+
+        self.src  = pandas.date_range('20000601 10:00', periods=4, freq='1h')
+        self.tgt  = pandas.date_range('20000601 09:50', periods=22, freq='10min')
+        self.lat  = numpy.linspace(30, 40, 5)
+        self.lon  = numpy.linspace(-100, -80, 5)
+        t, p      = numpy.meshgrid(numpy.arange(4), numpy.arange(5), indexing='ij')
+        self.met  = [
+            units.Quantity(500.0 + 100.0*t + 20.0*p, 'watt/m**2'),
+            units.Quantity(1000.0 - t,               'hPa'),
+            units.Quantity(28.0 + 1.5*t + 0.5*p,     'degC'),
+            units.Quantity(18.0 + 0.5*t - 0.2*p,     'degC'),
+            units.Quantity(2.0 + 0.5*t + 0.1*p,      'm/s'),
+        ]
+
+    def test_weights(self):
+
+        index, weight = interp_weights(self.src, self.tgt)
+        self.assertEqual(index[0], -1)
+        self.assertEqual(index[-1], -1)
+        self.assertEqual(index[1], 0)
+        self.assertEqual(weight[1], 0.0)
+        self.assertAlmostEqual(weight[2], 1.0/6.0)
+        # Last source time is inside, interpolated with full weight
+        self.assertEqual(index[-3], 2)
+        self.assertEqual(weight[-3], 1.0)
+
+    def test_interp(self):
+
+        res = wbgt_interp(self.src, self.tgt, self.lat, self.lon, *self.met)
+        self.assertEqual(res['Twbg'].shape, (self.tgt.size, self.lat.size))
+        self.assertTrue(numpy.all(numpy.isnan(res['Twbg'].magnitude[[0, -1]])))
+
+        # Reference: interpolate inputs in time, then compute WBGT
+        tgt   = self.tgt[1:-2]
+        x     = tgt.values.astype(numpy.int64)
+        xp    = self.src.values.astype(numpy.int64)
+        met   = [
+            units.Quantity(
+                numpy.stack([numpy.interp(x, xp, col) for col in val.magnitude.T], axis=1),
+                val.units,
+            )
+            for val in self.met
+        ]
+        npnt = self.lat.size
+        ref  = wetbulb_globe(
+            pandas.DatetimeIndex(numpy.repeat(tgt.values, npnt)),
+            numpy.tile(self.lat, tgt.size),
+            numpy.tile(self.lon, tgt.size),
+            *(val.ravel() for val in met),
+        )
+        for var in ('Tg', 'Tpsy', 'Tnwb', 'Twbg'):
+            numpy.testing.assert_allclose(
+                res[var].to('degC').magnitude[1:-2].ravel(),
+                ref[var].to('degC').magnitude,
+                atol=0.05,
+                err_msg=var,
+            )
+
+    def test_interp_threads(self):
+
+        # Many points with differing solar irradiance, so results mixed up
+        # between threads do not go unnoticed
+        rng   = numpy.random.default_rng(11)
+        npnt  = 10000
+        lat   = rng.uniform(25.0, 45.0, npnt)
+        lon   = rng.uniform(-110.0, -75.0, npnt)
+        shape = (self.src.size, npnt)
+        met   = [
+            units.Quantity(rng.uniform(0.0, 1100.0, shape), 'watt/m**2'),
+            units.Quantity(rng.uniform(950.0, 1020.0, shape), 'hPa'),
+            units.Quantity(rng.uniform(20.0, 38.0, shape), 'degC'),
+            units.Quantity(rng.uniform(5.0, 19.0, shape), 'degC'),
+            units.Quantity(rng.uniform(0.5, 8.0, shape), 'm/s'),
+        ]
+
+        with parallel.num_threads(1):
+            serial = wbgt_interp(self.src, self.tgt, lat, lon, *met)
+        with parallel.num_threads(4):
+            res = wbgt_interp(self.src, self.tgt, lat, lon, *met)
+        for var in ('Tg', 'Tnwb', 'Twbg', 'solar'):
+            numpy.testing.assert_array_equal(res[var].magnitude, serial[var].magnitude, err_msg=var)
+
+        # Reference at the source times, where no interpolation is done
+        idx = [1, 7, 13, 19]
+        ref = wetbulb_globe(
+            pandas.DatetimeIndex(numpy.repeat(self.tgt[idx].values, npnt)),
+            numpy.tile(lat, len(idx)),
+            numpy.tile(lon, len(idx)),
+            *(val.ravel() for val in met),
+        )
+        for var in ('Tg', 'Tnwb', 'Twbg'):
+            numpy.testing.assert_allclose(
+                res[var].to('degC').magnitude[idx].ravel(),
+                ref[var].to('degC').magnitude,
+                atol=0.05,
+                err_msg=var,
+            )
+
+if __name__ == "__main__":
+    unittest.main()
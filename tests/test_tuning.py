@@ -0,0 +1,129 @@
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import unittest
+from unittest import mock
+
+import numpy
+
+from pywbgt import bernard, isa, liljegren, tuning, wbgt, wbgt_chunked
+from pywbgt import synthetic
+
+class TestTuning(unittest.TestCase):
+
+    def setUp(self):
+
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.path   = os.path.join(self.tmpdir.name, 'tuning.json')
+        self.isa    = isa.get_isa()
+
+    def tearDown(self):
+
+        tuning.load(self.path + '.none')
+        bernard.set_openmp_schedule('static', 0)
+        isa.set_isa(self.isa)
+        self.tmpdir.cleanup()
+
+    def test_autotune(self):
+
+        res = tuning.autotune(['bernard', 'dimiceli'], size=2**13, min_time=0.0, path=self.path)
+        self.assertEqual(set(res), {'bernard', 'dimiceli'})
+        self.assertIn('schedule', res['bernard'])
+        self.assertNotIn('schedule', res['dimiceli'])
+        self.assertIn(res['dimiceli']['chunk_size'], tuning.CHUNK_SIZES)
+
+        # Saved, used in this process, and loaded by the next
+        with open(self.path) as fid:
+            self.assertEqual(json.load(fid)['methods']['bernard'], res['bernard'])
+        self.assertEqual(bernard.get_openmp_schedule(), tuple(res['bernard']['schedule']))
+        bernard.set_openmp_schedule('static', 0)
+        tuning.load(self.path)
+        self.assertEqual(bernard.get_openmp_schedule(), tuple(res['bernard']['schedule']))
+        self.assertEqual(tuning.chunk_size('dimiceli', None), res['dimiceli']['chunk_size'])
+
+        # Engines pick up the chunk size
+        met = synthetic.stations(3*res['dimiceli']['chunk_size'] + 5, missing=0.0)
+        with tempfile.TemporaryDirectory() as outdir:
+            out = wbgt_chunked('dimiceli', *synthetic.args(met), outdir=outdir)
+            self.assertEqual(len(out['files']), 4)
+
+    def test_resume_retuned(self):
+
+        met  = synthetic.stations(95, missing=0.0)
+        args = synthetic.args(met)
+        with tempfile.TemporaryDirectory() as outdir:
+            kwargs = dict(outdir=outdir, checkpoint=os.path.join(outdir, 'job.ckpt.npz'))
+            with mock.patch.object(tuning, 'chunk_size', return_value=10):
+                out = wbgt_chunked('dimiceli', *args, max_chunks=2, **kwargs)
+            self.assertFalse(out['complete'])
+
+            # Re-tuning between runs must not change the chunks of the job
+            with mock.patch.object(tuning, 'chunk_size', return_value=32):
+                out = wbgt_chunked('dimiceli', *args, **kwargs)
+            self.assertTrue(out['complete'])
+            self.assertEqual(len(out['files']), 10)
+
+    def test_environment(self):
+
+        with open(self.path, 'w') as fid:
+            json.dump({
+                'machine' : tuning._machine(),
+                'methods' : {'bernard' : {'schedule' : ['guided', 0], 'chunk_size' : 4096}},
+            }, fid)
+
+        env = {'PYWBGT_SCHEDULE' : 'dynamic,128', 'PYWBGT_CHUNK_SIZE' : 'oops'}
+        with mock.patch.dict(os.environ, env):
+            with self.assertWarns(UserWarning):
+                tuning.load(self.path)
+        self.assertEqual(bernard.get_openmp_schedule(), ('dynamic', 128))
+        self.assertEqual(tuning.chunk_size('bernard', None), 4096)
+
+    def test_schedule(self):
+
+        met  = synthetic.args(synthetic.stations(5000, seed=2, missing=0.0))
+        ref  = wbgt('bernard', *met)['Tg'].magnitude
+        bernard.set_openmp_schedule('dynamic', 16)
+        self.assertEqual(bernard.get_openmp_schedule(), ('dynamic', 16))
+        numpy.testing.assert_array_equal(wbgt('bernard', *met)['Tg'].magnitude, ref)
+        with self.assertRaises(Exception):
+            bernard.set_openmp_schedule('fastest')
+
+    def test_retune_cached_threads(self):
+
+        # Each thread count must be timed at that count, not at the cached
+        # one wbgt() uses by default; run with 2 threads even on 1 CPU
+        script = f"""
+import json
+from unittest import mock
+import pywbgt
+from pywbgt import parallel, tuning
+with open({self.path!r}, 'w') as fid:
+    json.dump({{'machine' : tuning._machine(), 'methods' : {{'dimiceli' : {{'threads' : 1}}}}}}, fid)
+tuning.load()
+seen = set()
+func = pywbgt.dimiceliWBGT
+def counted(*args, **kwargs):
+    seen.add(parallel.get_num_threads())
+    return func(*args, **kwargs)
+with mock.patch.object(pywbgt, 'dimiceliWBGT', counted):
+    tuning.autotune(['dimiceli'], size=2**12, min_time=0.0, save=False)
+print(json.dumps(sorted(seen)))
+"""
+        env = {**os.environ, 'NUMBA_NUM_THREADS' : '2', tuning.CACHE_ENV : self.path}
+        out = subprocess.run(
+            [sys.executable, '-c', script], env=env, capture_output=True, text=True, check=True,
+        )
+        self.assertEqual(json.loads(out.stdout.splitlines()[-1]), [1, 2])
+
+    def test_other_machine(self):
+
+        machine = {**tuning._machine(), 'max_threads' : -1}
+        with open(self.path, 'w') as fid:
+            json.dump({'machine' : machine, 'methods' : {'bernard' : {'threads' : 3}}}, fid)
+        tuning.load(self.path)
+        self.assertIsNone(tuning.threads('bernard'))
+
+if __name__ == "__main__":
+    unittest.main()